@@ -0,0 +1,42 @@
+package mono.android;
+
+// Helpers used by the native GC bridge (src/native/monodroid/osbridge.cc) to do all the Java work required by a
+// single bridge processing pass with as few JNI transitions as possible.
+final class GCBridge {
+	private GCBridge ()
+	{
+	}
+
+	// `peers` contains handles of the bridged objects, followed by `peers.length - firstTemporaryPeer` temporary
+	// peers standing in for SCCs without any Java objects.  Any of the entries may be `null`.
+	//
+	// `links` contains `linkCount` pairs of indexes into `peers`, a reference is added from the first peer of each
+	// pair to the second one. `referencesAdded [i]` is set for every bridged object (`i < firstTemporaryPeer`) which
+	// had at least one reference added to it.
+	static void addReferences (java.lang.Object[] peers, int firstTemporaryPeer, int[] links, int linkCount, boolean[] referencesAdded)
+	{
+		for (int i = 0; i < linkCount; i++) {
+			int source = links [i * 2];
+			java.lang.Object peer = peers [source];
+
+			if (!(peer instanceof IGCUserPeer))
+				continue;
+
+			((IGCUserPeer) peer).monodroidAddReference (peers [links [i * 2 + 1]]);
+			if (source < firstTemporaryPeer)
+				referencesAdded [source] = true;
+		}
+	}
+
+	// Calls `monodroidClearReferences` on every entry of `peers` which is an IGCUserPeer, the others (and `null`
+	// entries) are skipped.
+	static void clearReferences (java.lang.Object[] peers)
+	{
+		for (int i = 0; i < peers.length; i++) {
+			java.lang.Object peer = peers [i];
+
+			if (peer instanceof IGCUserPeer)
+				((IGCUserPeer) peer).monodroidClearReferences ();
+		}
+	}
+}
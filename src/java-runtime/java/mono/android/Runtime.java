@@ -9,6 +9,7 @@ public class Runtime {
 	static java.lang.Class java_util_TimeZone = java.util.TimeZone.class;
 	static java.lang.Class mono_android_IGCUserPeer = mono.android.IGCUserPeer.class;
 	static java.lang.Class mono_android_GCUserPeer = mono.android.GCUserPeer.class;
+	static java.lang.Class mono_android_GCBridge = mono.android.GCBridge.class;
 
 	static {
 		Thread.setDefaultUncaughtExceptionHandler (new XamarinUncaughtExceptionHandler (Thread.getDefaultUncaughtExceptionHandler ()));
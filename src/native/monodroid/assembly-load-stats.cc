@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cinttypes>
+
+#include "assembly-load-stats.hh"
+#include "logger.hh"
+#include "util.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	force_inline uint64_t
+	total_ns (AssemblyLoadCost const& cost) noexcept
+	{
+		return cost.lookup_ns + cost.data_ns + cost.image_open_ns + cost.load_ns;
+	}
+
+	force_inline uint64_t
+	to_us (uint64_t ns) noexcept
+	{
+		return ns / 1000;
+	}
+}
+
+void
+AssemblyLoadStats::initialize () noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	costs.reserve (256);
+	is_enabled = true;
+}
+
+void
+AssemblyLoadStats::add (AssemblyLoadCost const& cost, const char *name) noexcept
+{
+	AssemblyLoadCost entry = cost;
+	entry.name = Util::strdup_new (name);
+
+	std::lock_guard<std::mutex> guard (lock);
+	costs.push_back (entry);
+}
+
+// The table is sorted by the total load time, the slowest assemblies first.  Times are in microseconds, sizes in bytes.
+void
+AssemblyLoadStats::dump () noexcept
+{
+	std::vector<AssemblyLoadCost> sorted;
+	{
+		std::lock_guard<std::mutex> guard (lock);
+		sorted = costs;
+	}
+
+	log_info_nocheck (LOG_TIMING, "[2/11] Assembly load costs, %zu assemblies (times in us, sizes in bytes)", sorted.size ());
+	if (sorted.empty ()) {
+		return;
+	}
+
+	std::stable_sort (
+		sorted.begin (),
+		sorted.end (),
+		[](AssemblyLoadCost const& a, AssemblyLoadCost const& b) {
+			return total_ns (a) > total_ns (b);
+		}
+	);
+
+	log_info_nocheck (LOG_TIMING, "  [2/12] total lookup data image-open load | mapped decompressed mmap minflt majflt | name");
+
+	AssemblyLoadCost sum {};
+	for (AssemblyLoadCost const& cost : sorted) {
+		log_info_nocheck (
+			LOG_TIMING,
+			"  [2/12] %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " | %u %u %s %ld %ld | %s",
+			to_us (total_ns (cost)),
+			to_us (cost.lookup_ns),
+			to_us (cost.data_ns),
+			to_us (cost.image_open_ns),
+			to_us (cost.load_ns),
+			cost.mapped_bytes,
+			cost.decompressed_bytes,
+			cost.mmapped ? "yes" : "no",
+			cost.minor_faults,
+			cost.major_faults,
+			cost.name
+		);
+
+		sum.lookup_ns += cost.lookup_ns;
+		sum.data_ns += cost.data_ns;
+		sum.image_open_ns += cost.image_open_ns;
+		sum.load_ns += cost.load_ns;
+		sum.mapped_bytes += cost.mapped_bytes;
+		sum.decompressed_bytes += cost.decompressed_bytes;
+		sum.minor_faults += cost.minor_faults;
+		sum.major_faults += cost.major_faults;
+	}
+
+	log_info_nocheck (
+		LOG_TIMING,
+		"  [2/13] %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " | %u %u - %ld %ld | (all assemblies)",
+		to_us (total_ns (sum)),
+		to_us (sum.lookup_ns),
+		to_us (sum.data_ns),
+		to_us (sum.image_open_ns),
+		to_us (sum.load_ns),
+		sum.mapped_bytes,
+		sum.decompressed_bytes,
+		sum.minor_faults,
+		sum.major_faults
+	);
+}
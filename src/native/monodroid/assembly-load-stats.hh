@@ -0,0 +1,161 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __ASSEMBLY_LOAD_STATS_HH
+#define __ASSEMBLY_LOAD_STATS_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "platform-compat.hh"
+
+namespace xamarin::android::internal
+{
+	// Cost of loading a single assembly from the APK or the assembly store, split into the phases of the load
+	struct AssemblyLoadCost
+	{
+		char     *name;
+		uint64_t  lookup_ns;          // finding the assembly in the bundle or the store index (and mapping it, if needed)
+		uint64_t  data_ns;            // getting the image data, i.e. LZ4 decompression if the assembly is compressed
+		uint64_t  image_open_ns;      // `mono_image_open_from_data_with_name` and opening the debug symbols
+		uint64_t  load_ns;            // `mono_assembly_load_from_full`
+		uint32_t  mapped_bytes;       // size of the assembly data in the APK, compressed if the assembly is compressed
+		uint32_t  decompressed_bytes; // size of the decompressed image, 0 if the assembly isn't compressed
+		long      minor_faults;       // page faults during the load, on the loading thread
+		long      major_faults;
+		bool      mmapped;            // the assembly had to be mmapped by this load
+	};
+
+	// Per-assembly load cost table, collected when timing is enabled (see `debug.mono.log`) and logged at the end of
+	// startup and when the timing data is dumped.
+	class AssemblyLoadStats
+	{
+	public:
+		static bool enabled () noexcept
+		{
+			return is_enabled;
+		}
+
+		static void initialize () noexcept;
+		static void add (AssemblyLoadCost const& cost, const char *name) noexcept;
+		static void dump () noexcept;
+
+	private:
+		static inline bool                           is_enabled = false;
+		static inline std::mutex                     lock;
+		static inline std::vector<AssemblyLoadCost>  costs;  // protected by `lock`
+	};
+
+	// Measures the phases of a single assembly load, on the loading thread.  Each `end_*` call ends the phase started by
+	// the previous one (or by the constructor), the cost is recorded only if `finish` is called, so failed loads aren't
+	// included.  Does nothing if `AssemblyLoadStats` isn't enabled.
+	class AssemblyLoadCostRecorder final
+	{
+	public:
+		AssemblyLoadCostRecorder () noexcept
+			: active (AssemblyLoadStats::enabled ())
+		{
+			if (!active) [[likely]] {
+				return;
+			}
+
+			get_faults (start_minor_faults, start_major_faults);
+			phase_start = now_ns ();
+		}
+
+		AssemblyLoadCostRecorder (AssemblyLoadCostRecorder const&) = delete;
+		AssemblyLoadCostRecorder& operator= (AssemblyLoadCostRecorder const&) = delete;
+
+		force_inline bool is_active () const noexcept
+		{
+			return active;
+		}
+
+		force_inline void end_lookup (uint32_t mapped_bytes, bool mmapped) noexcept
+		{
+			if (!active) [[likely]] {
+				return;
+			}
+
+			end_phase (cost.lookup_ns);
+			cost.mapped_bytes = mapped_bytes;
+			cost.mmapped = mmapped;
+		}
+
+		force_inline void end_data (uint32_t decompressed_bytes) noexcept
+		{
+			if (!active) [[likely]] {
+				return;
+			}
+
+			end_phase (cost.data_ns);
+			cost.decompressed_bytes = decompressed_bytes;
+		}
+
+		force_inline void end_image_open () noexcept
+		{
+			if (!active) [[likely]] {
+				return;
+			}
+
+			end_phase (cost.image_open_ns);
+		}
+
+		force_inline void finish (const char *name) noexcept
+		{
+			if (!active) [[likely]] {
+				return;
+			}
+
+			end_phase (cost.load_ns);
+
+			long minor_faults, major_faults;
+			get_faults (minor_faults, major_faults);
+			cost.minor_faults = minor_faults - start_minor_faults;
+			cost.major_faults = major_faults - start_major_faults;
+
+			AssemblyLoadStats::add (cost, name);
+		}
+
+	private:
+		force_inline static uint64_t now_ns () noexcept
+		{
+			timespec ts;
+			if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0) [[unlikely]] {
+				return 0;
+			}
+
+			return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL) + static_cast<uint64_t>(ts.tv_nsec);
+		}
+
+		force_inline static void get_faults (long &minor, long &major) noexcept
+		{
+			rusage usage;
+			if (getrusage (RUSAGE_THREAD, &usage) != 0) [[unlikely]] {
+				minor = major = 0;
+				return;
+			}
+
+			minor = usage.ru_minflt;
+			major = usage.ru_majflt;
+		}
+
+		force_inline void end_phase (uint64_t &phase_ns) noexcept
+		{
+			uint64_t now = now_ns ();
+			phase_ns = now - phase_start;
+			phase_start = now;
+		}
+
+	private:
+		bool              active;
+		AssemblyLoadCost  cost {};
+		uint64_t          phase_start = 0;
+		long              start_minor_faults = 0;
+		long              start_major_faults = 0;
+	};
+}
+#endif // ndef __ASSEMBLY_LOAD_STATS_HH
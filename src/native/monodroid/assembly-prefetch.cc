@@ -0,0 +1,191 @@
+#include <array>
+#include <cinttypes>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#include <pthread.h>
+
+#include "android-system.hh"
+#include "assembly-prefetch.hh"
+#include "globals.hh"
+#include "logger.hh"
+#include "shared-constants.hh"
+#include "timing-internal.hh"
+#include "util.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	force_inline uint64_t
+	now_ns () noexcept
+	{
+		timespec ts;
+		if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0) [[unlikely]] {
+			return 0;
+		}
+
+		return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL) + static_cast<uint64_t>(ts.tv_nsec);
+	}
+}
+
+void
+AssemblyPrefetch::start () noexcept
+{
+	dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> value;
+	if (AndroidSystem::monodroid_get_system_property (SharedConstants::DEBUG_MONO_ASSEMBLY_PREFETCH_PROPERTY, value) <= 0) {
+		return;
+	}
+
+	constexpr std::string_view MODE_AUTO { "auto" };
+	constexpr std::string_view MODE_RECORD { "record" };
+
+	bool record_only = strcmp (value.get (), MODE_RECORD.data ()) == 0;
+	if (!record_only && strcmp (value.get (), MODE_AUTO.data ()) != 0) {
+		log_warn (LOG_ASSEMBLY, "Assembly prefetch: unknown mode '%s' in '%s'", value.get (), SharedConstants::DEBUG_MONO_ASSEMBLY_PREFETCH_PROPERTY.data ());
+		return;
+	}
+
+	std::unique_ptr<char> path {Util::path_combine (AndroidSystem::override_dirs [0], ORDER_FILE_NAME)};
+	if (!record_only && Util::file_exists (path.get ())) {
+		start_replay (path.get ());
+	} else {
+		start_recording (path.get ());
+	}
+}
+
+void
+AssemblyPrefetch::start_recording (const char *path) noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	Util::create_directory (AndroidSystem::override_dirs [0], 0755);
+	order_file = Util::monodroid_fopen (path, "w");
+	if (order_file == nullptr) {
+		return;
+	}
+	Util::set_world_accessable (path);
+
+	fputs ("# Assembly load order: microseconds since startup, assembly name\n", order_file);
+	start_ns = now_ns ();
+	recording = true;
+
+	log_info (LOG_ASSEMBLY, "Assembly prefetch: recording the assembly load order to %s", path);
+}
+
+// The file is written one line at a time, so that the order recorded so far isn't lost if the process is killed
+void
+AssemblyPrefetch::record (const char *name) noexcept
+{
+	uint64_t elapsed_us = (now_ns () - start_ns) / 1000;
+
+	std::lock_guard<std::mutex> guard (lock);
+	if (order_file == nullptr) {
+		return;
+	}
+
+	fprintf (order_file, "%" PRIu64 " %s\n", elapsed_us, name);
+	fflush (order_file);
+
+	if (++recorded_count == MAX_ASSEMBLIES) {
+		fclose (order_file);
+		order_file = nullptr;
+		recording = false;
+	}
+}
+
+void
+AssemblyPrefetch::start_replay (const char *path) noexcept
+{
+	FILE *file = Util::monodroid_fopen (path, "r");
+	if (file == nullptr) {
+		return;
+	}
+
+	// Owned by the prefetch thread from now on
+	auto names = new std::vector<char*> ();
+	std::array<char, SENSIBLE_PATH_MAX + 32> line;
+
+	while (names->size () < MAX_ASSEMBLIES && fgets (line.data (), static_cast<int>(line.size ()), file) != nullptr) {
+		size_t length = strlen (line.data ());
+
+		// Skip comments, as well as the last line if the recording process was killed while writing it
+		if (line[0] == '#' || length == 0 || line[length - 1] != '\n') {
+			continue;
+		}
+		line[length - 1] = '\0';
+
+		char *name = strchr (line.data (), ' ');
+		if (name == nullptr || name[1] == '\0') {
+			continue;
+		}
+		names->push_back (Util::strdup_new (name + 1));
+	}
+	fclose (file);
+
+	if (names->empty ()) {
+		delete names;
+		return;
+	}
+
+	log_debug (LOG_ASSEMBLY, "Assembly prefetch: starting background prefetch of %zu assemblies", names->size ());
+
+	// The prefetch thread touches the same data as the thread which loads assemblies, which must not skip locking from
+	// now on
+	MonodroidRuntime::set_startup_multithreaded ();
+
+	pthread_attr_t attr;
+	pthread_attr_init (&attr);
+	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t thread;
+	int ret = pthread_create (&thread, &attr, prefetch_thread, names);
+	pthread_attr_destroy (&attr);
+
+	if (ret != 0) {
+		log_warn (LOG_ASSEMBLY, "Assembly prefetch: failed to create the prefetch thread. %s", strerror (ret));
+		for (char *name : *names) {
+			delete[] name;
+		}
+		delete names;
+		return;
+	}
+
+	pthread_setname_np (thread, "XA asm prefetch");
+}
+
+void*
+AssemblyPrefetch::prefetch_thread (void *arg) noexcept
+{
+	auto names = static_cast<std::vector<char*>*>(arg);
+
+	size_t total_time_index;
+	if (FastTiming::enabled ()) [[unlikely]] {
+		total_time_index = internal_timing->start_event (TimingEventKind::AssemblyPrefetch);
+	}
+
+	uint64_t prefetched = 0;
+	dynamic_local_string<SENSIBLE_PATH_MAX> name;
+	for (char *n : *names) {
+		name.assign_c (n);
+		if (embeddedAssemblies.prefetch_assembly (name)) {
+			prefetched++;
+		} else {
+			log_debug (LOG_ASSEMBLY, "Assembly prefetch: '%s' not found", n);
+		}
+		delete[] n;
+	}
+	delete names;
+
+	if (FastTiming::enabled ()) [[unlikely]] {
+		internal_timing->end_event (total_time_index, true /* uses_more_info */);
+
+		static_local_string<SharedConstants::INTEGER_BASE10_BUFFER_SIZE> more_info;
+		more_info.append (prefetched);
+		internal_timing->add_more_info (total_time_index, more_info);
+	}
+
+	return nullptr;
+}
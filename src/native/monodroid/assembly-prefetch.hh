@@ -0,0 +1,47 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __ASSEMBLY_PREFETCH_HH
+#define __ASSEMBLY_PREFETCH_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+namespace xamarin::android::internal
+{
+	// Implements the `debug.mono.assembly_prefetch` property.  When there's no recorded assembly load order yet, the name
+	// of every assembly loaded from the application package is appended to `assembly-load-order.txt` in the override
+	// directory, together with the time (in microseconds) which passed since recording started.  When the file exists,
+	// a background thread started before the runtime is initialized goes over it in order, mapping, reading in and
+	// decompressing the assemblies (see EmbeddedAssemblies::prefetch_assembly), so that the thread which needs them
+	// later only has to open their images.  Assemblies which aren't in the file are never touched.
+	class AssemblyPrefetch
+	{
+		static constexpr char ORDER_FILE_NAME[] = "assembly-load-order.txt";
+		static constexpr size_t MAX_ASSEMBLIES = 1024;
+
+	public:
+		static bool is_recording () noexcept
+		{
+			return recording;
+		}
+
+		static void start () noexcept;
+		static void record (const char *name) noexcept;
+
+	private:
+		static void start_recording (const char *path) noexcept;
+		static void start_replay (const char *path) noexcept;
+		static void* prefetch_thread (void *arg) noexcept;
+
+	private:
+		static inline bool        recording = false;
+		static inline uint64_t    start_ns = 0;
+
+		// All below protected by `lock`
+		static inline std::mutex  lock;
+		static inline FILE       *order_file = nullptr;
+		static inline size_t      recorded_count = 0;
+	};
+}
+#endif // ndef __ASSEMBLY_PREFETCH_HH
@@ -27,6 +27,8 @@
 #include <mono/metadata/reflection.h>
 
 #include "util.hh"
+#include "assembly-load-stats.hh"
+#include "assembly-prefetch.hh"
 #include "embedded-assemblies.hh"
 #include "globals.hh"
 #include "mono-image-loader.hh"
@@ -95,10 +97,12 @@ EmbeddedAssemblies::get_assembly_data (uint8_t *data, uint32_t data_size, [[mayb
 
 		CompressedAssemblyDescriptor &cad = compressed_assemblies.descriptors[header->descriptor_index];
 		assembly_data_size = data_size - sizeof(CompressedAssemblyHeader);
-		if (!cad.loaded) {
+		// The assembly prefetch thread may be decompressing it at the same time.  `loaded` is stored with release
+		// semantics once `data` and `uncompressed_file_size` are final, and loaded with acquire ones on both checks.
+		if (!__atomic_load_n (&cad.loaded, __ATOMIC_ACQUIRE)) {
 			StartupAwareLock decompress_lock (assembly_decompress_mutex);
 
-			if (cad.loaded) {
+			if (__atomic_load_n (&cad.loaded, __ATOMIC_ACQUIRE)) {
 				set_assembly_data_and_size (reinterpret_cast<uint8_t*>(cad.data), cad.uncompressed_file_size, assembly_data, assembly_data_size);
 				return;
 			}
@@ -130,7 +134,7 @@ EmbeddedAssemblies::get_assembly_data (uint8_t *data, uint32_t data_size, [[mayb
 				log_debug (LOG_ASSEMBLY, "Decompression of assembly %s yielded a different size (expected %lu, got %u)", name, cad.uncompressed_file_size, static_cast<uint32_t>(ret));
 				Helpers::abort_application ();
 			}
-			cad.loaded = true;
+			__atomic_store_n (&cad.loaded, true, __ATOMIC_RELEASE);
 		}
 
 		set_assembly_data_and_size (reinterpret_cast<uint8_t*>(cad.data), cad.uncompressed_file_size, assembly_data, assembly_data_size);
@@ -179,7 +183,7 @@ EmbeddedAssemblies::map_runtime_file (XamarinAndroidBundledAssembly& file) noexc
 		close (fd);
 	}
 
-	if (MonodroidRuntime::is_startup_in_progress ()) {
+	if (MonodroidRuntime::is_startup_single_threaded ()) {
 		file.data = static_cast<uint8_t*>(map_info.area);
 	} else {
 		uint8_t *expected_null = nullptr;
@@ -233,7 +237,8 @@ EmbeddedAssemblies::load_bundled_assembly (
 	dynamic_local_string<SENSIBLE_PATH_MAX> const& name,
 	dynamic_local_string<SENSIBLE_PATH_MAX> const& abi_name,
 	TLoaderData loader_data,
-	bool ref_only) noexcept
+	bool ref_only,
+	AssemblyLoadCostRecorder &load_cost) noexcept
 {
 	if (assembly.name == nullptr || assembly.name[0] == '\0') {
 		return nullptr;
@@ -247,14 +252,18 @@ EmbeddedAssemblies::load_bundled_assembly (
 		}
 	}
 
-	if (assembly.data == nullptr) {
+	bool mmapped = assembly.data == nullptr;
+	if (mmapped) {
 		map_assembly (assembly);
 	}
+	load_cost.end_lookup (assembly.data_size, mmapped);
 
 	uint8_t *assembly_data;
 	uint32_t assembly_data_size;
 
 	get_assembly_data (assembly, assembly_data, assembly_data_size);
+	load_cost.end_data (assembly_data != assembly.data ? assembly_data_size : 0);
+
 	MonoImage *image = MonoImageLoader::load (name, loader_data, assembly_data, assembly_data_size);
 	if (image == nullptr) {
 		return nullptr;
@@ -285,6 +294,7 @@ EmbeddedAssemblies::load_bundled_assembly (
 			break;
 		}
 	}
+	load_cost.end_image_open ();
 
 	MonoImageOpenStatus status;
 	MonoAssembly *a = mono_assembly_load_from_full (image, name.get (), &status, ref_only);
@@ -292,6 +302,7 @@ EmbeddedAssemblies::load_bundled_assembly (
 		log_warn (LOG_ASSEMBLY, "Failed to load managed assembly '%s'. %s", name.get (), mono_image_strerror (status));
 		return nullptr;
 	}
+	load_cost.finish (name.get ());
 
 	return a;
 }
@@ -313,9 +324,10 @@ EmbeddedAssemblies::individual_assemblies_open_from_bundles (dynamic_local_strin
 		.append (name);
 
 	MonoAssembly *a = nullptr;
+	AssemblyLoadCostRecorder load_cost;
 
 	for (size_t i = 0; i < application_config.number_of_assemblies_in_apk; i++) {
-		a = load_bundled_assembly (bundled_assemblies [i], name, abi_name, loader_data, ref_only);
+		a = load_bundled_assembly (bundled_assemblies [i], name, abi_name, loader_data, ref_only, load_cost);
 		if (a != nullptr) {
 			return a;
 		}
@@ -323,7 +335,7 @@ EmbeddedAssemblies::individual_assemblies_open_from_bundles (dynamic_local_strin
 
 	if (extra_bundled_assemblies != nullptr) {
 		for (XamarinAndroidBundledAssembly& assembly : *extra_bundled_assemblies) {
-			a = load_bundled_assembly (assembly, name, abi_name, loader_data, ref_only);
+			a = load_bundled_assembly (assembly, name, abi_name, loader_data, ref_only, load_cost);
 			if (a != nullptr) {
 				return a;
 			}
@@ -350,6 +362,7 @@ template<LoaderData TLoaderData>
 force_inline MonoAssembly*
 EmbeddedAssemblies::assembly_store_open_from_bundles (dynamic_local_string<SENSIBLE_PATH_MAX>& name, TLoaderData loader_data, bool ref_only) noexcept
 {
+	AssemblyLoadCostRecorder load_cost;
 	hash_t name_hash = xxhash::hash (name.get (), name.length ());
 	log_debug (LOG_ASSEMBLY, "assembly_store_open_from_bundles: looking for bundled name: '%s' (hash 0x%zx)", name.get (), name_hash);
 
@@ -390,10 +403,15 @@ EmbeddedAssemblies::assembly_store_open_from_bundles (dynamic_local_string<SENSI
 		);
 	}
 
+	// The store is mapped as a whole when the application starts, the individual assemblies never are
+	load_cost.end_lookup (assembly_runtime_info.descriptor->data_size, false /* mmapped */);
+
 	uint8_t *assembly_data;
 	uint32_t assembly_data_size;
 
 	get_assembly_data (assembly_runtime_info, assembly_data, assembly_data_size);
+	load_cost.end_data (assembly_data != assembly_runtime_info.image_data ? assembly_data_size : 0);
+
 	MonoImage *image = MonoImageLoader::load (name, loader_data, name_hash, assembly_data, assembly_data_size);
 	if (image == nullptr) {
 		log_warn (LOG_ASSEMBLY, "Failed to load MonoImage of '%s'", name.get ());
@@ -403,6 +421,7 @@ EmbeddedAssemblies::assembly_store_open_from_bundles (dynamic_local_string<SENSI
 	if (have_and_want_debug_symbols && assembly_runtime_info.debug_info_data != nullptr) {
 		mono_debug_open_image_from_memory (image, reinterpret_cast<const mono_byte*> (assembly_runtime_info.debug_info_data), static_cast<int>(assembly_runtime_info.descriptor->debug_data_size));
 	}
+	load_cost.end_image_open ();
 
 	MonoImageOpenStatus status;
 	MonoAssembly *a = mono_assembly_load_from_full (image, name.get (), &status, ref_only);
@@ -410,6 +429,7 @@ EmbeddedAssemblies::assembly_store_open_from_bundles (dynamic_local_string<SENSI
 		log_warn (LOG_ASSEMBLY, "Failed to load managed assembly '%s'. %s", name.get (), mono_image_strerror (status));
 		return nullptr;
 	}
+	load_cost.finish (name.get ());
 
 	return a;
 }
@@ -438,7 +458,11 @@ EmbeddedAssemblies::open_from_bundles (MonoAssemblyName* aname, TLoaderData load
 		a = individual_assemblies_open_from_bundles (name, loader_data, ref_only);
 	}
 
-	if (a == nullptr) {
+	if (a != nullptr) {
+		if (AssemblyPrefetch::is_recording ()) [[unlikely]] {
+			AssemblyPrefetch::record (name.get ());
+		}
+	} else {
 		log_warn (LOG_ASSEMBLY, "open_from_bundles: failed to load bundled assembly %s", name.get ());
 #if defined(DEBUG)
 		log_warn (LOG_ASSEMBLY, "open_from_bundles: the assembly might have been uploaded to the device with FastDev instead");
@@ -463,6 +487,88 @@ EmbeddedAssemblies::open_from_bundles_full (MonoAssemblyName *aname, [[maybe_unu
 	return embeddedAssemblies.open_from_bundles (aname, ref_only /* loader_data */, nullptr /* error */, ref_only);
 }
 
+XamarinAndroidBundledAssembly*
+EmbeddedAssemblies::find_bundled_assembly (dynamic_local_string<SENSIBLE_PATH_MAX> const& name) noexcept
+{
+	dynamic_local_string<SENSIBLE_PATH_MAX> abi_name;
+	abi_name
+		.assign (SharedConstants::android_lib_abi)
+		.append (zip_path_separator)
+		.append (name);
+
+	auto matches = [&name, &abi_name] (XamarinAndroidBundledAssembly const& assembly) -> bool {
+		if (assembly.name == nullptr) {
+			return false;
+		}
+
+		return strcmp (assembly.name, name.get ()) == 0 || strcmp (assembly.name, abi_name.get ()) == 0;
+	};
+
+	for (size_t i = 0; i < application_config.number_of_assemblies_in_apk; i++) {
+		if (matches (bundled_assemblies [i])) {
+			return &bundled_assemblies [i];
+		}
+	}
+
+	if (extra_bundled_assemblies != nullptr) {
+		for (XamarinAndroidBundledAssembly& assembly : *extra_bundled_assemblies) {
+			if (matches (assembly)) {
+				return &assembly;
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+// Does the part of `open_from_bundles` which doesn't involve Mono, ahead of the actual load: maps the assembly, reads
+// its pages in and decompresses it.  Runs on the assembly prefetch thread, see AssemblyPrefetch.
+bool
+EmbeddedAssemblies::prefetch_assembly (dynamic_local_string<SENSIBLE_PATH_MAX> const& name) noexcept
+{
+	uint8_t *data;
+	uint32_t data_size;
+
+	if (application_config.have_assembly_store) {
+		hash_t name_hash = xxhash::hash (name.get (), name.length ());
+		const AssemblyStoreIndexEntry *hash_entry = find_assembly_store_entry (name_hash, assembly_store_hashes, assembly_store.index_entry_count);
+		if (hash_entry == nullptr || hash_entry->descriptor_index >= assembly_store.assembly_count) {
+			return false;
+		}
+
+		AssemblyStoreEntryDescriptor const& store_entry = assembly_store.assemblies[hash_entry->descriptor_index];
+		data = assembly_store.data_start + store_entry.data_offset;
+		data_size = store_entry.data_size;
+	} else {
+		XamarinAndroidBundledAssembly *assembly = find_bundled_assembly (name);
+		if (assembly == nullptr) {
+			return false;
+		}
+
+		if (__atomic_load_n (&assembly->data, __ATOMIC_ACQUIRE) == nullptr) {
+			map_assembly (*assembly);
+		}
+		data = __atomic_load_n (&assembly->data, __ATOMIC_ACQUIRE);
+		data_size = assembly->data_size;
+	}
+
+	if (data == nullptr) {
+		return false;
+	}
+
+	// Fault the pages in here, instead of on the thread which loads the assembly
+	size_t page_size = static_cast<size_t>(Util::monodroid_getpagesize ());
+	for (size_t offset = 0; offset < data_size; offset += page_size) {
+		[[maybe_unused]] volatile uint8_t byte = data[offset];
+	}
+
+	uint8_t *assembly_data;
+	uint32_t assembly_data_size;
+	get_assembly_data (data, data_size, name.get (), assembly_data, assembly_data_size);
+
+	return true;
+}
+
 void
 EmbeddedAssemblies::install_preload_hooks_for_appdomains ()
 {
@@ -32,6 +32,7 @@ namespace xamarin::android::internal {
 #if defined (DEBUG)
 	struct TypeMappingInfo;
 #endif
+	class AssemblyLoadCostRecorder;
 
 #if defined (RELEASE)
 #define STATIC_IN_ANDROID_RELEASE static
@@ -180,6 +181,8 @@ namespace xamarin::android::internal {
 			abort_unless (assembly_store_hashes != nullptr, "Invalid or incomplete assembly store data");
 		}
 
+		bool prefetch_assembly (dynamic_local_string<SENSIBLE_PATH_MAX> const& name) noexcept;
+
 	private:
 		STATIC_IN_ANDROID_RELEASE const char* typemap_managed_to_java (MonoType *type, MonoClass *klass, const uint8_t *mvid) noexcept;
 		STATIC_IN_ANDROID_RELEASE MonoReflectionType* typemap_java_to_managed (hash_t hash, const MonoString *java_type_name) noexcept;
@@ -206,6 +209,7 @@ namespace xamarin::android::internal {
 		void map_runtime_file (XamarinAndroidBundledAssembly& file) noexcept;
 		void map_assembly (XamarinAndroidBundledAssembly& file) noexcept;
 		void map_debug_data (XamarinAndroidBundledAssembly& file) noexcept;
+		XamarinAndroidBundledAssembly* find_bundled_assembly (dynamic_local_string<SENSIBLE_PATH_MAX> const& name) noexcept;
 
 		template<LoaderData TLoaderData>
 		MonoAssembly* load_bundled_assembly (
@@ -213,7 +217,8 @@ namespace xamarin::android::internal {
 			dynamic_local_string<SENSIBLE_PATH_MAX> const& name,
 			dynamic_local_string<SENSIBLE_PATH_MAX> const& abi_name,
 			TLoaderData loader_data,
-			bool ref_only) noexcept;
+			bool ref_only,
+			AssemblyLoadCostRecorder &load_cost) noexcept;
 
 #if defined (DEBUG)
 		template<typename H>
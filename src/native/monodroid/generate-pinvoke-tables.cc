@@ -45,6 +45,7 @@ const std::vector<std::string> internal_pinvoke_names = {
 	"monodroid_fopen",
 	"monodroid_free",
 	"_monodroid_freeifaddrs",
+	"_monodroid_gc_bridge_get_stats",
 	"_monodroid_gc_wait_for_bridge_processing",
 	"_monodroid_get_android_api_level",
 	"_monodroid_get_dns_servers",
@@ -57,7 +58,9 @@ const std::vector<std::string> internal_pinvoke_names = {
 	"_monodroid_get_network_interface_up_state",
 	"monodroid_get_system_property",
 	"_monodroid_gref_get",
+	"_monodroid_gref_get_attribution",
 	"_monodroid_gref_log",
+	"_monodroid_gref_log_attribution",
 	"_monodroid_gref_log_delete",
 	"_monodroid_gref_log_new",
 	"monodroid_log",
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <dlfcn.h>
+
+#include "gref-attribution.hh"
+#include "logger.hh"
+#include "util.hh"
+#include "xxhash.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	constexpr char UNKNOWN_CLASS_NAME[] = "<unknown>";
+
+	// Handle values are indices into the JNI reference table with a few tag bits, mix them before using them to
+	// index the hash table
+	force_inline size_t
+	handle_slot (uintptr_t handle, size_t mask) noexcept
+	{
+		uint64_t h = static_cast<uint64_t>(handle) * 0x9E3779B97F4A7C15ULL;
+		return static_cast<size_t>(h >> 32) & mask;
+	}
+}
+
+void
+GrefAttribution::enable (JNIEnv *env, capture_frames_fn capture) noexcept
+{
+	jclass Class_class = env->FindClass ("java/lang/Class");
+	Class_getName = env->GetMethodID (Class_class, "getName", "()Ljava/lang/String;");
+	Class_hashCode = env->GetMethodID (Class_class, "hashCode", "()I"); // not overridden, it's the identity hash code
+	env->DeleteLocalRef (Class_class);
+
+	capture_frames = capture;
+	enabled = true;
+	log_info (LOG_GREF, "Global reference attribution enabled%s", capture == nullptr ? ", native stacks unavailable" : "");
+}
+
+// Returns a copy of the name allocated with `new[]`
+char*
+GrefAttribution::get_class_name (JNIEnv *env, jclass klass) noexcept
+{
+	auto class_name = reinterpret_cast<jstring>(env->CallObjectMethod (klass, Class_getName));
+	if (env->ExceptionCheck ()) [[unlikely]] {
+		env->ExceptionClear ();
+		return Util::strdup_new (UNKNOWN_CLASS_NAME);
+	}
+
+	char *name = nullptr;
+	const char *chars = env->GetStringUTFChars (class_name, nullptr);
+	if (chars != nullptr) {
+		name = Util::strdup_new (chars, std::min (strlen (chars), MAX_CLASS_NAME_LENGTH));
+		env->ReleaseStringUTFChars (class_name, chars);
+	}
+	env->DeleteLocalRef (class_name);
+
+	return name == nullptr ? Util::strdup_new (UNKNOWN_CLASS_NAME) : name;
+}
+
+// Must be called with `report_lock` held.  `obj` is a local reference, returns the id of the class of the object or 0
+// if it can't be looked at.
+uint32_t
+GrefAttribution::get_class_id (JNIEnv *env, jobject obj) noexcept
+{
+	jclass klass = env->GetObjectClass (obj);
+
+	jint hash = env->CallIntMethod (klass, Class_hashCode);
+	if (env->ExceptionCheck ()) [[unlikely]] {
+		env->ExceptionClear ();
+		env->DeleteLocalRef (klass);
+		return 0;
+	}
+
+	auto range = class_ids_by_hash.equal_range (hash);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		if (env->IsSameObject (classes[iter->second - 1].klass, klass)) {
+			env->DeleteLocalRef (klass);
+			return iter->second;
+		}
+	}
+
+	classes.push_back ({
+		.klass = reinterpret_cast<jclass>(env->NewGlobalRef (klass)),
+		.name = get_class_name (env, klass),
+	});
+	env->DeleteLocalRef (klass);
+
+	auto id = static_cast<uint32_t>(classes.size ());
+	class_ids_by_hash.emplace (hash, id);
+	return id;
+}
+
+// Returns the frames formatted one per line, allocated with `new[]`
+char*
+GrefAttribution::format_frames (uintptr_t const* frames, size_t frame_count) noexcept
+{
+	std::string text;
+	char line[512];
+
+	for (size_t i = 0; i < frame_count; i++) {
+		Dl_info info {};
+		int len;
+		if (dladdr (reinterpret_cast<void*>(frames[i]), &info) != 0 && info.dli_fname != nullptr) {
+			const char *lib = strrchr (info.dli_fname, '/');
+			lib = lib == nullptr ? info.dli_fname : lib + 1;
+			if (info.dli_sname != nullptr) {
+				len = snprintf (line, sizeof (line), "  #%02zu pc %016" PRIxPTR " %s (%s+%" PRIuPTR ")\n", i, frames[i], lib, info.dli_sname, frames[i] - reinterpret_cast<uintptr_t>(info.dli_saddr));
+			} else {
+				len = snprintf (line, sizeof (line), "  #%02zu pc %016" PRIxPTR " %s (offset %" PRIxPTR ")\n", i, frames[i], lib, frames[i] - reinterpret_cast<uintptr_t>(info.dli_fbase));
+			}
+		} else {
+			len = snprintf (line, sizeof (line), "  #%02zu pc %016" PRIxPTR "\n", i, frames[i]);
+		}
+		text.append (line, std::min (static_cast<size_t>(std::max (len, 0)), sizeof (line) - 1));
+	}
+
+	if (!text.empty ()) {
+		text.pop_back (); // the last newline
+	}
+	return Util::strdup_new (text.c_str (), text.length ());
+}
+
+// Must be called with `lock` held.  `stack_hash` identifies the stack, `from` is the managed stack if known.  Returns
+// site index + 1
+uint32_t
+GrefAttribution::find_or_add_site (uint64_t stack_hash, uintptr_t const* frames, size_t frame_count, const char *from) noexcept
+{
+	size_t from_length = from == nullptr ? 0 : strlen (from);
+
+	if (!site_index.empty ()) {
+		size_t mask = site_index.size () - 1;
+		for (size_t i = static_cast<size_t>(stack_hash) & mask; site_index[i] != 0; i = (i + 1) & mask) {
+			Site &s = sites[site_index[i] - 1];
+			if (s.stack_hash != stack_hash) {
+				continue;
+			}
+
+			// `gref` logging may have been enabled after the first reference was created by the stack.  The pointer
+			// handed out by `get_top_sites` must stay valid, so the stack is only set once.
+			if (s.stack == nullptr && from_length > 0) [[unlikely]] {
+				s.stack = Util::strdup_new (from, std::min (from_length, MAX_STACK_LENGTH));
+			}
+			return site_index[i];
+		}
+	}
+
+	uintptr_t *site_frames = nullptr;
+	if (frame_count > 0) {
+		site_frames = new uintptr_t[frame_count];
+		std::copy_n (frames, frame_count, site_frames);
+	}
+
+	sites.push_back ({
+		.stack_hash = stack_hash,
+		.stack = from_length == 0 ? nullptr : Util::strdup_new (from, std::min (from_length, MAX_STACK_LENGTH)),
+		.native_stack = nullptr,
+		.frames = site_frames,
+		.frame_count = static_cast<uint32_t>(frame_count),
+		.total_created = 0,
+	});
+	auto site = static_cast<uint32_t>(sites.size ());
+
+	// Keep the table at most half full
+	if (sites.size () * 2 > site_index.size ()) {
+		site_index.assign (site_index.empty () ? 256 : site_index.size () * 2, 0);
+		for (uint32_t i = 1; i < site; i++) {
+			size_t mask = site_index.size () - 1;
+			size_t j = static_cast<size_t>(sites[i - 1].stack_hash) & mask;
+			while (site_index[j] != 0) {
+				j = (j + 1) & mask;
+			}
+			site_index[j] = i;
+		}
+	}
+
+	size_t mask = site_index.size () - 1;
+	size_t i = static_cast<size_t>(stack_hash) & mask;
+	while (site_index[i] != 0) {
+		i = (i + 1) & mask;
+	}
+	site_index[i] = site;
+
+	return site;
+}
+
+// Must be called with `lock` held
+GrefAttribution::HandleEntry*
+GrefAttribution::find_handle (uintptr_t handle) noexcept
+{
+	if (handle_count == 0) {
+		return nullptr;
+	}
+
+	size_t mask = handles.size () - 1;
+	for (size_t i = handle_slot (handle, mask); handles[i].site != 0; i = (i + 1) & mask) {
+		if (handles[i].handle == handle) {
+			return &handles[i];
+		}
+	}
+
+	return nullptr;
+}
+
+// Must be called with `lock` held
+void
+GrefAttribution::add_handle (uintptr_t handle, uint32_t site, bool weak) noexcept
+{
+	// We may have missed the deletion of the previous reference with the same value
+	HandleEntry *existing = find_handle (handle);
+	if (existing != nullptr) [[unlikely]] {
+		remove_handle (existing);
+	}
+
+	if ((handle_count + 1) * 2 > handles.size ()) {
+		std::vector<HandleEntry> old_handles (handles.empty () ? 4096 : handles.size () * 2);
+		old_handles.swap (handles);
+
+		size_t mask = handles.size () - 1;
+		for (HandleEntry const& entry : old_handles) {
+			if (entry.site == 0) {
+				continue;
+			}
+
+			size_t i = handle_slot (entry.handle, mask);
+			while (handles[i].site != 0) {
+				i = (i + 1) & mask;
+			}
+			handles[i] = entry;
+		}
+	}
+
+	size_t mask = handles.size () - 1;
+	size_t i = handle_slot (handle, mask);
+	while (handles[i].site != 0) {
+		i = (i + 1) & mask;
+	}
+	handles[i] = { handle, site, weak };
+	handle_count++;
+	sites[site - 1].total_created++;
+}
+
+// Must be called with `lock` held
+void
+GrefAttribution::remove_handle (HandleEntry *entry) noexcept
+{
+	// Backward shift deletion, so that lookups don't need tombstones
+	size_t mask = handles.size () - 1;
+	size_t hole = static_cast<size_t>(entry - handles.data ());
+	size_t i = hole;
+	for (;;) {
+		i = (i + 1) & mask;
+		if (handles[i].site == 0) {
+			break;
+		}
+
+		size_t home = handle_slot (handles[i].handle, mask);
+		bool stays = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+		if (stays) {
+			continue;
+		}
+
+		handles[hole] = handles[i];
+		hole = i;
+	}
+
+	handles[hole] = {};
+	handle_count--;
+}
+
+void
+GrefAttribution::reference_created (jobject source, jobject handle, bool weak, const char *from) noexcept
+{
+	if (handle == nullptr) {
+		return;
+	}
+
+	if (source != nullptr) {
+		std::lock_guard<std::mutex> guard (lock);
+
+		HandleEntry *source_entry = find_handle (reinterpret_cast<uintptr_t>(source));
+		if (source_entry != nullptr) {
+			add_handle (reinterpret_cast<uintptr_t>(handle), source_entry->site, weak);
+			return;
+		}
+	}
+
+	// The stack is captured and hashed without holding the lock, it's the most expensive part of the whole thing
+	uintptr_t frames[MAX_FRAMES];
+	size_t frame_count = capture_frames == nullptr ? 0 : capture_frames (frames, MAX_FRAMES, nullptr);
+
+	uint64_t stack_hash;
+	if (frame_count > 0) [[likely]] {
+		stack_hash = xxhash64::hash (reinterpret_cast<const char*>(frames), frame_count * sizeof (uintptr_t));
+	} else {
+		size_t from_length = from == nullptr ? 0 : strlen (from);
+		stack_hash = from_length == 0 ? 0 : xxhash64::hash (from, from_length);
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+	uint32_t site = find_or_add_site (stack_hash, frames, frame_count, from);
+	add_handle (reinterpret_cast<uintptr_t>(handle), site, weak);
+}
+
+void
+GrefAttribution::reference_deleted (jobject handle) noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	HandleEntry *entry = find_handle (reinterpret_cast<uintptr_t>(handle));
+	if (entry != nullptr) {
+		remove_handle (entry);
+	}
+}
+
+size_t
+GrefAttribution::get_top_sites (JNIEnv *env, Entry *entries, size_t max_entries) noexcept
+{
+	// We mustn't make any JNI calls with an exception pending
+	if (entries == nullptr || max_entries == 0 || env == nullptr || env->ExceptionCheck ()) {
+		return 0;
+	}
+
+	struct Group
+	{
+		uint32_t  site;
+		uint32_t  class_id;
+		int32_t   live_grefs;
+		int32_t   live_weak_grefs;
+	};
+
+	std::lock_guard<std::mutex> report_guard (report_lock);
+
+	// `lock` isn't held while the classes are looked up, so that the references can be created and deleted meanwhile
+	std::vector<uintptr_t> live_handles;
+	{
+		std::lock_guard<std::mutex> guard (lock);
+
+		live_handles.reserve (handle_count);
+		for (HandleEntry const& entry : handles) {
+			if (entry.site != 0) {
+				live_handles.push_back (entry.handle);
+			}
+		}
+	}
+
+	std::vector<Group> groups;
+	std::unordered_map<uint64_t, size_t> group_index; // (site << 32 | class id) -> index into `groups`
+	HandleEntry batch[RESOLVE_BATCH_SIZE];
+	jobject objects[RESOLVE_BATCH_SIZE];
+
+	for (size_t start = 0; start < live_handles.size (); start += RESOLVE_BATCH_SIZE) {
+		size_t end = std::min (start + RESOLVE_BATCH_SIZE, live_handles.size ());
+		size_t batch_count = 0;
+
+		// A reference may be deleted as soon as `lock` is released, the local references keep the objects (if the
+		// weak references haven't lost them yet) alive until their classes are known
+		{
+			std::lock_guard<std::mutex> guard (lock);
+
+			for (size_t i = start; i < end; i++) {
+				HandleEntry *entry = find_handle (live_handles[i]);
+				if (entry == nullptr) {
+					continue; // deleted meanwhile
+				}
+
+				batch[batch_count] = *entry;
+				objects[batch_count] = env->NewLocalRef (reinterpret_cast<jobject>(entry->handle));
+				batch_count++;
+			}
+		}
+
+		for (size_t i = 0; i < batch_count; i++) {
+			uint32_t class_id = 0;
+			if (objects[i] != nullptr) {
+				class_id = get_class_id (env, objects[i]);
+				env->DeleteLocalRef (objects[i]);
+			}
+
+			HandleEntry const& entry = batch[i];
+			uint64_t key = (static_cast<uint64_t>(entry.site) << 32) | class_id;
+			auto [iter, added] = group_index.try_emplace (key, groups.size ());
+			if (added) {
+				groups.push_back ({ entry.site, class_id, 0, 0 });
+			}
+
+			Group &group = groups[iter->second];
+			if (entry.weak) {
+				group.live_weak_grefs++;
+			} else {
+				group.live_grefs++;
+			}
+		}
+	}
+
+	size_t count = std::min (max_entries, groups.size ());
+	std::partial_sort (
+		groups.begin (),
+		groups.begin () + static_cast<ptrdiff_t>(count),
+		groups.end (),
+		[](Group const& a, Group const& b) {
+			return static_cast<int64_t>(a.live_grefs) + a.live_weak_grefs > static_cast<int64_t>(b.live_grefs) + b.live_weak_grefs;
+		}
+	);
+
+	std::lock_guard<std::mutex> guard (lock);
+	for (size_t i = 0; i < count; i++) {
+		Group const& group = groups[i];
+		Site &s = sites[group.site - 1];
+		if (s.stack == nullptr && s.native_stack == nullptr && s.frame_count > 0) {
+			s.native_stack = format_frames (s.frames, s.frame_count);
+		}
+
+		entries[i] = {
+			.class_name = group.class_id == 0 ? UNKNOWN_CLASS_NAME : classes[group.class_id - 1].name,
+			.stack = s.stack != nullptr ? s.stack : s.native_stack,
+			.stack_hash = s.stack_hash,
+			.live_grefs = group.live_grefs,
+			.live_weak_grefs = group.live_weak_grefs,
+			.total_created = s.total_created,
+		};
+	}
+
+	return count;
+}
+
+void
+GrefAttribution::log_top_sites (JNIEnv *env, size_t count) noexcept
+{
+	std::vector<Entry> entries (count);
+	count = get_top_sites (env, entries.data (), count);
+
+	log_info_nocheck (LOG_GREF, "Top %zu global reference sites (live grefs, live weak grefs, total created):", count);
+	for (size_t i = 0; i < count; i++) {
+		Entry const& e = entries[i];
+		log_info_nocheck (
+			LOG_GREF,
+			"  %i %i %llu %s [stack %016llx]",
+			e.live_grefs,
+			e.live_weak_grefs,
+			static_cast<unsigned long long>(e.total_created),
+			e.class_name,
+			static_cast<unsigned long long>(e.stack_hash)
+		);
+		if (e.stack != nullptr) {
+			log_info_nocheck (LOG_GREF, "%s", e.stack);
+		}
+	}
+}
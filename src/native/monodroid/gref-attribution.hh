@@ -0,0 +1,120 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GREF_ATTRIBUTION_HH
+#define __GREF_ATTRIBUTION_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <jni.h>
+
+namespace xamarin::android::internal
+{
+	// Keeps track of the live global references grouped by "site": the Java class of the referenced object and the
+	// call stack which created the reference.  The stack is identified by the hash of the native return addresses
+	// captured when the reference is created (with the native tracing library, so it works whether or not `gref`
+	// logging is enabled), the managed stack passed to the gref logging functions with `debug.mono.log=gref` is shown
+	// along with it when known.  References created from another tracked reference (e.g. when the GC bridge turns a
+	// global reference into a weak one and back) are attributed to the site of the original one.  Enabled with the
+	// `gref-attribution` option of `debug.mono.log`.
+	//
+	// Creating a reference mustn't cost any JNI calls, so only the handle and the stack are recorded then.  The Java
+	// classes are looked up when the sites are requested (see `get_top_sites`), without blocking the threads which
+	// create or delete references meanwhile.  Class names are cached for the lifetime of the process.
+	class GrefAttribution
+	{
+		static constexpr size_t MAX_CLASS_NAME_LENGTH = 255;
+		static constexpr size_t MAX_STACK_LENGTH = 1023;
+		static constexpr size_t MAX_FRAMES = 32;
+		static constexpr size_t RESOLVE_BATCH_SIZE = 64;
+
+		// References created by the same call stack
+		struct Site
+		{
+			uint64_t   stack_hash;
+			char      *stack;         // managed stack, if known
+			char      *native_stack;  // `frames` formatted by `get_top_sites`, if `stack` isn't known
+			uintptr_t *frames;
+			uint32_t   frame_count;
+			uint64_t   total_created;
+		};
+
+		// Java class seen by `get_top_sites`, index + 1 is its id (0 stands for references whose object is gone)
+		struct ClassInfo
+		{
+			jclass    klass;      // global reference
+			char     *name;
+		};
+
+		// Site index is stored incremented by 1, so that 0 marks an empty slot
+		struct HandleEntry
+		{
+			uintptr_t  handle;
+			uint32_t   site;
+			bool       weak;
+		};
+
+	public:
+		// Same signature as `xa_capture_native_frames` of the native tracing library
+		using capture_frames_fn = size_t (*) (uintptr_t *frames, size_t max_frames, void *signal_context) noexcept;
+
+		// Snapshot of a single site, see `_monodroid_gref_get_attribution`.  The strings are owned by the runtime and
+		// remain valid for the lifetime of the process.
+		struct Entry
+		{
+			const char *class_name;
+			const char *stack;        // nullptr if neither the managed nor the native stack was known
+			uint64_t    stack_hash;
+			int32_t     live_grefs;
+			int32_t     live_weak_grefs;
+			uint64_t    total_created; // by the stack, for all the classes
+		};
+
+		static bool is_enabled () noexcept
+		{
+			return enabled;
+		}
+
+		// `capture` may be `nullptr` (e.g. if the native tracing library couldn't be loaded), the sites are then
+		// told apart only by the managed stacks passed to the gref logging functions
+		static void enable (JNIEnv *env, capture_frames_fn capture) noexcept;
+		static void reference_created (jobject source, jobject handle, bool weak, const char *from) noexcept;
+		static void reference_deleted (jobject handle) noexcept;
+
+		// Fills `entries` with up to `max_entries` sites with the most live references (global and weak global),
+		// returns the number of entries filled in.  Makes a few JNI calls for every live reference, with `lock` held
+		// only to create the local references which keep the objects alive while their classes are looked up.
+		static size_t get_top_sites (JNIEnv *env, Entry *entries, size_t max_entries) noexcept;
+		static void log_top_sites (JNIEnv *env, size_t count) noexcept;
+
+	private:
+		static char* get_class_name (JNIEnv *env, jclass klass) noexcept;
+		static uint32_t get_class_id (JNIEnv *env, jobject handle) noexcept;
+		static uint32_t find_or_add_site (uint64_t stack_hash, uintptr_t const* frames, size_t frame_count, const char *from) noexcept;
+		static char* format_frames (uintptr_t const* frames, size_t frame_count) noexcept;
+		static HandleEntry* find_handle (uintptr_t handle) noexcept;
+		static void add_handle (uintptr_t handle, uint32_t site, bool weak) noexcept;
+		static void remove_handle (HandleEntry *entry) noexcept;
+
+	private:
+		static inline bool                      enabled = false;
+		static inline jmethodID                 Class_getName = nullptr;
+		static inline jmethodID                 Class_hashCode = nullptr;
+		static inline capture_frames_fn         capture_frames = nullptr;
+		static inline std::mutex                lock;
+		static inline std::mutex                report_lock;  // serializes `get_top_sites`, protects `classes`
+
+		// Protected by `lock`
+		static inline std::vector<Site>         sites;
+		static inline std::vector<uint32_t>     site_index;   // hash table of `sites` indices + 1
+		static inline std::vector<HandleEntry>  handles;      // hash table, linear probing
+		static inline size_t                    handle_count = 0;
+
+		// Protected by `report_lock`
+		static inline std::vector<ClassInfo>    classes;
+		static inline std::unordered_multimap<jint, uint32_t> class_ids_by_hash; // identity hash code -> class id
+	};
+}
+#endif // ndef __GREF_ATTRIBUTION_HH
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <mono/metadata/mono-gc.h>
+
+#include "globals.hh"
+#include "gref-pressure.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	uint64_t
+	now_ns () noexcept
+	{
+		timespec ts;
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+	}
+
+	void
+	sleep_ms (uint64_t ms) noexcept
+	{
+		timespec ts {
+			.tv_sec = static_cast<time_t>(ms / 1000),
+			.tv_nsec = static_cast<long>((ms % 1000) * 1000000),
+		};
+
+		while (nanosleep (&ts, &ts) != 0 && errno == EINTR) {
+		}
+	}
+}
+
+void
+GrefPressureMonitor::configure (long max_gref_count) noexcept
+{
+	// `max_gref_count` is INT_MAX when the limit was disabled with debug.mono.max_grefc
+	if (!enabled || max_gref_count <= 0 || max_gref_count >= INT_MAX) {
+		enabled = false;
+		return;
+	}
+
+	if (high_percent > 100 || low_percent >= high_percent) {
+		log_warn (LOG_GC, "GREF pressure: invalid levels (low %u%%, high %u%%), using the defaults", low_percent, high_percent);
+		high_percent = 70;
+		low_percent = 50;
+	}
+
+	if (sem_init (&collection_requested, 0, 0) != 0) {
+		log_warn (LOG_GC, "GREF pressure: failed to initialize the semaphore. %s", strerror (errno));
+		enabled = false;
+		return;
+	}
+
+	high_level = static_cast<int>(max_gref_count * high_percent / 100);
+	low_level = static_cast<int>(max_gref_count * low_percent / 100);
+	next_sample_count = SAMPLE_STEP;
+	update_check_level ();
+}
+
+// Must be called with `busy` taken (or before any references are created)
+void
+GrefPressureMonitor::update_check_level () noexcept
+{
+	int level = armed ? std::min (next_sample_count, high_level) : INT_MAX;
+	__atomic_store_n (&check_level, level, __ATOMIC_RELAXED);
+}
+
+void
+GrefPressureMonitor::check_pressure () noexcept
+{
+	// If another thread is already at it, there's no need for two of us
+	if (__atomic_exchange_n (&busy, true, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	if (armed) {
+		int count = osBridge.get_gc_gref_count ();
+		uint64_t now = now_ns ();
+
+		if (count >= next_sample_count) {
+			if (last_sample_ns != 0 && count > last_sample_count && now > last_sample_ns) {
+				double rate = static_cast<double>(count - last_sample_count) * 1e9 / static_cast<double>(now - last_sample_ns);
+				growth_per_second = growth_per_second == 0 ? rate : (growth_per_second * 3 + rate) / 4;
+			}
+
+			last_sample_count = count;
+			last_sample_ns = now;
+			next_sample_count = count + SAMPLE_STEP;
+		}
+
+		if (count >= high_level) {
+			request_collection (count, false /* predicted */);
+		} else if (count >= low_level) {
+			double predicted = static_cast<double>(count) + growth_per_second * static_cast<double>(lead_ms) / 1000;
+			if (predicted >= high_level) {
+				request_collection (count, true /* predicted */);
+			}
+		}
+
+		update_check_level ();
+	}
+
+	__atomic_store_n (&busy, false, __ATOMIC_RELEASE);
+}
+
+// Must be called with `busy` taken
+void
+GrefPressureMonitor::request_collection (int count, bool predicted) noexcept
+{
+	armed = false;
+	last_trigger_count = count;
+
+	if (!thread_started) {
+		pthread_attr_t attr;
+		pthread_attr_init (&attr);
+		pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+		pthread_t thread;
+		int ret = pthread_create (&thread, &attr, collector_thread, nullptr);
+		pthread_attr_destroy (&attr);
+
+		// Stays disarmed, we won't be trying again
+		if (ret != 0) {
+			log_warn (LOG_GC, "GREF pressure: failed to create the collector thread. %s", strerror (ret));
+			return;
+		}
+
+		pthread_setname_np (thread, "XA gref GC");
+		thread_started = true;
+	}
+
+	if (predicted) {
+		log_info (
+			LOG_GC,
+			"GREF pressure: %d global references, growing by %.0f/s, requesting a collection",
+			count,
+			growth_per_second
+		);
+	} else {
+		log_info (LOG_GC, "GREF pressure: %d global references, requesting a collection", count);
+	}
+
+	sem_post (&collection_requested);
+}
+
+void*
+GrefPressureMonitor::collector_thread ([[maybe_unused]] void *arg) noexcept
+{
+	// Attaches the thread to the runtime (and, through the thread start hook, to the JVM which the GC bridge needs)
+	Util::get_current_domain (/* attach_thread_if_needed */ true);
+
+	const int repeat_growth = std::max ((high_level - low_level) / 2, 1);
+
+	for (;;) {
+		while (sem_wait (&collection_requested) != 0 && errno == EINTR) {
+		}
+
+		int trigger_count = last_trigger_count;
+		for (;;) {
+			if (last_collection_ns != 0) {
+				uint64_t since_last_ms = (now_ns () - last_collection_ns) / 1000000;
+				if (since_last_ms < min_interval_ms) {
+					sleep_ms (min_interval_ms - since_last_ms);
+				}
+			}
+
+			int before = osBridge.get_gc_gref_count ();
+			uint64_t start = now_ns ();
+			mono_gc_collect (mono_gc_max_generation ());
+			last_collection_ns = now_ns ();
+			collection_count++;
+
+			log_info (
+				LOG_GC,
+				"GREF pressure: collection #%d took %llu ms, global references: %d before, %d after",
+				collection_count,
+				static_cast<unsigned long long>((last_collection_ns - start) / 1000000),
+				before,
+				osBridge.get_gc_gref_count ()
+			);
+
+			// References of the collected peers are released gradually (e.g. by the finalizers), give them time
+			// before deciding whether another collection is needed
+			int count;
+			do {
+				sleep_ms (min_interval_ms);
+				count = osBridge.get_gc_gref_count ();
+			} while (count > low_level && count < trigger_count + repeat_growth);
+
+			if (count <= low_level) {
+				break;
+			}
+			trigger_count = count;
+		}
+
+		while (__atomic_exchange_n (&busy, true, __ATOMIC_ACQUIRE)) {
+			sched_yield ();
+		}
+
+		// Growth rate measured before the collection says nothing about the future one
+		armed = true;
+		growth_per_second = 0;
+		last_sample_ns = 0;
+		next_sample_count = osBridge.get_gc_gref_count () + SAMPLE_STEP;
+		update_check_level ();
+
+		__atomic_store_n (&busy, false, __ATOMIC_RELEASE);
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,84 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GREF_PRESSURE_HH
+#define __GREF_PRESSURE_HH
+
+#include <climits>
+#include <cstdint>
+
+#include <semaphore.h>
+
+#include "platform-compat.hh"
+
+namespace xamarin::android::internal
+{
+	// Runs a full Mono collection on a background thread when the process is getting close to the global reference
+	// limit, so that the Java peers which are no longer used release their global references before the managed
+	// `gref_gc_threshold` check has to block the thread creating a reference (or before the limit is hit).
+	//
+	// The collection is requested when the number of global references reaches `high_percent` of the limit, or when,
+	// at the current growth rate, it is predicted to get there within `lead_ms` (but only if it's above `low_percent`
+	// already).  After a collection, no new one is requested until the number of global references drops below
+	// `low_percent` of the limit again, unless it keeps growing: the collection is then repeated every time it grows by
+	// half of the `high_percent - low_percent` range.  At least `min_interval_ms` passes between two collections.
+	//
+	// Off unless enabled with the `gref-pressure=on` option of `debug.mono.gc_bridge`, since it changes when full
+	// collections happen.
+	class GrefPressureMonitor
+	{
+		static constexpr int SAMPLE_STEP = 256; // new references between growth rate samples
+
+	public:
+		static inline bool      enabled = false;
+		static inline uint32_t  high_percent = 70;
+		static inline uint32_t  low_percent = 50;
+		static inline uint64_t  lead_ms = 2000;
+		static inline uint64_t  min_interval_ms = 1000;
+
+		static void configure (long max_gref_count) noexcept;
+
+		// Lowest number of global references at which the monitor may request a collection, INT_MAX if disabled
+		static int get_low_level () noexcept
+		{
+			return enabled ? low_level : INT_MAX;
+		}
+
+		// `count` is the (approximate) number of global references after creating one
+		force_inline static void gref_created (int count) noexcept
+		{
+			if (count < __atomic_load_n (&check_level, __ATOMIC_RELAXED)) [[likely]] {
+				return;
+			}
+
+			check_pressure ();
+		}
+
+	private:
+		static void check_pressure () noexcept;
+		static void request_collection (int count, bool predicted) noexcept;
+		static void* collector_thread (void *arg) noexcept;
+		static void update_check_level () noexcept;
+
+	private:
+		// Creations of references below this level take the fast path
+		static inline int       check_level = INT_MAX;
+
+		static inline int       high_level = INT_MAX;
+		static inline int       low_level = INT_MAX;
+		static inline bool      busy = false;         // taken by the thread in `check_pressure`
+		static inline bool      armed = true;
+		static inline bool      thread_started = false;
+		static inline sem_t     collection_requested;
+
+		// Protected by `busy`
+		static inline int       next_sample_count = 0;
+		static inline int       last_sample_count = 0;
+		static inline uint64_t  last_sample_ns = 0;
+		static inline double    growth_per_second = 0;
+
+		// Used only by the collector thread
+		static inline int       collection_count = 0;
+		static inline int       last_trigger_count = 0;
+		static inline uint64_t  last_collection_ns = 0;
+	};
+}
+#endif // ndef __GREF_PRESSURE_HH
@@ -0,0 +1,216 @@
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <unistd.h>
+
+#include <mono/metadata/class.h>
+
+#include "jit-event-log.hh"
+#include "logger.hh"
+#include "util.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	force_inline uint64_t
+	now_ns () noexcept
+	{
+		timespec ts;
+		if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0) [[unlikely]] {
+			return 0;
+		}
+
+		return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL) + static_cast<uint64_t>(ts.tv_nsec);
+	}
+
+	template<typename T>
+	force_inline void
+	write_value (FILE *file, T const& value) noexcept
+	{
+		fwrite (&value, sizeof (value), 1, file);
+	}
+}
+
+void
+JitEventLog::start (const char *path) noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	if (enabled) {
+		return;
+	}
+
+	file = Util::monodroid_fopen (path, "w");
+	if (file == nullptr) {
+		return;
+	}
+	Util::set_world_accessable (path);
+
+	JitLogBinaryHeader header {};
+	memcpy (header.magic, JitLogBinaryHeader::MAGIC, sizeof (header.magic));
+	header.version = JitLogBinaryHeader::VERSION;
+	header.start_ns = now_ns ();
+	write_value (file, header);
+
+	buffers.reserve (MAX_BUFFERS);
+	atexit (flush);
+	enabled = true;
+
+	log_info (LOG_TIMING, "JIT events are logged to %s, in the binary format", path);
+}
+
+void
+JitEventLog::record (MonoMethod *method, JitEventKind kind) noexcept
+{
+	uint64_t timestamp = now_ns ();
+
+	Buffer *buffer = thread_buffer;
+	if (buffer == nullptr || buffer->used.load (std::memory_order_relaxed) >= EVENTS_PER_BUFFER) [[unlikely]] {
+		buffer = acquire_buffer ();
+		if (buffer == nullptr) {
+			dropped.fetch_add (1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	size_t index = buffer->used.load (std::memory_order_relaxed);
+	JitLogBinaryEvent &event = buffer->events[index];
+
+	event.timestamp_ns = timestamp;
+	event.method_token = mono_method_get_token (method);
+	event.name_id = event.method_token == 0 ? get_name_id (method) : 0;
+	event.image_id = get_image_id (mono_class_get_image (mono_method_get_class (method)));
+	event.kind = kind;
+
+	buffer->used.store (index + 1, std::memory_order_release);
+}
+
+// Called when the thread has no buffer yet or its buffer is full.  Full buffers stay where they are until they are
+// flushed, they're never reused.
+JitEventLog::Buffer*
+JitEventLog::acquire_buffer () noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	if (buffers.size () >= MAX_BUFFERS) {
+		return nullptr;
+	}
+
+	auto buffer = new Buffer {};
+	buffer->thread_id = gettid ();
+	buffers.push_back (buffer);
+	thread_buffer = buffer;
+
+	return buffer;
+}
+
+uint32_t
+JitEventLog::get_image_id (MonoImage *image) noexcept
+{
+	if (image == last_image) [[likely]] {
+		return last_image_id;
+	}
+
+	uint32_t id = 0;
+	{
+		std::lock_guard<std::mutex> guard (lock);
+
+		for (size_t i = 0; i < images.size (); i++) {
+			if (images[i].image == image) {
+				id = static_cast<uint32_t>(i + 1);
+				break;
+			}
+		}
+
+		if (id == 0) {
+			const char *name = image == nullptr ? nullptr : mono_image_get_name (image);
+			const char *mvid = image == nullptr ? nullptr : mono_image_get_guid (image);
+
+			images.push_back ({ image, Util::strdup_new (name == nullptr ? "" : name), Util::strdup_new (mvid == nullptr ? "" : mvid) });
+			id = static_cast<uint32_t>(images.size ());
+		}
+	}
+
+	last_image = image;
+	last_image_id = id;
+	return id;
+}
+
+// Methods without a token are rare enough (wrappers, dynamic methods) to afford formatting their names while the event
+// is recorded, once per method
+uint32_t
+JitEventLog::get_name_id (MonoMethod *method) noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	auto iter = method_name_ids.find (method);
+	if (iter != method_name_ids.end ()) {
+		return iter->second;
+	}
+
+	char *name = mono_method_full_name (method, 1);
+	method_names.push_back (Util::strdup_new (name == nullptr ? "" : name));
+	free (name);
+
+	auto id = static_cast<uint32_t>(method_names.size ());
+	method_name_ids.emplace (method, id);
+	return id;
+}
+
+void
+JitEventLog::write_string (uint32_t value_length, const char *value) noexcept
+{
+	write_value (file, value_length);
+	fwrite (value, 1, value_length, file);
+}
+
+void
+JitEventLog::flush () noexcept
+{
+	if (!enabled) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+
+	for (; images_written < images.size (); images_written++) {
+		ImageInfo const& info = images[images_written];
+
+		write_value (file, JitLogBinaryTag::Image);
+		write_value (file, static_cast<uint32_t>(images_written + 1));
+		write_string (static_cast<uint32_t>(strlen (info.name)), info.name);
+		write_string (static_cast<uint32_t>(strlen (info.mvid)), info.mvid);
+	}
+
+	for (; method_names_written < method_names.size (); method_names_written++) {
+		const char *name = method_names[method_names_written];
+
+		write_value (file, JitLogBinaryTag::String);
+		write_value (file, static_cast<uint32_t>(method_names_written + 1));
+		write_string (static_cast<uint32_t>(strlen (name)), name);
+	}
+
+	for (Buffer *buffer : buffers) {
+		size_t used = buffer->used.load (std::memory_order_acquire);
+		if (used == buffer->flushed) {
+			continue;
+		}
+
+		write_value (file, JitLogBinaryTag::Events);
+		write_value (file, static_cast<int32_t>(buffer->thread_id));
+		write_value (file, static_cast<uint32_t>(used - buffer->flushed));
+		fwrite (&buffer->events[buffer->flushed], sizeof (JitLogBinaryEvent), used - buffer->flushed, file);
+		buffer->flushed = used;
+	}
+
+	uint64_t dropped_now = dropped.load (std::memory_order_relaxed);
+	if (dropped_now != dropped_written) {
+		write_value (file, JitLogBinaryTag::Dropped);
+		write_value (file, dropped_now);
+		dropped_written = dropped_now;
+	}
+
+	fflush (file);
+}
@@ -0,0 +1,131 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __JIT_EVENT_LOG_HH
+#define __JIT_EVENT_LOG_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <mono/metadata/image.h>
+#include <mono/metadata/object.h>
+
+namespace xamarin::android::internal
+{
+	enum class JitEventKind : uint8_t
+	{
+		Begin  = 0,
+		Done   = 1,
+		Failed = 2,
+	};
+
+	// Binary JIT event log format, used with the `jit-binary` option of `debug.mono.log` (decoded on the host with
+	// tools/jit-times).  All values are little-endian.  The file starts with a JitLogBinaryHeader, followed by a
+	// sequence of entries, each of them starting with a single JitLogBinaryTag byte:
+	//
+	//   Image:    uint32 id, uint32 length, image name, uint32 length, image MVID (as returned by `mono_image_get_guid`)
+	//   String:   uint32 id, uint32 length, the string
+	//   Events:   int32 thread id, uint32 count, `count` JitLogBinaryEvent structures
+	//   Dropped:  uint64 number of events dropped so far
+	//
+	// Strings hold the full names of the methods which have no metadata token (e.g. wrappers and dynamic methods), all
+	// the other names are resolved on the host from the token and the image.  Image and string entries always precede
+	// the events which refer to them, events of a single thread are stored in the order they were recorded.
+	enum class JitLogBinaryTag : uint8_t
+	{
+		Image   = 1,
+		String  = 2,
+		Events  = 3,
+		Dropped = 4,
+	};
+
+	struct JitLogBinaryHeader
+	{
+		static constexpr char MAGIC[] = "XAJITLOG";
+		static constexpr uint32_t VERSION = 1;
+
+		char      magic[8];
+		uint32_t  version;
+		uint32_t  reserved;
+		uint64_t  start_ns;   // CLOCK_MONOTONIC, event times are reported relative to it
+	};
+
+	struct JitLogBinaryEvent
+	{
+		uint64_t      timestamp_ns;  // CLOCK_MONOTONIC
+		uint32_t      method_token;  // 0 if the method has no token
+		uint32_t      name_id;       // id of the method's full name if it has no token, 0 otherwise
+		uint32_t      image_id;
+		JitEventKind  kind;
+		uint8_t       reserved[3];
+	};
+	static_assert (sizeof (JitLogBinaryEvent) == 24);
+
+	// Records the JIT begin/done/failed events into per-thread buffers, instead of formatting the method name and
+	// writing it to `methods.txt` on the JIT thread.  Recording an event takes a timestamp, the method token and the
+	// image (looked up in a small cache, the global image table is consulted only for an image the thread hasn't seen
+	// last).  The buffers are written to the file by `flush`, called when the timing data is dumped and at exit.
+	// Memory use is bounded, events which don't fit into MAX_BUFFERS buffers are dropped and counted.
+	class JitEventLog
+	{
+		static constexpr size_t EVENTS_PER_BUFFER = 1024;
+		static constexpr size_t MAX_BUFFERS = 1024;
+
+		// Written only by the owning thread, `used` is published with release semantics for `flush`
+		struct Buffer
+		{
+			pid_t               thread_id;
+			std::atomic_size_t  used;
+			size_t              flushed;   // protected by `lock`
+			JitLogBinaryEvent   events[EVENTS_PER_BUFFER];
+		};
+
+		struct ImageInfo
+		{
+			MonoImage  *image;
+			char       *name;
+			char       *mvid;
+		};
+
+	public:
+		static bool is_enabled () noexcept
+		{
+			return enabled;
+		}
+
+		static void start (const char *path) noexcept;
+		static void record (MonoMethod *method, JitEventKind kind) noexcept;
+		static void flush () noexcept;
+
+	private:
+		static Buffer* acquire_buffer () noexcept;
+		static uint32_t get_image_id (MonoImage *image) noexcept;
+		static uint32_t get_name_id (MonoMethod *method) noexcept;
+		static void write_string (uint32_t value_length, const char *value) noexcept;
+
+	private:
+		static inline bool                    enabled = false;
+		static inline std::atomic_uint64_t    dropped = 0;
+		static inline std::mutex              lock;
+
+		// All below protected by `lock`
+		static inline FILE                                     *file = nullptr;
+		static inline std::vector<Buffer*>                      buffers;
+		static inline std::vector<ImageInfo>                    images;         // id is the index + 1
+		static inline size_t                                    images_written = 0;
+		static inline std::unordered_map<MonoMethod*, uint32_t> method_name_ids;
+		static inline std::vector<char*>                        method_names;   // id is the index + 1
+		static inline size_t                                    method_names_written = 0;
+		static inline uint64_t                                  dropped_written = 0;
+
+		static inline thread_local Buffer    *thread_buffer = nullptr;
+		static inline thread_local MonoImage *last_image = nullptr;
+		static inline thread_local uint32_t   last_image_id = 0;
+	};
+}
+#endif // ndef __JIT_EVENT_LOG_HH
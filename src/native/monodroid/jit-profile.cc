@@ -0,0 +1,261 @@
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+#include <mono/metadata/blob.h>
+#include <mono/metadata/class.h>
+#include <mono/metadata/debug-helpers.h>
+#include <mono/metadata/image.h>
+#include <mono/metadata/loader.h>
+#include <mono/metadata/metadata.h>
+
+#include "jit-profile.hh"
+#include "logger.hh"
+#include "util.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	// Record types of the AOT profile format, must be kept in sync with `AotProfRecordType` in Mono's
+	// mono/profiler/aot.h
+	enum class AotProfileRecord : uint8_t
+	{
+		None            = 0,
+		Image           = 1,
+		Type            = 2,
+		GenericInstance = 3,
+		Method          = 4,
+	};
+
+	// Writes a profile in the format produced by Mono's AOT profiler: the "AOTPROFILE" magic and an int32 version,
+	// followed by records which start with the byte record type and an int32 id.  Records refer to previously written
+	// ones by their id, the last record has the None type.  Integers are little-endian, strings are stored as the int32
+	// length followed by the (not terminated) UTF-8 bytes.
+	//
+	//   Image:   name, MVID
+	//   Type:    byte MONO_TYPE_CLASS, int32 image id, int32 generic instance id (-1 if none), full type name
+	//   Method:  int32 class id, int32 generic instance id (-1 if none), int32 parameter count, name, signature
+	class AotProfileWriter
+	{
+		static constexpr char MAGIC[] = "AOTPROFILE";
+		static constexpr int32_t VERSION = (1 << 16) | 0;
+
+	public:
+		explicit AotProfileWriter (FILE *file) noexcept
+			: file (file)
+		{
+			fwrite (MAGIC, 1, sizeof (MAGIC) - 1, file);
+			write_int32 (VERSION);
+		}
+
+		// Returns `false` if the method can't be stored in the profile
+		bool add_method (MonoMethod *method) noexcept
+		{
+			MonoMethodSignature *signature = mono_method_signature (method);
+			if (signature == nullptr) {
+				return false;
+			}
+
+			int32_t class_id = add_class (mono_method_get_class (method));
+			if (class_id < 0) {
+				return false;
+			}
+
+			char *signature_name = mono_signature_full_name (signature);
+			if (signature_name == nullptr) {
+				return false;
+			}
+
+			write_record (AotProfileRecord::Method);
+			write_int32 (class_id);
+			write_int32 (-1);
+			write_int32 (static_cast<int32_t>(mono_signature_get_param_count (signature)));
+			write_string (mono_method_get_name (method));
+			write_string (signature_name);
+			free (signature_name);
+
+			return true;
+		}
+
+		void finish () noexcept
+		{
+			fputc (static_cast<int>(AotProfileRecord::None), file);
+			write_int32 (0);
+		}
+
+	private:
+		int32_t add_image (MonoImage *image) noexcept
+		{
+			auto iter = image_ids.find (image);
+			if (iter != image_ids.end ()) {
+				return iter->second;
+			}
+
+			// Dynamic images have no MVID and couldn't be AOT-compiled anyway
+			const char *mvid = mono_image_get_guid (image);
+			int32_t id = -1;
+			if (mvid != nullptr && *mvid != '\0') {
+				id = write_record (AotProfileRecord::Image);
+				write_string (mono_image_get_name (image));
+				write_string (mvid);
+			}
+
+			image_ids.emplace (image, id);
+			return id;
+		}
+
+		// Instances of generic types can't be described without access to their type arguments, which the public Mono
+		// API doesn't provide.  The methods of generic types are skipped, the type names of which contain a backtick.
+		int32_t add_class (MonoClass *klass) noexcept
+		{
+			auto iter = class_ids.find (klass);
+			if (iter != class_ids.end ()) {
+				return iter->second;
+			}
+
+			int32_t id = -1;
+			MonoClass *nesting_class = mono_class_get_nesting_type (klass);
+			const char *name = mono_class_get_name (klass);
+			const char *outer_name = nesting_class == nullptr ? nullptr : mono_class_get_name (nesting_class);
+
+			if (strchr (name, '`') == nullptr && (outer_name == nullptr || strchr (outer_name, '`') == nullptr)) {
+				int32_t image_id = add_image (mono_class_get_image (klass));
+
+				if (image_id >= 0) {
+					dynamic_local_string<SENSIBLE_TYPE_NAME_LENGTH> full_name;
+					full_name
+						.append_c (mono_class_get_namespace (nesting_class == nullptr ? klass : nesting_class))
+						.append (".");
+					if (nesting_class != nullptr) {
+						full_name.append_c (outer_name).append ("/");
+					}
+					full_name.append_c (name);
+
+					id = write_record (AotProfileRecord::Type);
+					fputc (MONO_TYPE_CLASS, file);
+					write_int32 (image_id);
+					write_int32 (-1);
+					write_string (full_name.get ());
+				}
+			}
+
+			class_ids.emplace (klass, id);
+			return id;
+		}
+
+		int32_t write_record (AotProfileRecord type) noexcept
+		{
+			int32_t id = next_id++;
+
+			fputc (static_cast<int>(type), file);
+			write_int32 (id);
+			return id;
+		}
+
+		void write_int32 (int32_t value) noexcept
+		{
+			fwrite (&value, sizeof (value), 1, file);
+		}
+
+		void write_string (const char *value) noexcept
+		{
+			size_t length = value == nullptr ? 0 : strlen (value);
+
+			write_int32 (static_cast<int32_t>(length));
+			fwrite (value, 1, length, file);
+		}
+
+	private:
+		FILE                                   *file;
+		int32_t                                 next_id = 0;
+		std::unordered_map<MonoImage*, int32_t> image_ids;
+		std::unordered_map<MonoClass*, int32_t> class_ids;
+	};
+}
+
+void
+JitProfile::start (const char *dir) noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	directory = dir;
+	methods.reserve (4096);
+	recorded_methods.reserve (4096);
+	enabled = true;
+}
+
+// Wrappers and dynamic methods have no token, there's no way to refer to them in the profile
+void
+JitProfile::record (MonoMethod *method) noexcept
+{
+	if (mono_method_get_token (method) == 0) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+	if (recorded_methods.insert (method).second) {
+		methods.push_back (method);
+	}
+}
+
+void
+JitProfile::write () noexcept
+{
+	if (!enabled) {
+		return;
+	}
+
+	// Only one writer at a time, but the JIT threads must not wait for the profiles to be written
+	std::lock_guard<std::mutex> write_guard (write_lock);
+
+	std::vector<MonoMethod*> profile_methods;
+	bool write_startup_profile;
+	{
+		std::lock_guard<std::mutex> guard (lock);
+
+		write_startup_profile = !startup_window_closed;
+		if (write_startup_profile) {
+			startup_window_closed = true;
+			startup_method_count = methods.size ();
+		}
+		profile_methods = methods;
+	}
+
+	if (write_startup_profile) {
+		std::vector<MonoMethod*> startup_methods (profile_methods.begin (), profile_methods.begin () + static_cast<ptrdiff_t>(startup_method_count));
+		write_profile (STARTUP_PROFILE_NAME, startup_methods);
+	}
+	write_profile (FULL_PROFILE_NAME, profile_methods);
+}
+
+void
+JitProfile::write_profile (const char *file_name, std::vector<MonoMethod*> const& profile_methods) noexcept
+{
+	std::unique_ptr<char> path {Util::path_combine (directory, file_name)};
+
+	FILE *file = Util::monodroid_fopen (path.get (), "w");
+	if (file == nullptr) {
+		return;
+	}
+
+	AotProfileWriter writer (file);
+	size_t skipped = 0;
+	for (MonoMethod *method : profile_methods) {
+		if (!writer.add_method (method)) {
+			skipped++;
+		}
+	}
+	writer.finish ();
+	fclose (file);
+	Util::set_world_accessable (path.get ());
+
+	log_info_nocheck (
+		LOG_DEFAULT,
+		"JIT profile: %zu methods written to %s (%zu methods of generic types or dynamic assemblies skipped)",
+		profile_methods.size () - skipped,
+		path.get (),
+		skipped
+	);
+}
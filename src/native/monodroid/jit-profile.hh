@@ -0,0 +1,52 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __JIT_PROFILE_HH
+#define __JIT_PROFILE_HH
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include <mono/metadata/object.h>
+
+namespace xamarin::android::internal
+{
+	// Collects the methods compiled by the JIT, used with the `jit-profile` option of `debug.mono.log`.  The methods are
+	// written in the format of Mono's AOT profiler, so the files can be used as `@(AndroidAotProfile)` items (or
+	// inspected with `aprofutil`) to AOT-compile exactly the methods which had to be JIT-compiled on the device.
+	//
+	// The first `mono.android.app.DUMP_TIMING_DATA` broadcast closes the startup window: the methods compiled until then
+	// are written to `startup.aprof`, which isn't modified afterwards.  Every broadcast writes all the methods compiled
+	// so far to `jit.aprof`, in the order in which they were compiled, so the startup methods come first.
+	class JitProfile
+	{
+		static constexpr char STARTUP_PROFILE_NAME[] = "startup.aprof";
+		static constexpr char FULL_PROFILE_NAME[] = "jit.aprof";
+
+	public:
+		static bool is_enabled () noexcept
+		{
+			return enabled;
+		}
+
+		static void start (const char *dir) noexcept;
+		static void record (MonoMethod *method) noexcept;
+		static void write () noexcept;
+
+	private:
+		static void write_profile (const char *file_name, std::vector<MonoMethod*> const& profile_methods) noexcept;
+
+	private:
+		static inline bool        enabled = false;
+		static inline const char *directory = nullptr;
+		static inline std::mutex  write_lock;
+
+		// All below protected by `lock`
+		static inline std::mutex                      lock;
+		static inline std::vector<MonoMethod*>        methods;
+		static inline std::unordered_set<MonoMethod*> recorded_methods;
+		static inline size_t                          startup_method_count = 0;
+		static inline bool                            startup_window_closed = false;
+	};
+}
+#endif // ndef __JIT_PROFILE_HH
@@ -7,6 +7,9 @@
 
 #include <jni.h>
 #include "android-system.hh"
+#include "gref-attribution.hh"
+#include "jit-event-log.hh"
+#include "jit-profile.hh"
 #include "osbridge.hh"
 #include "timing.hh"
 #include "cpp-util.hh"
@@ -158,6 +161,19 @@ namespace xamarin::android::internal
 		static constexpr std::string_view xamarin_native_tracing_name { "libxamarin-native-tracing.so" };
 		static constexpr hash_t xamarin_native_tracing_name_hash = xxhash::hash (xamarin_native_tracing_name);
 
+		// Maximum number of DSO names accepted in the `debug.mono.dso_warmup` property
+		static constexpr size_t MAX_DSO_WARMUP_NAMES = 32;
+
+		// Written to the override directory, see `debug.mono.native_profiler`
+		static constexpr std::string_view NATIVE_PROFILE_FILE_NAME { "native-profile.txt" };
+
+		enum class DSOWarmupMode
+		{
+			All,
+			AotImages,
+			Names,
+		};
+
 	public:
 		static constexpr int XA_LOG_COUNTERS = MONO_COUNTER_JIT | MONO_COUNTER_METADATA | MONO_COUNTER_GC | MONO_COUNTER_GENERICS | MONO_COUNTER_INTERP;
 
@@ -175,6 +191,19 @@ namespace xamarin::android::internal
 			return startup_in_progress;
 		}
 
+		// Startup normally runs on the main thread only, which lets it skip locking.  Threads started during startup
+		// which touch the same data (e.g. the assembly prefetch thread) must call `set_startup_multithreaded` before
+		// they are created.
+		static bool is_startup_single_threaded () noexcept
+		{
+			return startup_in_progress && !startup_multithreaded;
+		}
+
+		static void set_startup_multithreaded () noexcept
+		{
+			startup_multithreaded = true;
+		}
+
 		int get_android_api_level () const
 		{
 			return android_api_level;
@@ -203,10 +232,14 @@ namespace xamarin::android::internal
 		void propagate_uncaught_exception (JNIEnv *env, jobject javaThread, jthrowable javaException);
 		char*	get_java_class_name_for_TypeManager (jclass klass);
 		void log_traces (JNIEnv *env, TraceKind kind, const char *first_line) noexcept;
+		static void start_native_profiler () noexcept;
+		static void write_native_profile () noexcept;
+		static GrefAttribution::capture_frames_fn get_native_frames_capture () noexcept;
 
 	private:
 		static void mono_log_handler (const char *log_domain, const char *log_level, const char *message, mono_bool fatal, void *user_data);
 		static void mono_log_standard_streams_handler (const char *str, mono_bool is_stdout);
+		static void init_native_tracing () noexcept;
 
 		// A reference to unique_ptr is not the best practice ever, but it's faster this way
 		void setup_mono_tracing (std::unique_ptr<char[]> const& mono_log_mask, bool have_log_assembly, bool have_log_gc);
@@ -243,7 +276,11 @@ namespace xamarin::android::internal
 		static void* monodroid_dlopen (const char *name, int flags, char **err, void *user_data) noexcept;
 		static void* monodroid_dlsym (void *handle, const char *name, char **err, void *user_data);
 		static void* monodroid_dlopen_log_and_return (void *handle, char **err, const char *full_name, bool free_memory, bool need_api_init = false);
+		static void* monodroid_dlopen_cache_entry (DSOCacheEntry *dso, const char *name, int flags) noexcept;
 		static DSOCacheEntry* find_dso_cache_entry (hash_t hash) noexcept;
+		static void start_dso_warmup () noexcept;
+		static bool dso_warmup_wanted (DSOCacheEntry const& dso, DSOWarmupMode mode, const hash_t *name_hashes, size_t name_hash_count) noexcept;
+		static void* dso_warmup_thread (void *arg) noexcept;
 
 		int LocalRefsAreIndirect (JNIEnv *env, jclass runtimeClass, int version);
 		void create_xdg_directory (jstring_wrapper& home, size_t home_len, std::string_view const& relative_path, std::string_view const& environment_variable_name) noexcept;
@@ -284,7 +321,7 @@ namespace xamarin::android::internal
 		void set_trace_options ();
 		void set_profile_options ();
 
-		void log_jit_event (MonoMethod *method, const char *event_name);
+		void log_jit_event (MonoMethod *method, JitEventKind kind, const char *event_name);
 		static void jit_begin (MonoProfiler *prof, MonoMethod *method);
 		static void jit_failed (MonoProfiler *prof, MonoMethod *method);
 		static void jit_done (MonoProfiler *prof, MonoMethod *method, MonoJitInfo* jinfo);
@@ -342,6 +379,7 @@ namespace xamarin::android::internal
 		 */
 		int                 current_context_id = -1;
 		static bool         startup_in_progress;
+		static bool         startup_multithreaded;
 
 		jnienv_register_jni_natives_fn jnienv_register_jni_natives = nullptr;
 		MonoAssemblyLoadContextGCHandle default_alc = nullptr;
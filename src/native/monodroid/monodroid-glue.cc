@@ -51,6 +51,8 @@
 
 //#include "monodroid.h"
 #include "util.hh"
+#include "assembly-load-stats.hh"
+#include "assembly-prefetch.hh"
 #include "debug.hh"
 #include "embedded-assemblies.hh"
 #include "monodroid-glue.hh"
@@ -61,6 +63,8 @@
 //#include "xa-internal-api-impl.hh"
 #include "build-info.hh"
 #include "monovm-properties.hh"
+#include "gref-attribution.hh"
+#include "ref-log-writer.hh"
 #include "startup-aware-lock.hh"
 #include "timing-internal.hh"
 #include "search.hh"
@@ -88,6 +92,7 @@ MonoCoreRuntimeProperties MonodroidRuntime::monovm_core_properties = {
 
 std::mutex MonodroidRuntime::dso_handle_write_lock;
 bool MonodroidRuntime::startup_in_progress = true;
+bool MonodroidRuntime::startup_multithreaded = false;
 
 void
 MonodroidRuntime::thread_start ([[maybe_unused]] MonoProfiler *prof, [[maybe_unused]] uintptr_t tid)
@@ -117,8 +122,13 @@ MonodroidRuntime::thread_end ([[maybe_unused]] MonoProfiler *prof, [[maybe_unuse
 }
 
 inline void
-MonodroidRuntime::log_jit_event (MonoMethod *method, const char *event_name)
+MonodroidRuntime::log_jit_event (MonoMethod *method, JitEventKind kind, const char *event_name)
 {
+	if (JitEventLog::is_enabled ()) {
+		JitEventLog::record (method, kind);
+		return;
+	}
+
 	jit_time.mark_end ();
 
 	if (jit_log == nullptr)
@@ -135,19 +145,23 @@ MonodroidRuntime::log_jit_event (MonoMethod *method, const char *event_name)
 void
 MonodroidRuntime::jit_begin ([[maybe_unused]] MonoProfiler *prof, MonoMethod *method)
 {
-	monodroidRuntime.log_jit_event (method, "begin");
+	monodroidRuntime.log_jit_event (method, JitEventKind::Begin, "begin");
 }
 
 void
 MonodroidRuntime::jit_failed ([[maybe_unused]] MonoProfiler *prof, MonoMethod *method)
 {
-	monodroidRuntime.log_jit_event (method, "failed");
+	monodroidRuntime.log_jit_event (method, JitEventKind::Failed, "failed");
 }
 
 void
 MonodroidRuntime::jit_done ([[maybe_unused]] MonoProfiler *prof, MonoMethod *method, [[maybe_unused]] MonoJitInfo* jinfo)
 {
-	monodroidRuntime.log_jit_event (method, "done");
+	if (JitProfile::is_enabled ()) {
+		JitProfile::record (method);
+	}
+
+	monodroidRuntime.log_jit_event (method, JitEventKind::Done, "done");
 }
 
 #ifndef RELEASE
@@ -643,10 +657,19 @@ MonodroidRuntime::mono_runtime_init ([[maybe_unused]] JNIEnv *env, [[maybe_unuse
 
 	bool log_methods = FastTiming::enabled () && !FastTiming::is_bare_mode ();
 	if (log_methods) [[unlikely]] {
-		std::unique_ptr<char> jit_log_path {Util::path_combine (AndroidSystem::override_dirs [0], "methods.txt")};
+		std::unique_ptr<char> jit_log_path {Util::path_combine (AndroidSystem::override_dirs [0], Logger::jit_log_binary () ? "methods.bin" : "methods.txt")};
+		Util::create_directory (AndroidSystem::override_dirs [0], 0755);
+		if (Logger::jit_log_binary ()) {
+			JitEventLog::start (jit_log_path.get ());
+		} else {
+			jit_log = Util::monodroid_fopen (jit_log_path.get (), "a");
+			Util::set_world_accessable (jit_log_path.get ());
+		}
+	}
+
+	if (Logger::jit_profile ()) [[unlikely]] {
 		Util::create_directory (AndroidSystem::override_dirs [0], 0755);
-		jit_log = Util::monodroid_fopen (jit_log_path.get (), "a");
-		Util::set_world_accessable (jit_log_path.get ());
+		JitProfile::start (AndroidSystem::override_dirs [0]);
 	}
 
 	profiler_handle = mono_profiler_create (nullptr);
@@ -656,10 +679,13 @@ MonodroidRuntime::mono_runtime_init ([[maybe_unused]] JNIEnv *env, [[maybe_unuse
 	if (log_methods) [[unlikely]]{
 		jit_time.mark_start ();
 		mono_profiler_set_jit_begin_callback (profiler_handle, jit_begin);
-		mono_profiler_set_jit_done_callback (profiler_handle, jit_done);
 		mono_profiler_set_jit_failed_callback (profiler_handle, jit_failed);
 	}
 
+	if (log_methods || JitProfile::is_enabled ()) [[unlikely]] {
+		mono_profiler_set_jit_done_callback (profiler_handle, jit_done);
+	}
+
 	parse_gdb_options ();
 
 	if (wait_for_gdb) {
@@ -692,7 +718,7 @@ MonodroidRuntime::mono_runtime_init ([[maybe_unused]] JNIEnv *env, [[maybe_unuse
 	mono_set_signal_chaining (1);
 	mono_set_crash_chaining (1);
 
-	osBridge.register_gc_hooks ();
+	osBridge.register_gc_hooks (profiler_handle);
 
 	/*
 	 * Assembly preload hooks are invoked in _reverse_ registration order.
@@ -728,6 +754,9 @@ MonodroidRuntime::create_domain (JNIEnv *env, jstring_array_wrapper &runtimeApks
 
 	gather_bundled_assemblies (runtimeApks, &user_assemblies_count, have_split_apks);
 
+	// Opt-in: record the assembly load order, or map and decompress the recorded assemblies in the background
+	AssemblyPrefetch::start ();
+
 	if (embeddedAssemblies.have_runtime_config_blob ()) {
 		size_t blob_time_index;
 		if (FastTiming::enabled ()) [[unlikely]] {
@@ -896,6 +925,7 @@ MonodroidRuntime::init_android_runtime (JNIEnv *env, jclass runtimeClass, jobjec
 			&osBridge.get_java_gc_bridge_info (i)
 		);
 	}
+	osBridge.invalidate_gc_bridge_class_cache ();
 
 	MonoClass *runtime;
 	MonoMethod *method;
@@ -922,6 +952,7 @@ MonodroidRuntime::init_android_runtime (JNIEnv *env, jclass runtimeClass, jobjec
 			&osBridge.get_java_gc_bridge_info (i)
 		);
 	}
+	osBridge.invalidate_gc_bridge_class_cache ();
 
 	MonoError error;
 	/* If running on desktop, we may be swapping in a new Mono.Android image when calling this
@@ -1088,26 +1119,8 @@ MonodroidRuntime::monodroid_dlopen_ignore_component_or_load ([[maybe_unused]] ha
 }
 
 force_inline void*
-MonodroidRuntime::monodroid_dlopen (const char *name, int flags, char **err) noexcept
+MonodroidRuntime::monodroid_dlopen_cache_entry (DSOCacheEntry *dso, const char *name, int flags) noexcept
 {
-	hash_t name_hash = xxhash::hash (name, strlen (name));
-	log_debug (LOG_ASSEMBLY, "monodroid_dlopen: hash for name '%s' is 0x%zx", name, name_hash);
-	DSOCacheEntry *dso = find_dso_cache_entry (name_hash);
-	log_debug (LOG_ASSEMBLY, "monodroid_dlopen: hash match %sfound, DSO name is '%s'", dso == nullptr ? "not " : "", dso == nullptr ? "<unknown>" : dso->name);
-
-	if (dso == nullptr) {
-		// DSO not known at build time, try to load it
-		return monodroid_dlopen_ignore_component_or_load (name_hash, name, flags, err);
-	} else if (dso->handle != nullptr) {
-		return monodroid_dlopen_log_and_return (dso->handle, err, dso->name, false /* name_needs_free */);
-	}
-
-	if (dso->ignore) {
-		log_info (LOG_ASSEMBLY, "Request to load '%s' ignored, it is known not to exist", dso->name);
-		return nullptr;
-	}
-
-	StartupAwareLock lock (dso_handle_write_lock);
 #if defined (RELEASE)
 	if (AndroidSystem::is_embedded_dso_mode_enabled ()) {
 		DSOApkEntry *apk_entry = dso_apk_entries;
@@ -1121,24 +1134,56 @@ MonodroidRuntime::monodroid_dlopen (const char *name, int flags, char **err) noe
 			dli.flags = ANDROID_DLEXT_USE_LIBRARY_FD | ANDROID_DLEXT_USE_LIBRARY_FD_OFFSET;
 			dli.library_fd = apk_entry->fd;
 			dli.library_fd_offset = apk_entry->offset;
-			dso->handle = android_dlopen_ext (dso->name, flags, &dli);
 
-			if (dso->handle != nullptr) {
-				return monodroid_dlopen_log_and_return (dso->handle, err, dso->name, false /* name_needs_free */);
+			void *handle = android_dlopen_ext (dso->name, flags, &dli);
+			if (handle != nullptr) {
+				return handle;
 			}
 			break;
 		}
 	}
 #endif
 	unsigned int dl_flags = monodroidRuntime.convert_dl_flags (flags);
-	dso->handle = AndroidSystem::load_dso_from_any_directories (dso->name, dl_flags);
+	void *handle = AndroidSystem::load_dso_from_any_directories (dso->name, dl_flags);
+
+	if (handle != nullptr || name == nullptr) {
+		return handle;
+	}
+
+	return AndroidSystem::load_dso_from_any_directories (name, dl_flags);
+}
+
+force_inline void*
+MonodroidRuntime::monodroid_dlopen (const char *name, int flags, char **err) noexcept
+{
+	hash_t name_hash = xxhash::hash (name, strlen (name));
+	log_debug (LOG_ASSEMBLY, "monodroid_dlopen: hash for name '%s' is 0x%zx", name, name_hash);
+	DSOCacheEntry *dso = find_dso_cache_entry (name_hash);
+	log_debug (LOG_ASSEMBLY, "monodroid_dlopen: hash match %sfound, DSO name is '%s'", dso == nullptr ? "not " : "", dso == nullptr ? "<unknown>" : dso->name);
+
+	if (dso == nullptr) {
+		// DSO not known at build time, try to load it
+		return monodroid_dlopen_ignore_component_or_load (name_hash, name, flags, err);
+	}
+
+	// The handle may have been stored by the DSO warm-up thread, see `start_dso_warmup`
+	void *handle = __atomic_load_n (&dso->handle, __ATOMIC_ACQUIRE);
+	if (handle != nullptr) {
+		return monodroid_dlopen_log_and_return (handle, err, dso->name, false /* name_needs_free */);
+	}
+
+	if (dso->ignore) {
+		log_info (LOG_ASSEMBLY, "Request to load '%s' ignored, it is known not to exist", dso->name);
+		return nullptr;
+	}
 
-	if (dso->handle != nullptr) {
-		return monodroid_dlopen_log_and_return (dso->handle, err, dso->name, false /* name_needs_free */);
+	StartupAwareLock lock (dso_handle_write_lock);
+	handle = monodroid_dlopen_cache_entry (dso, name, flags);
+	if (handle != nullptr) {
+		__atomic_store_n (&dso->handle, handle, __ATOMIC_RELEASE);
 	}
 
-	dso->handle = AndroidSystem::load_dso_from_any_directories (name, dl_flags);
-	return monodroid_dlopen_log_and_return (dso->handle, err, name, false /* name_needs_free */);
+	return monodroid_dlopen_log_and_return (handle, err, name, false /* name_needs_free */);
 }
 
 void*
@@ -1152,6 +1197,177 @@ MonodroidRuntime::monodroid_dlopen (const char *name, int flags, char **err, [[m
 	return monodroid_dlopen (name, flags, err);
 }
 
+force_inline bool
+MonodroidRuntime::dso_warmup_wanted (DSOCacheEntry const& dso, DSOWarmupMode mode, const hash_t *name_hashes, size_t name_hash_count) noexcept
+{
+	constexpr std::string_view AOT_IMAGE_PREFIX { "libaot-" };
+
+	switch (mode) {
+		case DSOWarmupMode::All:
+			return true;
+
+		case DSOWarmupMode::AotImages:
+			return strncmp (dso.name, AOT_IMAGE_PREFIX.data (), AOT_IMAGE_PREFIX.length ()) == 0;
+
+		case DSOWarmupMode::Names:
+			for (size_t i = 0; i < name_hash_count; i++) {
+				if (dso.real_name_hash == name_hashes[i]) {
+					return true;
+				}
+			}
+			return false;
+	}
+
+	return false;
+}
+
+void*
+MonodroidRuntime::dso_warmup_thread (void *arg) noexcept
+{
+	auto entries = static_cast<DSOCacheEntry**>(arg);
+
+	size_t total_time_index;
+	if (FastTiming::enabled ()) [[unlikely]] {
+		total_time_index = internal_timing->start_event (TimingEventKind::DSOWarmup);
+	}
+
+	uint64_t loaded = 0;
+	for (DSOCacheEntry **p = entries; *p != nullptr; p++) {
+		DSOCacheEntry *dso = *p;
+
+		if (__atomic_load_n (&dso->handle, __ATOMIC_ACQUIRE) != nullptr) {
+			continue; // Mono got there first
+		}
+
+		// Mono loads AOT images with MONO_DL_LAZY, use the same flags so that we end up with the same handle
+		void *handle = monodroid_dlopen_cache_entry (dso, nullptr /* name */, MONO_DL_LAZY);
+		if (handle == nullptr) {
+			log_debug (LOG_ASSEMBLY, "DSO warm-up: failed to load '%s'", dso->name);
+			continue;
+		}
+
+		void *expected_null = nullptr;
+		bool stored = __atomic_compare_exchange_n (
+			/* ptr */              &dso->handle,
+			/* expected */         &expected_null,
+			/* desired */          handle,
+			/* weak */             false,
+			/* success_memorder */ __ATOMIC_RELEASE,
+			/* failure_memorder */ __ATOMIC_RELAXED
+		);
+
+		if (!stored) {
+			// Another thread loaded the DSO in the meantime, handles are reference counted so just drop our reference
+			dlclose (handle);
+			continue;
+		}
+
+		log_debug (LOG_ASSEMBLY, "DSO warm-up: preloaded '%s'", dso->name);
+		loaded++;
+	}
+	delete[] entries;
+
+	if (FastTiming::enabled ()) [[unlikely]] {
+		internal_timing->end_event (total_time_index, true /* uses_more_info */);
+
+		static_local_string<SharedConstants::INTEGER_BASE10_BUFFER_SIZE> more_info;
+		more_info.append (loaded);
+		internal_timing->add_more_info (total_time_index, more_info);
+	}
+
+	return nullptr;
+}
+
+void
+MonodroidRuntime::start_dso_warmup () noexcept
+{
+	if (application_config.number_of_dso_cache_entries == 0) {
+		return;
+	}
+
+	dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> value;
+	if (AndroidSystem::monodroid_get_system_property (SharedConstants::DEBUG_MONO_DSO_WARMUP_PROPERTY, value) <= 0) {
+		return;
+	}
+
+	constexpr std::string_view MODE_ALL { "all" };
+	constexpr std::string_view MODE_AOT { "aot" };
+
+	DSOWarmupMode mode;
+	std::array<hash_t, MAX_DSO_WARMUP_NAMES> name_hashes;
+	size_t name_hash_count = 0;
+
+	if (strcmp (value.get (), MODE_ALL.data ()) == 0) {
+		mode = DSOWarmupMode::All;
+	} else if (strcmp (value.get (), MODE_AOT.data ()) == 0) {
+		mode = DSOWarmupMode::AotImages;
+	} else {
+		mode = DSOWarmupMode::Names;
+
+		string_segment token;
+		while (value.next_token (',', token)) {
+			if (token.empty ()) {
+				continue;
+			}
+
+			if (name_hash_count == name_hashes.size ()) {
+				log_warn (LOG_ASSEMBLY, "DSO warm-up: too many names in '%s', ignoring all past the first %zu", SharedConstants::DEBUG_MONO_DSO_WARMUP_PROPERTY.data (), name_hashes.size ());
+				break;
+			}
+
+			// Map the name, which can be any of the aliases Mono uses, to the real library name
+			DSOCacheEntry *dso = find_dso_cache_entry (xxhash::hash (token.start (), token.length ()));
+			if (dso == nullptr) {
+				log_debug (LOG_ASSEMBLY, "DSO warm-up: '%.*s' is not a known shared library", static_cast<int>(token.length ()), token.start ());
+				continue;
+			}
+			name_hashes[name_hash_count++] = dso->real_name_hash;
+		}
+
+		if (name_hash_count == 0) {
+			return;
+		}
+	}
+
+	// The array is null-terminated and owned by the warm-up thread from now on
+	auto entries = new DSOCacheEntry*[application_config.number_of_dso_cache_entries + 1];
+	size_t count = 0;
+	for (size_t i = 0; i < application_config.number_of_dso_cache_entries; i++) {
+		DSOCacheEntry &dso = dso_cache[i];
+		if (dso.ignore || dso.handle != nullptr) {
+			continue;
+		}
+
+		if (dso_warmup_wanted (dso, mode, name_hashes.data (), name_hash_count)) {
+			entries[count++] = &dso;
+		}
+	}
+	entries[count] = nullptr;
+
+	if (count == 0) {
+		delete[] entries;
+		return;
+	}
+
+	log_debug (LOG_ASSEMBLY, "DSO warm-up: starting background load of %zu shared libraries", count);
+
+	pthread_attr_t attr;
+	pthread_attr_init (&attr);
+	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t warmup_thread;
+	int ret = pthread_create (&warmup_thread, &attr, dso_warmup_thread, entries);
+	pthread_attr_destroy (&attr);
+
+	if (ret != 0) {
+		log_warn (LOG_ASSEMBLY, "DSO warm-up: failed to create the warm-up thread. %s", strerror (ret));
+		delete[] entries;
+		return;
+	}
+
+	pthread_setname_np (warmup_thread, "XA DSO warmup");
+}
+
 void*
 MonodroidRuntime::monodroid_dlsym (void *handle, const char *name, char **err, [[maybe_unused]] void *user_data)
 {
@@ -1581,6 +1797,7 @@ MonodroidRuntime::Java_mono_android_Runtime_initInternal (JNIEnv *env, jclass kl
 	if (FastTiming::enabled ()) [[unlikely]] {
 		timing = new Timing ();
 		total_time_index = internal_timing->start_event (TimingEventKind::TotalRuntimeInit);
+		AssemblyLoadStats::initialize ();
 	}
 
 	jstring_array_wrapper applicationDirs (env, appDirs);
@@ -1622,8 +1839,15 @@ MonodroidRuntime::Java_mono_android_Runtime_initInternal (JNIEnv *env, jclass kl
 
 	jstring_array_wrapper runtimeApks (env, runtimeApksJava);
 	AndroidSystem::setup_app_library_directories (runtimeApks, applicationDirs, haveSplitApks);
+	start_native_profiler ();
 
 	Logger::init_reference_logging (AndroidSystem::get_primary_override_dir ());
+	if (Logger::ref_log_async () && (log_categories & (LOG_GREF | LOG_LREF)) != 0) {
+		RefLogWriter::start (Logger::ref_log_binary ());
+	}
+	if (Logger::gref_attribution ()) {
+		GrefAttribution::enable (env, get_native_frames_capture ());
+	}
 	AndroidSystem::create_update_dir (AndroidSystem::get_primary_override_dir ());
 
 #if DEBUG
@@ -1697,6 +1921,10 @@ MonodroidRuntime::Java_mono_android_Runtime_initInternal (JNIEnv *env, jclass kl
 		internal_timing->end_event (mono_runtime_init_index);
 	}
 
+	// Opt-in: let the AOT images and other DSOs Mono is about to ask for be loaded and relocated in parallel
+	// with the rest of the startup sequence
+	start_dso_warmup ();
+
 	jstring_array_wrapper assemblies (env, assembliesJava);
 	jstring_array_wrapper assembliesPaths (env);
 	/* the first assembly is used to initialize the AppDomain name */
@@ -1722,8 +1950,11 @@ MonodroidRuntime::Java_mono_android_Runtime_initInternal (JNIEnv *env, jclass kl
 		);
 	}
 
+	AndroidSystem::log_dso_probe_stats ();
+
 	if (FastTiming::enabled ()) [[unlikely]] {
 		internal_timing->end_event (total_time_index);
+		AssemblyLoadStats::dump ();
 	}
 
 #if defined (RELEASE)
@@ -1821,11 +2052,18 @@ MonodroidRuntime::Java_mono_android_Runtime_register (JNIEnv *env, jstring manag
 JNIEXPORT void
 JNICALL Java_mono_android_Runtime_dumpTimingData ([[maybe_unused]] JNIEnv *env, [[maybe_unused]] jclass klass)
 {
+	JitProfile::write ();
+	MonodroidRuntime::write_native_profile ();
+
 	if (internal_timing == nullptr) {
 		return;
 	}
 
 	internal_timing->dump ();
+	if (AssemblyLoadStats::enabled ()) {
+		AssemblyLoadStats::dump ();
+	}
+	JitEventLog::flush ();
 }
 
 JNIEXPORT void
@@ -1,10 +1,15 @@
 #include <android/log.h>
+#include <cstdlib>
+#include <limits>
+#include <memory>
 #include <string>
 
 #include "java-interop-logger.h"
 #include "mono/utils/details/mono-dl-fallback-types.h"
 #include "monodroid-glue-internal.hh"
 #include "native-tracing.hh"
+#include "shared-constants.hh"
+#include "util.hh"
 #include <cpp-util.hh>
 
 using namespace xamarin::android::internal;
@@ -14,30 +19,55 @@ namespace {
 	decltype(xa_get_managed_backtrace)* _xa_get_managed_backtrace;
 	decltype(xa_get_java_backtrace)* _xa_get_java_backtrace;
 	decltype(xa_get_interesting_signal_handlers)* _xa_get_interesting_signal_handlers;
+	decltype(xa_start_sampling_profiler)* _xa_start_sampling_profiler;
+	decltype(xa_get_sampled_stacks)* _xa_get_sampled_stacks;
+	decltype(xa_capture_native_frames)* _xa_capture_native_frames;
 	bool tracing_init_done;
 	std::mutex tracing_init_lock {};
+	bool native_profiler_running;
 }
 
 void
-MonodroidRuntime::log_traces (JNIEnv *env, TraceKind kind, const char *first_line) noexcept
+MonodroidRuntime::init_native_tracing () noexcept
 {
-	if (!tracing_init_done) {
-		std::lock_guard lock (tracing_init_lock);
+	if (tracing_init_done) {
+		return;
+	}
 
-		char *err = nullptr;
-		void *handle = monodroid_dlopen (xamarin_native_tracing_name.data (), MONO_DL_EAGER, &err, nullptr);
-		if (handle == nullptr) {
-			log_warn (LOG_DEFAULT, "Failed to load native tracing library '%s'. %s", xamarin_native_tracing_name, err == nullptr ? "Unknown error" : err);
-		} else {
-			load_symbol (handle, "xa_get_native_backtrace", _xa_get_native_backtrace);
-			load_symbol (handle, "xa_get_managed_backtrace", _xa_get_managed_backtrace);
-			load_symbol (handle, "xa_get_java_backtrace", _xa_get_java_backtrace);
-			load_symbol (handle, "xa_get_interesting_signal_handlers", _xa_get_interesting_signal_handlers);
-		}
+	std::lock_guard lock (tracing_init_lock);
+	if (tracing_init_done) {
+		return;
+	}
 
-		tracing_init_done = true;
+	char *err = nullptr;
+	void *handle = monodroid_dlopen (xamarin_native_tracing_name.data (), MONO_DL_EAGER, &err, nullptr);
+	if (handle == nullptr) {
+		log_warn (LOG_DEFAULT, "Failed to load native tracing library '%s'. %s", xamarin_native_tracing_name, err == nullptr ? "Unknown error" : err);
+	} else {
+		load_symbol (handle, "xa_get_native_backtrace", _xa_get_native_backtrace);
+		load_symbol (handle, "xa_get_managed_backtrace", _xa_get_managed_backtrace);
+		load_symbol (handle, "xa_get_java_backtrace", _xa_get_java_backtrace);
+		load_symbol (handle, "xa_get_interesting_signal_handlers", _xa_get_interesting_signal_handlers);
+		load_symbol (handle, "xa_start_sampling_profiler", _xa_start_sampling_profiler);
+		load_symbol (handle, "xa_get_sampled_stacks", _xa_get_sampled_stacks);
+		load_symbol (handle, "xa_capture_native_frames", _xa_capture_native_frames);
 	}
 
+	tracing_init_done = true;
+}
+
+GrefAttribution::capture_frames_fn
+MonodroidRuntime::get_native_frames_capture () noexcept
+{
+	init_native_tracing ();
+	return _xa_capture_native_frames;
+}
+
+void
+MonodroidRuntime::log_traces (JNIEnv *env, TraceKind kind, const char *first_line) noexcept
+{
+	init_native_tracing ();
+
 	std::string trace;
 	if (first_line != nullptr) {
 		trace.append (first_line);
@@ -87,3 +117,61 @@ MonodroidRuntime::log_traces (JNIEnv *env, TraceKind kind, const char *first_lin
 	// strings (like the stack traces we've just produced), unlike __android_log_vprint used by our `log_*` functions
 	__android_log_write (ANDROID_LOG_INFO, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), trace.c_str ());
 }
+
+// Implements the `debug.mono.native_profiler` property, the value of which is the sampling interval in microseconds of
+// CPU time.  All the threads are sampled, from as early as the tracing library can be loaded.
+void
+MonodroidRuntime::start_native_profiler () noexcept
+{
+	dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> value;
+	if (AndroidSystem::monodroid_get_system_property (SharedConstants::DEBUG_MONO_NATIVE_PROFILER_PROPERTY, value) <= 0) {
+		return;
+	}
+
+	char *endp = nullptr;
+	unsigned long interval_us = strtoul (value.get (), &endp, 10);
+	if (endp == value.get () || *endp != '\0' || interval_us == 0 || interval_us > std::numeric_limits<uint32_t>::max ()) {
+		log_warn (LOG_DEFAULT, "Native profiler: invalid sampling interval '%s' in '%s'", value.get (), SharedConstants::DEBUG_MONO_NATIVE_PROFILER_PROPERTY.data ());
+		return;
+	}
+
+	init_native_tracing ();
+	if (_xa_start_sampling_profiler == nullptr || _xa_get_sampled_stacks == nullptr) {
+		return;
+	}
+
+	native_profiler_running = _xa_start_sampling_profiler (static_cast<uint32_t>(interval_us), true /* all_threads */);
+	if (native_profiler_running) {
+		log_info (LOG_DEFAULT, "Native profiler: sampling all threads every %lu microseconds of CPU time", interval_us);
+	} else {
+		log_warn (LOG_DEFAULT, "Native profiler: failed to start");
+	}
+}
+
+// Each call writes all the stacks sampled since the profiler was started, the profiler keeps running
+void
+MonodroidRuntime::write_native_profile () noexcept
+{
+	if (!native_profiler_running) {
+		return;
+	}
+
+	c_unique_ptr<const char> stacks { _xa_get_sampled_stacks () };
+	if (!stacks) {
+		return;
+	}
+
+	std::unique_ptr<char> path {Util::path_combine (AndroidSystem::override_dirs [0], NATIVE_PROFILE_FILE_NAME.data ())};
+	Util::create_directory (AndroidSystem::override_dirs [0], 0755);
+
+	FILE *file = Util::monodroid_fopen (path.get (), "w");
+	if (file == nullptr) {
+		return;
+	}
+
+	fputs (stacks.get (), file);
+	fclose (file);
+	Util::set_world_accessable (path.get ());
+
+	log_info_nocheck (LOG_DEFAULT, "Native profiler: sampled stacks written to %s", path.get ());
+}
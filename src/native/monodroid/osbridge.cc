@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cstring>
+#include <ctime>
+#include <limits>
 
 #include <sys/types.h>
 #include <sys/syscall.h>
@@ -12,12 +15,17 @@
 #include <unistd.h>
 
 #include <mono/metadata/class.h>
+#include <mono/metadata/mono-gc.h>
 #include <mono/metadata/object.h>
 #include <mono/metadata/threads.h>
 
 #include "globals.hh"
+#include "gref-attribution.hh"
+#include "gref-pressure.hh"
 #include "osbridge.hh"
+#include "ref-log-writer.hh"
 #include "runtime-util.hh"
+#include "xxhash.hh"
 
 using namespace xamarin::android;
 using namespace xamarin::android::internal;
@@ -51,16 +59,44 @@ OSBridge::MonoJavaGCBridgeInfo OSBridge::empty_bridge_info = {
 	nullptr
 };
 
+static uint64_t
+gc_bridge_now_ns ()
+{
+	timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL) + static_cast<uint64_t>(ts.tv_nsec);
+}
+
 extern "C" MonoGCBridgeObjectKind
 gc_bridge_class_kind_cb (MonoClass* klass)
 {
-	return osBridge.gc_bridge_class_kind (klass);
+	OSBridge::BridgeCallbackCounters &counters = osBridge.get_callback_counters ();
+	uint64_t calls = osBridge.add_to_callback_counter (counters, counters.class_kind_calls, 1);
+	if ((calls & (OSBridge::BRIDGE_CALLBACK_TIMING_INTERVAL - 1)) != 0) [[likely]] {
+		return osBridge.gc_bridge_class_kind (klass);
+	}
+
+	uint64_t start = gc_bridge_now_ns ();
+	MonoGCBridgeObjectKind ret = osBridge.gc_bridge_class_kind (klass);
+	osBridge.add_to_callback_counter (counters, counters.class_kind_timed_ns, gc_bridge_now_ns () - start);
+	osBridge.add_to_callback_counter (counters, counters.class_kind_timed_calls, 1);
+	return ret;
 }
 
 extern "C" mono_bool
 gc_is_bridge_object_cb (MonoObject* object)
 {
-	return osBridge.gc_is_bridge_object (object);
+	OSBridge::BridgeCallbackCounters &counters = osBridge.get_callback_counters ();
+	uint64_t calls = osBridge.add_to_callback_counter (counters, counters.is_bridge_object_calls, 1);
+	if ((calls & (OSBridge::BRIDGE_CALLBACK_TIMING_INTERVAL - 1)) != 0) [[likely]] {
+		return osBridge.gc_is_bridge_object (object);
+	}
+
+	uint64_t start = gc_bridge_now_ns ();
+	mono_bool ret = osBridge.gc_is_bridge_object (object);
+	osBridge.add_to_callback_counter (counters, counters.is_bridge_object_timed_ns, gc_bridge_now_ns () - start);
+	osBridge.add_to_callback_counter (counters, counters.is_bridge_object_timed_calls, 1);
+	return ret;
 }
 
 extern "C" void
@@ -69,6 +105,14 @@ gc_cross_references_cb (int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, Mon
 	osBridge.gc_cross_references (num_sccs, sccs, num_xrefs, xrefs);
 }
 
+static void
+gc_event_cb ([[maybe_unused]] MonoProfiler *prof, MonoProfilerGCEvent event, uint32_t generation, [[maybe_unused]] mono_bool is_serial)
+{
+	if (event == MONO_GC_EVENT_START) {
+		osBridge.gc_started (generation);
+	}
+}
+
 using tid_type = pid_t;
 
 // Do this instead of using memset so that individual pointers are set atomically
@@ -83,10 +127,53 @@ OSBridge::clear_mono_java_gc_bridge_info ()
 		info->refs_added = nullptr;
 		info->weak_handle = nullptr;
 	}
+	invalidate_gc_bridge_class_cache ();
+}
+
+// Must be called after any of the `mono_java_gc_bridge_info` entries changes
+void
+OSBridge::invalidate_gc_bridge_class_cache ()
+{
+	__atomic_add_fetch (&bridge_class_cache_generation, 1, __ATOMIC_ACQ_REL);
 }
 
 int
 OSBridge::get_gc_bridge_index (MonoClass *klass)
+{
+	uint32_t generation = __atomic_load_n (&bridge_class_cache_generation, __ATOMIC_ACQUIRE);
+	size_t slot = (reinterpret_cast<uintptr_t>(klass) >> 3) & (BRIDGE_CLASS_CACHE_SIZE - 1);
+
+	for (size_t probe = 0; probe < BRIDGE_CLASS_CACHE_MAX_PROBES; probe++, slot = (slot + 1) & (BRIDGE_CLASS_CACHE_SIZE - 1)) {
+		BridgeClassCacheEntry &entry = bridge_class_cache [slot];
+		MonoClass *owner = __atomic_load_n (&entry.klass, __ATOMIC_ACQUIRE);
+
+		if (owner == nullptr) {
+			if (!__atomic_compare_exchange_n (&entry.klass, &owner, klass, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) && owner != klass) {
+				continue; // somebody else claimed the slot
+			}
+		} else if (owner != klass) {
+			continue;
+		} else {
+			uint64_t value = __atomic_load_n (&entry.value, __ATOMIC_ACQUIRE);
+			if (static_cast<uint32_t>(value >> 32) == generation) [[likely]] {
+				return static_cast<int>(static_cast<uint32_t>(value));
+			}
+		}
+
+		int index = find_gc_bridge_index (klass);
+		// Not cached, bridge types might be registered any moment now
+		if (index != static_cast<int> (-NUM_GC_BRIDGE_TYPES)) {
+			uint64_t value = (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(index);
+			__atomic_store_n (&entry.value, value, __ATOMIC_RELEASE);
+		}
+		return index;
+	}
+
+	return find_gc_bridge_index (klass);
+}
+
+int
+OSBridge::find_gc_bridge_index (MonoClass *klass)
 {
 	uint32_t f = 0;
 
@@ -157,13 +244,17 @@ OSBridge::get_object_ref_type (JNIEnv *env, void *handle)
 int
 OSBridge::_monodroid_gref_inc ()
 {
-	return __sync_add_and_fetch (&gc_gref_count, 1);
+	int c = gc_gref_count.increment ();
+	if (c >= exact_gref_count_level) [[unlikely]] {
+		return gc_gref_count.get ();
+	}
+	return c;
 }
 
 int
 OSBridge::_monodroid_gref_dec ()
 {
-	return __sync_sub_and_fetch (&gc_gref_count, 1);
+	return gc_gref_count.decrement ();
 }
 
 char*
@@ -202,6 +293,11 @@ OSBridge::_write_stack_trace (FILE *to, char *from, LogCategories category)
 void
 OSBridge::_monodroid_gref_log (const char *message)
 {
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::Message, 0, 0, nullptr, 0, nullptr, 0, nullptr, 0, message, false);
+		return;
+	}
+
 	if (gref_to_logcat) {
 		log_debug (LOG_GREF, "%s", message);
 	}
@@ -215,11 +311,24 @@ int
 OSBridge::_monodroid_gref_log_new (jobject curHandle, char curType, jobject newHandle, char newType, const char *threadName, int threadId, const char *from, int from_writable)
 {
 	int c = _monodroid_gref_inc ();
+	GrefPressureMonitor::gref_created (c);
+	if (GrefAttribution::is_enabled ()) [[unlikely]] {
+		GrefAttribution::reference_created (curHandle, newHandle, false /* weak */, from);
+	}
 	if ((log_categories & LOG_GREF) == 0)
 		return c;
+	c = gc_gref_count.get (); // the value returned by the increment is only approximate
+	int wc = gc_weak_gref_count.get ();
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::GrefNew, c, wc, curHandle, curType, newHandle, newType, threadName, threadId, from, from_writable != 0);
+		if (c >= ref_log_flush_level) [[unlikely]] {
+			RefLogWriter::flush ();
+		}
+		return c;
+	}
 	log_info (LOG_GREF, "+g+ grefc %i gwrefc %i obj-handle %p/%c -> new-handle %p/%c from thread '%s'(%i)",
 	          c,
-	          gc_weak_gref_count,
+	          wc,
 	          curHandle,
 	          curType,
 	          newHandle,
@@ -237,7 +346,7 @@ OSBridge::_monodroid_gref_log_new (jobject curHandle, char curType, jobject newH
 		return c;
 	fprintf (gref_log, "+g+ grefc %i gwrefc %i obj-handle %p/%c -> new-handle %p/%c from thread '%s'(%i)\n",
 	         c,
-	         gc_weak_gref_count,
+	         wc,
 	         curHandle,
 	         curType,
 	         newHandle,
@@ -257,12 +366,21 @@ OSBridge::_monodroid_gref_log_new (jobject curHandle, char curType, jobject newH
 void
 OSBridge::_monodroid_gref_log_delete (jobject handle, char type, const char *threadName, int threadId, const char *from, int from_writable)
 {
-	int c = _monodroid_gref_dec ();
+	_monodroid_gref_dec ();
+	if (GrefAttribution::is_enabled ()) [[unlikely]] {
+		GrefAttribution::reference_deleted (handle);
+	}
 	if ((log_categories & LOG_GREF) == 0)
 		return;
+	int c = gc_gref_count.get ();
+	int wc = gc_weak_gref_count.get ();
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::GrefDelete, c, wc, handle, type, nullptr, 0, threadName, threadId, from, from_writable != 0);
+		return;
+	}
 	log_info (LOG_GREF, "-g- grefc %i gwrefc %i handle %p/%c from thread '%s'(%i)",
 	          c,
-	          gc_weak_gref_count,
+	          wc,
 	          handle,
 	          type,
 	          threadName,
@@ -278,7 +396,7 @@ OSBridge::_monodroid_gref_log_delete (jobject handle, char type, const char *thr
 		return;
 	fprintf (gref_log, "-g- grefc %i gwrefc %i handle %p/%c from thread '%s'(%i)\n",
 	         c,
-	         gc_weak_gref_count,
+	         wc,
 	         handle,
 	         type,
 	         threadName,
@@ -294,12 +412,21 @@ OSBridge::_monodroid_gref_log_delete (jobject handle, char type, const char *thr
 void
 OSBridge::_monodroid_weak_gref_new (jobject curHandle, char curType, jobject newHandle, char newType, const char *threadName, int threadId, const char *from, int from_writable)
 {
-	++gc_weak_gref_count;
+	gc_weak_gref_count.increment ();
+	if (GrefAttribution::is_enabled ()) [[unlikely]] {
+		GrefAttribution::reference_created (curHandle, newHandle, true /* weak */, from);
+	}
 	if ((log_categories & LOG_GREF) == 0)
 		return;
+	int c = gc_gref_count.get ();
+	int wc = gc_weak_gref_count.get ();
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::WeakGrefNew, c, wc, curHandle, curType, newHandle, newType, threadName, threadId, from, from_writable != 0);
+		return;
+	}
 	log_info (LOG_GREF, "+w+ grefc %i gwrefc %i obj-handle %p/%c -> new-handle %p/%c from thread '%s'(%i)",
-	          gc_gref_count,
-	          gc_weak_gref_count,
+	          c,
+	          wc,
 	          curHandle,
 	          curType,
 	          newHandle,
@@ -316,8 +443,8 @@ OSBridge::_monodroid_weak_gref_new (jobject curHandle, char curType, jobject new
 	if (!gref_log)
 		return;
 	fprintf (gref_log, "+w+ grefc %i gwrefc %i obj-handle %p/%c -> new-handle %p/%c from thread '%s'(%i)\n",
-	         gc_gref_count,
-	         gc_weak_gref_count,
+	         c,
+	         wc,
 	         curHandle,
 	         curType,
 	         newHandle,
@@ -335,12 +462,21 @@ OSBridge::_monodroid_weak_gref_new (jobject curHandle, char curType, jobject new
 void
 OSBridge::_monodroid_weak_gref_delete (jobject handle, char type, const char *threadName, int threadId, const char *from, int from_writable)
 {
-	--gc_weak_gref_count;
+	gc_weak_gref_count.decrement ();
+	if (GrefAttribution::is_enabled ()) [[unlikely]] {
+		GrefAttribution::reference_deleted (handle);
+	}
 	if ((log_categories & LOG_GREF) == 0)
 		return;
+	int c = gc_gref_count.get ();
+	int wc = gc_weak_gref_count.get ();
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::WeakGrefDelete, c, wc, handle, type, nullptr, 0, threadName, threadId, from, from_writable != 0);
+		return;
+	}
 	log_info (LOG_GREF, "-w- grefc %i gwrefc %i handle %p/%c from thread '%s'(%i)",
-	          gc_gref_count,
-	          gc_weak_gref_count,
+	          c,
+	          wc,
 	          handle,
 	          type,
 	          threadName,
@@ -355,8 +491,8 @@ OSBridge::_monodroid_weak_gref_delete (jobject handle, char type, const char *th
 	if (!gref_log)
 		return;
 	fprintf (gref_log, "-w- grefc %i gwrefc %i handle %p/%c from thread '%s'(%i)\n",
-	         gc_gref_count,
-	         gc_weak_gref_count,
+	         c,
+	         wc,
 	         handle,
 	         type,
 	         threadName,
@@ -374,6 +510,10 @@ OSBridge::_monodroid_lref_log_new (int lrefc, jobject handle, char type, const c
 {
 	if ((log_categories & LOG_LREF) == 0)
 		return;
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::LrefNew, lrefc, 0, handle, type, nullptr, 0, threadName, threadId, from, from_writable != 0);
+		return;
+	}
 	log_info (LOG_LREF, "+l+ lrefc %i handle %p/%c from thread '%s'(%i)",
 	          lrefc,
 	          handle,
@@ -408,6 +548,10 @@ OSBridge::_monodroid_lref_log_delete (int lrefc, jobject handle, char type, cons
 {
 	if ((log_categories & LOG_LREF) == 0)
 		return;
+	if (RefLogWriter::is_running ()) {
+		RefLogWriter::log (RefLogRecordKind::LrefDelete, lrefc, 0, handle, type, nullptr, 0, threadName, threadId, from, from_writable != 0);
+		return;
+	}
 	log_info (LOG_LREF, "-l- lrefc %i handle %p/%c from thread '%s'(%i)",
 	          lrefc,
 	          handle,
@@ -613,22 +757,59 @@ OSBridge::gc_is_bridge_object (MonoObject *object)
 	return 1;
 }
 
+// Look up `monodroidAddReference` and `monodroidClearReferences` for the Java class of `handle`. Method lookups
+// are made only the first time a class is seen, including for classes which don't have the methods (failed
+// GetMethodID calls are particularly costly, as they throw NoSuchMethodError).  Called only from the bridge
+// callback, with the world stopped, so there's just one writer.  Entries are published atomically anyway, in
+// case a reader appears elsewhere in the future.
+OSBridge::PeerMethods*
+OSBridge::get_peer_methods (JNIEnv *env, MonoClass *klass, jobject handle)
+{
+	size_t bucket = (reinterpret_cast<uintptr_t>(klass) >> 4) & (PEER_METHODS_CACHE_SIZE - 1);
+	jclass java_class = env->GetObjectClass (handle);
+
+	PeerMethods *entry = __atomic_load_n (&peer_methods_cache [bucket], __ATOMIC_ACQUIRE);
+	for (; entry != nullptr; entry = entry->next) {
+		if (entry->klass == klass && env->IsSameObject (entry->java_class, java_class)) {
+			env->DeleteLocalRef (java_class);
+			return entry;
+		}
+	}
+
+	entry = new PeerMethods {
+		.klass = klass,
+		.java_class = reinterpret_cast<jclass> (env->NewGlobalRef (java_class)),
+		.add_reference = env->GetMethodID (java_class, "monodroidAddReference", "(Ljava/lang/Object;)V"),
+		.clear_references = nullptr,
+		.next = nullptr,
+	};
+	if (entry->add_reference == nullptr) {
+		env->ExceptionClear ();
+	}
+
+	entry->clear_references = env->GetMethodID (java_class, "monodroidClearReferences", "()V");
+	if (entry->clear_references == nullptr) {
+		env->ExceptionClear ();
+	}
+	env->DeleteLocalRef (java_class);
+
+	entry->next = peer_methods_cache [bucket];
+	__atomic_store_n (&peer_methods_cache [bucket], entry, __ATOMIC_RELEASE);
+
+	return entry;
+}
+
 // Add a reference from an IGCUserPeer jobject to another jobject
 mono_bool
-OSBridge::add_reference_jobject (JNIEnv *env, jobject handle, jobject reffed_handle)
+OSBridge::add_reference_jobject (JNIEnv *env, MonoClass *klass, jobject handle, jobject reffed_handle)
 {
-	jclass java_class;
-	jmethodID add_method_id;
+	jmethodID add_method_id = get_peer_methods (env, klass, handle)->add_reference;
 
-	java_class = env->GetObjectClass (handle);
-	add_method_id = env->GetMethodID (java_class, "monodroidAddReference", "(Ljava/lang/Object;)V");
-	env->DeleteLocalRef (java_class);
 	if (add_method_id) {
 		env->CallVoidMethod (handle, add_method_id, reffed_handle);
 		return 1;
 	}
 
-	env->ExceptionClear ();
 	return 0;
 }
 
@@ -676,10 +857,14 @@ OSBridge::add_reference (JNIEnv *env, OSBridge::AddReferenceTarget target, OSBri
 	if (!load_reference_target (reffed_target, &reffed_bridge_info, &reffed_handle))
 		return FALSE;
 
-	mono_bool success = add_reference_jobject (env, handle, reffed_handle);
+	if (handle == nullptr)
+		return FALSE;
+
+	MonoClass *klass = target.is_mono_object ? mono_object_get_class (target.obj) : nullptr;
+	mono_bool success = add_reference_jobject (env, klass, handle, reffed_handle);
 
 	// Flag MonoObjects so they can be cleared in gc_cleanup_after_java_collection.
-	// Java temporaries do not need this because the entire GCUserPeer is discarded.
+	// Java temporaries do not need this, they are cleared by recycle_temporary_peers.
 	if (success && target.is_mono_object) {
 		int ref_val = 1;
 		mono_field_set_value (target.obj, bridge_info->refs_added, &ref_val);
@@ -745,7 +930,7 @@ OSBridge::scc_set_stashed_index (MonoGCBridgeSCC *scc, int index)
 
 // Extract the root target for an SCC. If the SCC has bridged objects, this is the first object. If not, it's stored in temporary_peers.
 OSBridge::AddReferenceTarget
-OSBridge::target_from_scc (MonoGCBridgeSCC **sccs, int idx, JNIEnv *env, jobject temporary_peers)
+OSBridge::target_from_scc (MonoGCBridgeSCC **sccs, int idx)
 {
 	MonoGCBridgeSCC *scc = sccs [idx];
 	if (scc->num_objs > 0) {
@@ -757,16 +942,90 @@ OSBridge::target_from_scc (MonoGCBridgeSCC **sccs, int idx, JNIEnv *env, jobject
 #pragma clang diagnostic pop
 	}
 
-	jobject jobj = env->CallObjectMethod (temporary_peers, ArrayList_get, scc_get_stashed_index (scc));
-	return target_from_jobject (jobj);
+	return target_from_jobject (temporary_peers [static_cast<size_t>(scc_get_stashed_index (scc))]);
 }
 
-// Must call this on any AddReferenceTarget returned by target_from_scc once done with it
+// Returns a global reference to a temporary peer with no references added to it, reused from the pool if possible
+jobject
+OSBridge::acquire_temporary_peer (JNIEnv *env)
+{
+	if (!temporary_peer_pool.empty ()) {
+		jobject peer = temporary_peer_pool.back ();
+		temporary_peer_pool.pop_back ();
+		return peer;
+	}
+
+	jobject lref = env->NewObject (GCUserPeer_class, GCUserPeer_ctor);
+	if (lref == nullptr) {
+		env->ExceptionClear ();
+		return nullptr;
+	}
+
+	jobject peer = env->NewGlobalRef (lref);
+	env->DeleteLocalRef (lref);
+	if (peer != nullptr) {
+		gc_gref_count.increment ();
+	}
+	return peer;
+}
+
+// Nothing but the references added during this pass may keep the temporary peers alive during the Java collection,
+// or the objects they reference would survive it as well.  Without JNI weak references (see
+// `platform_supports_weak_refs`) there's no way to find out whether a peer survived, so the peers are dropped
+// instead and nothing is pooled.
 void
-OSBridge::target_release (JNIEnv *env, OSBridge::AddReferenceTarget target)
+OSBridge::weaken_temporary_peers (JNIEnv *env)
 {
-	if (!target.is_mono_object)
-		env->DeleteLocalRef (target.jobj);
+	bool pool_peers = take_weak_global_ref == &OSBridge::take_weak_global_ref_jni;
+	int weakened = 0;
+	int deleted = 0;
+
+	for (jobject &peer : temporary_peers) {
+		if (peer == nullptr) {
+			continue;
+		}
+
+		jobject weak = pool_peers ? env->NewWeakGlobalRef (peer) : nullptr;
+		env->DeleteGlobalRef (peer);
+		peer = weak;
+		deleted++;
+		if (weak != nullptr) {
+			weakened++;
+		}
+	}
+
+	gc_gref_count.add (-deleted);
+	gc_weak_gref_count.add (weakened);
+}
+
+// Temporary peers which survived the Java collection have their references cleared and are returned to the pool
+void
+OSBridge::recycle_temporary_peers (JNIEnv *env)
+{
+	for (jobject weak : temporary_peers) {
+		if (weak == nullptr) {
+			continue;
+		}
+
+		jobject peer = env->NewGlobalRef (weak);
+		env->DeleteWeakGlobalRef (weak);
+		gc_weak_gref_count.decrement ();
+		if (peer == nullptr) {
+			continue;
+		}
+
+		if (temporary_peer_pool.size () >= TEMPORARY_PEER_POOL_MAX_SIZE) {
+			env->DeleteGlobalRef (peer);
+			continue;
+		}
+		gc_gref_count.increment ();
+
+		// Temporary peers are all GCUserPeer instances, there's no need to look their class up
+		env->CallVoidMethod (peer, GCUserPeer_clearReferences);
+		temporary_peer_pool.push_back (peer);
+	}
+
+	temporary_peers.clear ();
 }
 
 // Add a reference between objects if both are already known to be MonoObjects which are user peers
@@ -776,13 +1035,187 @@ OSBridge::add_reference_mono_object (JNIEnv *env, MonoObject *obj, MonoObject *r
 	return add_reference (env, target_from_mono_object (obj), target_from_mono_object (reffed_obj));
 }
 
-void
-OSBridge::gc_prepare_for_java_collection (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs)
+// Instead of calling `monodroidAddReference` through JNI for every SCC ring link and every cross reference (each
+// call costs GetObjectClass + GetMethodID + CallVoidMethod), collect all the links in a native buffer and hand them
+// over to Java in a single call to `mono.android.GCBridge.addReferences`.  Returns `false` if the batch couldn't be set up, nothing has been done to the
+// Java objects in that case and the caller should add the references one by one instead.
+bool
+OSBridge::add_references_batched (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs)
 {
-	/* Some SCCs might have no IGCUserPeers associated with them, so we must create one */
-	jobject temporary_peers = nullptr;     // This is an ArrayList
-	int temporary_peer_count = 0;       // Number of items in temporary_peers
+	if (GCBridge_addReferences == nullptr) {
+		return false;
+	}
+
+	size_t object_count = 0;
+	size_t temporary_peer_count = 0;
+	size_t max_link_count = static_cast<size_t>(num_xrefs);
+
+	/* Index of the first object of each SCC in the `peers` array. Bridgeless SCCs get a temporary peer, stored after
+	 * all the bridged objects. Its index isn't known until all the SCCs are counted, so we store its (negative,
+	 * one-based) ordinal for now.
+	 */
+	batch_scc_peer_index.resize (static_cast<size_t>(num_sccs));
+	for (int i = 0; i < num_sccs; i++) {
+		MonoGCBridgeSCC *scc = sccs [i];
+
+		/* num_objs < 0 case: This is a violation of the bridge API invariants. */
+		abort_unless (scc->num_objs >= 0, "Bridge processor submitted an SCC with a negative number of objects.");
+
+		if (scc->num_objs == 0) {
+			temporary_peer_count++;
+			batch_scc_peer_index [static_cast<size_t>(i)] = -static_cast<int>(temporary_peer_count);
+			continue;
+		}
+
+		batch_scc_peer_index [static_cast<size_t>(i)] = static_cast<int>(object_count);
+		object_count += static_cast<size_t>(scc->num_objs);
+
+		/* An SCC with more than one object is turned into a ring, so that it's collected as a single object */
+		if (scc->num_objs > 1) {
+			max_link_count += static_cast<size_t>(scc->num_objs);
+		}
+	}
+
+	abort_unless (
+		object_count + temporary_peer_count <= static_cast<size_t>(std::numeric_limits<jsize>::max ()),
+		"Too many objects submitted for bridge processing (%zu)", object_count + temporary_peer_count
+	);
+
+	auto peer_index = [this, object_count](int scc_index) -> size_t {
+		int index = batch_scc_peer_index [static_cast<size_t>(scc_index)];
+		if (index >= 0) {
+			return static_cast<size_t>(index);
+		}
+
+		return object_count + static_cast<size_t>(-index - 1);
+	};
 
+	jobjectArray peers = env->NewObjectArray (static_cast<jsize>(object_count + temporary_peer_count), Object_class, nullptr);
+	if (peers == nullptr) {
+		env->ExceptionClear ();
+		return false;
+	}
+
+	/* Objects without a Java handle (or bridge info) keep a `nullptr` entry, links from or to them are dropped,
+	 * just like `add_reference` does
+	 */
+	batch_objects.resize (object_count);
+	size_t k = 0;
+	for (int i = 0; i < num_sccs; i++) {
+		for (int j = 0; j < sccs [i]->num_objs; j++, k++) {
+			MonoObject *obj = sccs [i]->objs [j];
+			MonoJavaGCBridgeInfo *bridge_info = get_gc_bridge_info_for_object (obj);
+			jobject handle = nullptr;
+
+			if (bridge_info != nullptr) {
+				mono_field_get_value (obj, bridge_info->handle, &handle);
+			}
+
+			if (handle == nullptr) {
+				batch_objects [k] = nullptr;
+				continue;
+			}
+
+			batch_objects [k] = obj;
+			env->SetObjectArrayElement (peers, static_cast<jsize>(k), handle);
+		}
+	}
+
+	batch_links.resize (max_link_count * 2);
+	size_t n = 0;
+	auto add_link = [this, object_count, &n](size_t from, size_t to) {
+		if ((from < object_count && batch_objects [from] == nullptr) || (to < object_count && batch_objects [to] == nullptr)) {
+			return;
+		}
+
+		batch_links [n++] = static_cast<jint>(from);
+		batch_links [n++] = static_cast<jint>(to);
+	};
+
+	k = 0;
+	for (int i = 0; i < num_sccs; i++) {
+		size_t num_objs = static_cast<size_t>(sccs [i]->num_objs);
+
+		if (num_objs > 1) {
+			/* ref j from j-1, then the first from the final */
+			for (size_t j = 1; j < num_objs; j++) {
+				add_link (k + j - 1, k + j);
+			}
+			add_link (k + num_objs - 1, k);
+		}
+		k += num_objs;
+	}
+
+	for (int i = 0; i < num_xrefs; i++) {
+		add_link (peer_index (xrefs [i].src_scc_index), peer_index (xrefs [i].dst_scc_index));
+	}
+
+	size_t link_count = n / 2;
+	if (link_count == 0) {
+		env->DeleteLocalRef (peers);
+		return true;
+	}
+
+	jintArray links = env->NewIntArray (static_cast<jsize>(n));
+	jbooleanArray refs_added = env->NewBooleanArray (static_cast<jsize>(object_count));
+	if (links == nullptr || refs_added == nullptr) {
+		env->ExceptionClear ();
+		env->DeleteLocalRef (peers);
+		if (links != nullptr) {
+			env->DeleteLocalRef (links);
+		}
+		return false;
+	}
+	env->SetIntArrayRegion (links, 0, static_cast<jsize>(n), batch_links.data ());
+
+	for (size_t i = 0; i < temporary_peer_count; i++) {
+		jobject peer = acquire_temporary_peer (env);
+
+		temporary_peers.push_back (peer);
+		env->SetObjectArrayElement (peers, static_cast<jsize>(object_count + i), peer);
+	}
+
+	env->CallStaticVoidMethod (GCBridge_class, GCBridge_addReferences, peers, static_cast<jint>(object_count), links, static_cast<jint>(link_count), refs_added);
+	if (env->ExceptionCheck ()) {
+		log_error (LOG_GC, "Exception thrown while adding bridge references");
+		env->ExceptionDescribe ();
+		env->ExceptionClear ();
+	}
+
+	/* Flag MonoObjects so they can be cleared in gc_cleanup_after_java_collection.
+	 * Java temporaries do not need this, they are cleared by recycle_temporary_peers.
+	 */
+	if (object_count > 0) {
+		batch_refs_added.resize (object_count);
+		env->GetBooleanArrayRegion (refs_added, 0, static_cast<jsize>(object_count), batch_refs_added.data ());
+
+		int ref_val = 1;
+		for (k = 0; k < object_count; k++) {
+			if (batch_refs_added [k] == JNI_FALSE) {
+				continue;
+			}
+
+			MonoObject *obj = batch_objects [k];
+			mono_field_set_value (obj, get_gc_bridge_info_for_object (obj)->refs_added, &ref_val);
+		}
+	}
+
+	env->DeleteLocalRef (refs_added);
+	env->DeleteLocalRef (links);
+	env->DeleteLocalRef (peers);
+
+#if DEBUG
+	if (Logger::gc_spew_enabled ()) {
+		log_warn (LOG_GC, "Added %zu references (%zu temporary peers) in a single batch", link_count, temporary_peer_count);
+	}
+#endif
+
+	return true;
+}
+
+void
+OSBridge::add_references_one_by_one (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs)
+{
 	/* Before looking at xrefs, scan the SCCs. During collection, an SCC has to behave like a
 	 * single object. If the number of objects in the SCC is anything other than 1, the SCC
 	 * must be doctored to mimic that one-object nature.
@@ -820,64 +1253,177 @@ OSBridge::gc_prepare_for_java_collection (JNIEnv *env, int num_sccs, MonoGCBridg
 		 * Solution: Create a temporary Java object to stand in for the SCC.
 		 */
 		} else if (scc->num_objs == 0) {
-			/* Once per process boot, look up JNI metadata we need to make temporary objects */
-			if (ArrayList_class == nullptr) {
-				ArrayList_class = reinterpret_cast<jclass> (lref_to_gref (env, env->FindClass ("java/util/ArrayList")));
-				ArrayList_ctor = env->GetMethodID (ArrayList_class, "<init>", "()V");
-				ArrayList_add = env->GetMethodID (ArrayList_class, "add", "(Ljava/lang/Object;)Z");
-				ArrayList_get = env->GetMethodID (ArrayList_class, "get", "(I)Ljava/lang/Object;");
-
-				abort_unless (
-					ArrayList_class != nullptr && ArrayList_ctor != nullptr && ArrayList_get != nullptr,
-					"Failed to load classes required for JNI"
-				);
-			}
-
-			/* Once per gc_prepare_for_java_collection call, create a list to hold the temporary
-			 * objects we create. This will protect them from collection while we build the list.
-			 */
-			if (!temporary_peers) {
-				temporary_peers = env->NewObject (ArrayList_class, ArrayList_ctor);
-			}
-
-			/* Create this SCC's temporary object */
-			jobject peer = env->NewObject (GCUserPeer_class, GCUserPeer_ctor);
-			env->CallBooleanMethod (temporary_peers, ArrayList_add, peer);
-			env->DeleteLocalRef (peer);
-
 			/* See note on scc_get_stashed_index */
-			scc_set_stashed_index (scc, temporary_peer_count);
-			temporary_peer_count++;
+			scc_set_stashed_index (scc, static_cast<int>(temporary_peers.size ()));
+			temporary_peers.push_back (acquire_temporary_peer (env));
 		}
 	}
 
 	/* add the cross scc refs */
 	for (int i = 0; i < num_xrefs; i++) {
-		AddReferenceTarget src_target = target_from_scc (sccs, xrefs [i].src_scc_index, env, temporary_peers);
-		AddReferenceTarget dst_target = target_from_scc (sccs, xrefs [i].dst_scc_index, env, temporary_peers);
+		AddReferenceTarget src_target = target_from_scc (sccs, xrefs [i].src_scc_index);
+		AddReferenceTarget dst_target = target_from_scc (sccs, xrefs [i].dst_scc_index);
 
 		add_reference (env, src_target, dst_target);
-
-		target_release (env, src_target);
-		target_release (env, dst_target);
 	}
+}
+
+void
+OSBridge::gc_prepare_for_java_collection (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs)
+{
+	bulk_ref_flips = can_flip_refs_in_bulk ();
 
-	/* With xrefs processed, the temporary peer list can be released */
-	env->DeleteLocalRef (temporary_peers);
+	if (!use_batched_references || !add_references_batched (env, num_sccs, sccs, num_xrefs, xrefs)) {
+		add_references_one_by_one (env, num_sccs, sccs, num_xrefs, xrefs);
+	}
+	weaken_temporary_peers (env);
 
 	/* Post-xref cleanup on SCCs: Undo memoization, switch to weak refs */
 	for (int i = 0; i < num_sccs; i++) {
 		/* See note on scc_get_stashed_index */
 		if (sccs [i]->num_objs < 0)
 			sccs [i]->num_objs = 0;
+	}
+
+	if (bulk_ref_flips) {
+		flip_to_weak_refs (env, num_sccs, sccs);
+		return;
+	}
 
+	for (int i = 0; i < num_sccs; i++) {
 		for (int j = 0; j < sccs [i]->num_objs; j++) {
 			(this->*take_weak_global_ref) (env, sccs [i]->objs [j]);
 		}
 	}
 }
 
+// The bulk versions of `take_weak_global_ref_jni` and `take_global_ref_jni` below can be used only with JNI weak
+// references and when global reference logging is off, since the log needs to record every flip separately.
+bool
+OSBridge::can_flip_refs_in_bulk () const
+{
+	return
+		take_weak_global_ref == &OSBridge::take_weak_global_ref_jni &&
+		take_global_ref == &OSBridge::take_global_ref_jni &&
+		gref_log == nullptr &&
+		(log_categories & LOG_GREF) == 0 &&
+		!GrefAttribution::is_enabled (); // needs to see every reference change
+}
+
+// Switch all the SCC objects to weak references in a single pass. Compared to calling `take_weak_global_ref_jni` for
+// each object, the bridge info is looked up just once per object per bridge pass (it is cached for the cleanup phase),
+// no GetObjectRefType calls are made and the reference counters are updated once.
+//
+// The two JNI calls left per object and direction are the minimum: JNI has no way to turn a global reference into a
+// weak one (or back) other than creating the new reference and deleting the old one.  The difference to the per-object
+// path can be measured with tools/gc-bridge-bench, which uses the per-object path when gref logging is enabled.
 void
+OSBridge::flip_to_weak_refs (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs)
+{
+	int type = JNIWeakGlobalRefType;
+	int flipped = 0;
+
+	bridge_pass_info.clear ();
+	for (int i = 0; i < num_sccs; i++) {
+		for (int j = 0; j < sccs [i]->num_objs; j++) {
+			MonoObject *obj = sccs [i]->objs [j];
+			MonoJavaGCBridgeInfo *bridge_info = get_gc_bridge_info_for_object (obj);
+
+			bridge_pass_info.push_back (bridge_info);
+			if (bridge_info == nullptr) {
+				continue;
+			}
+
+			jobject handle;
+			mono_field_get_value (obj, bridge_info->handle, &handle);
+
+			jobject weak = env->NewWeakGlobalRef (handle);
+			env->DeleteGlobalRef (handle);
+
+			mono_field_set_value (obj, bridge_info->handle, &weak);
+			mono_field_set_value (obj, bridge_info->handle_type, &type);
+			flipped++;
+		}
+	}
+
+	gc_weak_gref_count.add (flipped);
+	gc_gref_count.add (-flipped);
+}
+
+// Counterpart of `flip_to_weak_refs`, returns the number of objects processed
+int
+OSBridge::flip_to_global_refs (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs)
+{
+	int type = JNIGlobalRefType;
+	int total = 0;
+	int weak_deleted = 0;
+	int global_created = 0;
+
+	for (int i = 0; i < num_sccs; i++) {
+		for (int j = 0; j < sccs [i]->num_objs; j++, total++) {
+			MonoObject *obj = sccs [i]->objs [j];
+			MonoJavaGCBridgeInfo *bridge_info = bridge_pass_info [static_cast<size_t>(total)];
+			if (bridge_info == nullptr) {
+				continue;
+			}
+
+			jobject weak;
+			mono_field_get_value (obj, bridge_info->handle, &weak);
+
+			jobject handle = env->NewGlobalRef (weak);
+			env->DeleteWeakGlobalRef (weak);
+			weak_deleted++;
+			if (handle != nullptr) {
+				global_created++;
+			}
+
+			mono_field_set_value (obj, bridge_info->handle, &handle);
+			mono_field_set_value (obj, bridge_info->handle_type, &type);
+		}
+	}
+
+	gc_weak_gref_count.add (-weak_deleted);
+	gc_gref_count.add (global_created);
+
+	return total;
+}
+
+// Calls `monodroidClearReferences` on all the peers in `batch_clear_peers` with a single call to
+// `mono.android.GCBridge.clearReferences`, which checks that they implement IGCUserPeer with `instanceof`.  Looking the
+// method up for every object here would cost a GetObjectClass call (and an IsSameObject one) per object.
+void
+OSBridge::clear_references_batched (JNIEnv *env)
+{
+	jobjectArray peers = env->NewObjectArray (static_cast<jsize>(batch_clear_peers.size ()), Object_class, nullptr);
+	if (peers == nullptr) [[unlikely]] {
+		env->ExceptionClear ();
+
+		for (jobject peer : batch_clear_peers) {
+			jmethodID clear_method_id = get_peer_methods (env, nullptr, peer)->clear_references;
+			if (clear_method_id != nullptr) {
+				env->CallVoidMethod (peer, clear_method_id);
+			}
+		}
+		batch_clear_peers.clear ();
+		return;
+	}
+
+	for (size_t i = 0; i < batch_clear_peers.size (); i++) {
+		env->SetObjectArrayElement (peers, static_cast<jsize>(i), batch_clear_peers [i]);
+	}
+	batch_clear_peers.clear ();
+
+	env->CallStaticVoidMethod (GCBridge_class, GCBridge_clearReferences, peers);
+	if (env->ExceptionCheck ()) {
+		log_error (LOG_GC, "Exception thrown while clearing bridge references");
+		env->ExceptionDescribe ();
+		env->ExceptionClear ();
+	}
+	env->DeleteLocalRef (peers);
+}
+
+// Returns the number of objects which survived the Java collection
+int
 OSBridge::gc_cleanup_after_java_collection (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs)
 {
 #if DEBUG
@@ -891,20 +1437,25 @@ OSBridge::gc_cleanup_after_java_collection (JNIEnv *env, int num_sccs, MonoGCBri
 	total = alive = 0;
 
 	/* try to switch back to global refs to analyze what stayed alive */
-	for (i = 0; i < num_sccs; i++)
-		for (j = 0; j < sccs [i]->num_objs; j++, total++)
-			(this->*take_global_ref) (env, sccs [i]->objs [j]);
+	if (bulk_ref_flips) {
+		total = flip_to_global_refs (env, num_sccs, sccs);
+	} else {
+		for (i = 0; i < num_sccs; i++)
+			for (j = 0; j < sccs [i]->num_objs; j++, total++)
+				(this->*take_global_ref) (env, sccs [i]->objs [j]);
+	}
 
 	/* clear the cross references on any remaining items */
+	size_t k = 0;
 	for (i = 0; i < num_sccs; i++) {
 		sccs [i]->is_alive = 0;
 
-		for (j = 0; j < sccs [i]->num_objs; j++) {
+		for (j = 0; j < sccs [i]->num_objs; j++, k++) {
 			MonoJavaGCBridgeInfo    *bridge_info;
 
 			obj = sccs [i]->objs [j];
 
-			bridge_info = get_gc_bridge_info_for_object (obj);
+			bridge_info = bulk_ref_flips ? bridge_pass_info [k] : get_gc_bridge_info_for_object (obj);
 			if (bridge_info == nullptr)
 				continue;
 			mono_field_get_value (obj, bridge_info->handle, &jref);
@@ -914,14 +1465,13 @@ OSBridge::gc_cleanup_after_java_collection (JNIEnv *env, int num_sccs, MonoGCBri
 					abort_unless (sccs [i]->is_alive, "Bridge SCC at index %d must be alive", i);
 				sccs [i]->is_alive = 1;
 				mono_field_get_value (obj, bridge_info->refs_added, &refs_added);
-				if (refs_added) {
-					jclass java_class = env->GetObjectClass (jref);
-					clear_method_id = env->GetMethodID (java_class, "monodroidClearReferences", "()V");
-					env->DeleteLocalRef (java_class);
+				if (refs_added && GCBridge_clearReferences != nullptr) {
+					batch_clear_peers.push_back (jref);
+				} else if (refs_added) {
+					clear_method_id = get_peer_methods (env, mono_object_get_class (obj), jref)->clear_references;
 					if (clear_method_id) {
 						env->CallVoidMethod (jref, clear_method_id);
 					} else {
-						env->ExceptionClear ();
 #if DEBUG
 						if (Logger::gc_spew_enabled ()) {
 							klass = mono_object_get_class (obj);
@@ -937,9 +1487,17 @@ OSBridge::gc_cleanup_after_java_collection (JNIEnv *env, int num_sccs, MonoGCBri
 			}
 		}
 	}
+
+	if (!batch_clear_peers.empty ()) {
+		clear_references_batched (env);
+	}
+	recycle_temporary_peers (env);
+
 #if DEBUG
 	log_info (LOG_GC, "GC cleanup summary: %d objects tested - resurrecting %d.", total, alive);
 #endif
+
+	return alive;
 }
 
 void
@@ -948,6 +1506,75 @@ OSBridge::java_gc (JNIEnv *env)
 	env->CallVoidMethod (Runtime_instance, Runtime_gc);
 }
 
+// Called from the GC event callback (with `java-gc=adaptive` only) when Mono starts a collection, on the thread which
+// then runs the bridge pass
+void
+OSBridge::gc_started (uint32_t generation)
+{
+	__atomic_store_n (&collection_generation, generation, __ATOMIC_RELAXED);
+}
+
+// Running the Java GC is what makes the bridge pass expensive, but without it no weak reference gets cleared, that is
+// all the bridged objects survive the pass.  Skipping it is therefore always safe, it merely postpones collecting the
+// unreachable peers to a later pass.  With `java-gc=adaptive`, we skip it when it's unlikely to be worth it: the graph
+// is small, it's the same one the previous Java GC kept alive in its entirety, or the previous Java GC ran very
+// recently.  To bound the delay, we never skip more than `java_gc_max_skips` passes in a row, nor when the process is
+// running low on global references.
+//
+// Passes of full collections are never skipped either: that's what `GC.Collect ()` (and the GREF pressure monitor)
+// asks for, and code which collects explicitly expects the unreachable peers to be gone afterwards.  Mono doesn't tell
+// explicit collections apart from the others, so the major collections it starts on its own run the Java GC too.
+OSBridge::JavaGCDecision
+OSBridge::decide_java_gc (uint64_t num_objects, uint64_t graph_fingerprint, uint64_t now_ns)
+{
+	if (!adaptive_java_gc || last_java_gc_ns == 0 || java_gc_consecutive_skips >= java_gc_max_skips) {
+		return JavaGCDecision::Force;
+	}
+
+	if (__atomic_load_n (&collection_generation, __ATOMIC_RELAXED) >= static_cast<uint32_t>(mono_gc_max_generation ())) {
+		return JavaGCDecision::Force;
+	}
+
+	if (gc_gref_count.get () >= AndroidSystem::get_max_gref_count () / 2) {
+		return JavaGCDecision::Force;
+	}
+
+	JavaGCDecision decision;
+	if (num_objects <= java_gc_small_graph_objects) {
+		decision = JavaGCDecision::SkipSmallGraph;
+	} else if (last_java_gc_kept_everything && graph_fingerprint == last_java_gc_graph_fingerprint) {
+		decision = JavaGCDecision::SkipUnchangedGraph;
+	} else if (now_ns - last_java_gc_ns < java_gc_min_interval_ns) {
+		decision = JavaGCDecision::SkipRecentCollection;
+	} else {
+		return JavaGCDecision::Force;
+	}
+
+	java_gc_consecutive_skips++;
+	return decision;
+}
+
+// Hash of the bridged objects and the number of SCCs and cross references, which doesn't depend on the order of the
+// objects.  Objects moved by the GC make the graph look different, which just means that the Java GC runs.
+uint64_t
+OSBridge::get_graph_fingerprint (int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs)
+{
+	graph_fingerprint_data.clear ();
+	graph_fingerprint_data.push_back (static_cast<uintptr_t>(num_sccs));
+	graph_fingerprint_data.push_back (static_cast<uintptr_t>(num_xrefs));
+	for (int i = 0; i < num_sccs; i++) {
+		for (int j = 0; j < sccs [i]->num_objs; j++) {
+			graph_fingerprint_data.push_back (reinterpret_cast<uintptr_t>(sccs [i]->objs [j]));
+		}
+	}
+	std::sort (graph_fingerprint_data.begin () + 2, graph_fingerprint_data.end ());
+
+	return xxhash64::hash (
+		reinterpret_cast<const char*>(graph_fingerprint_data.data ()),
+		graph_fingerprint_data.size () * sizeof (uintptr_t)
+	);
+}
+
 void
 OSBridge::set_bridge_processing_field (MonodroidBridgeProcessingInfo *list, mono_bool value)
 {
@@ -990,15 +1617,168 @@ OSBridge::gc_cross_references (int num_sccs, MonoGCBridgeSCC **sccs, int num_xre
 	}
 #endif
 
-	env = ensure_jnienv ();
+	uint64_t pass_start = gc_bridge_now_ns ();
+
+	uint64_t num_objects = 0;
+	for (int i = 0; i < num_sccs; i++) {
+		num_objects += static_cast<uint64_t>(sccs [i]->num_objs);
+	}
+
+	uint64_t graph_fingerprint = adaptive_java_gc ? get_graph_fingerprint (num_sccs, sccs, num_xrefs) : 0;
+	JavaGCDecision decision = decide_java_gc (num_objects, graph_fingerprint, pass_start);
+	uint64_t phase_start = 0, prepare_end = 0, java_gc_end = 0, cleanup_end = 0;
+
+	if (decision == JavaGCDecision::Force) {
+		env = ensure_jnienv ();
+
+		set_bridge_processing_field (domains_list, 1);
+		phase_start = gc_bridge_now_ns ();
+		gc_prepare_for_java_collection (env, num_sccs, sccs, num_xrefs, xrefs);
+		prepare_end = gc_bridge_now_ns ();
+
+		java_gc (env);
+		java_gc_end = gc_bridge_now_ns ();
+
+		int alive = gc_cleanup_after_java_collection (env, num_sccs, sccs);
+		cleanup_end = gc_bridge_now_ns ();
+		set_bridge_processing_field (domains_list, 0);
+
+		java_gc_consecutive_skips = 0;
+		last_java_gc_ns = java_gc_end;
+		last_java_gc_graph_fingerprint = graph_fingerprint;
+		last_java_gc_kept_everything = static_cast<uint64_t>(alive) == num_objects;
+	} else {
+		// Same outcome as a Java GC which didn't collect anything, see `decide_java_gc`
+		for (int i = 0; i < num_sccs; i++) {
+			sccs [i]->is_alive = 1;
+		}
+	}
+	uint64_t pass_end = gc_bridge_now_ns ();
+
+	__atomic_add_fetch (&bridge_stats_sequence, 1, __ATOMIC_ACQ_REL);
+	switch (decision) {
+		case JavaGCDecision::Force:
+			bridge_stats.java_gc_forced++;
+			record_gc_bridge_phase (GCBridgePhase::Prepare, prepare_end - phase_start);
+			record_gc_bridge_phase (GCBridgePhase::JavaGC, java_gc_end - prepare_end);
+			record_gc_bridge_phase (GCBridgePhase::Cleanup, cleanup_end - java_gc_end);
+			break;
+
+		case JavaGCDecision::SkipSmallGraph:
+			bridge_stats.java_gc_skipped_small_graph++;
+			break;
+
+		case JavaGCDecision::SkipUnchangedGraph:
+			bridge_stats.java_gc_skipped_unchanged_graph++;
+			break;
+
+		case JavaGCDecision::SkipRecentCollection:
+			bridge_stats.java_gc_skipped_recent_collection++;
+			break;
+	}
+	record_gc_bridge_phase (GCBridgePhase::CrossReferences, pass_end - pass_start);
+
+	auto update_counts = [](uint64_t &total, uint64_t &max, uint64_t value) {
+		total += value;
+		if (value > max) {
+			max = value;
+		}
+	};
+	update_counts (bridge_stats.total_sccs, bridge_stats.max_sccs, static_cast<uint64_t>(num_sccs));
+	update_counts (bridge_stats.total_xrefs, bridge_stats.max_xrefs, static_cast<uint64_t>(num_xrefs));
+	update_counts (bridge_stats.total_objects, bridge_stats.max_objects, num_objects);
+	__atomic_add_fetch (&bridge_stats_sequence, 1, __ATOMIC_ACQ_REL);
+
+	if (decision != JavaGCDecision::Force) {
+		log_info (
+			LOG_GC,
+			"GC bridge: %d SCCs, %d xrefs, %llu objects; java gc skipped (%s), total %llu us",
+			num_sccs,
+			num_xrefs,
+			static_cast<unsigned long long>(num_objects),
+			decision == JavaGCDecision::SkipSmallGraph ? "small graph" :
+				decision == JavaGCDecision::SkipUnchangedGraph ? "unchanged graph" : "recent collection",
+			static_cast<unsigned long long>((pass_end - pass_start) / 1000)
+		);
+		return;
+	}
+
+	log_info (
+		LOG_GC,
+		"GC bridge: %d SCCs, %d xrefs, %llu objects; prepare %llu us, java gc %llu us, cleanup %llu us, total %llu us",
+		num_sccs,
+		num_xrefs,
+		static_cast<unsigned long long>(num_objects),
+		static_cast<unsigned long long>((prepare_end - phase_start) / 1000),
+		static_cast<unsigned long long>((java_gc_end - prepare_end) / 1000),
+		static_cast<unsigned long long>((cleanup_end - java_gc_end) / 1000),
+		static_cast<unsigned long long>((pass_end - pass_start) / 1000)
+	);
+}
+
+void
+OSBridge::record_gc_bridge_phase (GCBridgePhase phase, uint64_t elapsed_ns)
+{
+	GCBridgePhaseStats &stats = bridge_stats.phases [static_cast<size_t>(phase)];
+
+	stats.count++;
+	stats.total_ns += elapsed_ns;
+	if (elapsed_ns > stats.max_ns) {
+		stats.max_ns = elapsed_ns;
+	}
+
+	uint64_t elapsed_us = elapsed_ns / 1000;
+	size_t bucket = elapsed_us == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll (elapsed_us));
+	if (bucket >= GC_BRIDGE_HISTOGRAM_BUCKETS) {
+		bucket = GC_BRIDGE_HISTOGRAM_BUCKETS - 1;
+	}
+	stats.histogram [bucket]++;
+}
+
+// Can be called from any thread, while bridge processing is in progress, too
+void
+OSBridge::get_gc_bridge_stats (GCBridgeStats &stats)
+{
+	uint32_t sequence;
+
+	do {
+		sequence = __atomic_load_n (&bridge_stats_sequence, __ATOMIC_ACQUIRE);
+		if ((sequence & 1) != 0) {
+			continue;
+		}
 
-	set_bridge_processing_field (domains_list, 1);
-	gc_prepare_for_java_collection (env, num_sccs, sccs, num_xrefs, xrefs);
+		memcpy (&stats, &bridge_stats, sizeof (stats));
+		__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	} while ((sequence & 1) != 0 || sequence != __atomic_load_n (&bridge_stats_sequence, __ATOMIC_RELAXED));
+
+	// The callback counters are updated outside the pass, they need no consistency with the rest
+	auto sum = [this] (uint64_t BridgeCallbackCounters::*counter) -> uint64_t {
+		uint64_t total = 0;
+		for (BridgeCallbackCounters &counters : callback_counters) {
+			total += __atomic_load_n (&(counters.*counter), __ATOMIC_RELAXED);
+		}
+		return total;
+	};
+
+	stats.class_kind_calls = sum (&BridgeCallbackCounters::class_kind_calls);
+	stats.class_kind_timed_calls = sum (&BridgeCallbackCounters::class_kind_timed_calls);
+	stats.class_kind_timed_ns = sum (&BridgeCallbackCounters::class_kind_timed_ns);
+	stats.is_bridge_object_calls = sum (&BridgeCallbackCounters::is_bridge_object_calls);
+	stats.is_bridge_object_timed_calls = sum (&BridgeCallbackCounters::is_bridge_object_timed_calls);
+	stats.is_bridge_object_timed_ns = sum (&BridgeCallbackCounters::is_bridge_object_timed_ns);
+}
 
-	java_gc (env);
+// Called once per thread, on its first bridge callback
+OSBridge::BridgeCallbackCounters*
+OSBridge::claim_callback_counters () noexcept
+{
+	uint32_t slot = __atomic_fetch_add (&callback_counter_slots_used, 1, __ATOMIC_RELAXED);
+	if (slot >= MAX_CALLBACK_COUNTER_SLOTS) {
+		slot = MAX_CALLBACK_COUNTER_SLOTS - 1;
+	}
 
-	gc_cleanup_after_java_collection (env, num_sccs, sccs);
-	set_bridge_processing_field (domains_list, 0);
+	thread_callback_counters = &callback_counters [slot];
+	return thread_callback_counters;
 }
 
 int
@@ -1040,10 +1820,121 @@ OSBridge::platform_supports_weak_refs (void)
 }
 
 void
-OSBridge::register_gc_hooks (void)
+OSBridge::parse_gc_bridge_options ()
+{
+	dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> value;
+	if (AndroidSystem::monodroid_get_system_property (SharedConstants::DEBUG_MONO_GC_BRIDGE_PROPERTY, value) <= 0) {
+		return;
+	}
+
+	constexpr std::string_view NO_BATCHING { "no-batching" };
+	constexpr std::string_view JAVA_GC_ALWAYS { "java-gc=always" };
+	constexpr std::string_view JAVA_GC_ADAPTIVE { "java-gc=adaptive" };
+	constexpr std::string_view JAVA_GC_MAX_SKIPS { "java-gc-max-skips=" };
+	constexpr std::string_view JAVA_GC_MIN_INTERVAL { "java-gc-min-interval=" };
+	constexpr std::string_view JAVA_GC_SMALL_GRAPH { "java-gc-small-graph=" };
+	constexpr std::string_view GREF_PRESSURE_ON { "gref-pressure=on" };
+	constexpr std::string_view GREF_PRESSURE_OFF { "gref-pressure=off" };
+	constexpr std::string_view GREF_PRESSURE_HIGH { "gref-pressure-high=" };
+	constexpr std::string_view GREF_PRESSURE_LOW { "gref-pressure-low=" };
+	constexpr std::string_view GREF_PRESSURE_LEAD { "gref-pressure-lead=" };
+	constexpr std::string_view GREF_PRESSURE_MIN_INTERVAL { "gref-pressure-min-interval=" };
+
+	auto parse_number = [](string_segment const& token, std::string_view const& name, auto &result) {
+		if (!token.to_integer (result, name.length ())) {
+			log_warn (LOG_GC, "GC bridge: invalid value of the '%.*s' option", static_cast<int>(name.length () - 1), name.data ());
+		}
+	};
+
+	string_segment token;
+	while (value.next_token (',', token)) {
+		if (token.equal (NO_BATCHING)) {
+			use_batched_references = false;
+			log_info (LOG_GC, "GC bridge: references will be added one by one");
+			continue;
+		}
+
+		if (token.equal (JAVA_GC_ALWAYS)) {
+			adaptive_java_gc = false;
+			log_info (LOG_GC, "GC bridge: Java GC will run on every bridge pass");
+			continue;
+		}
+
+		if (token.equal (JAVA_GC_ADAPTIVE)) {
+			adaptive_java_gc = true;
+			continue;
+		}
+
+		if (token.starts_with (JAVA_GC_MAX_SKIPS)) {
+			parse_number (token, JAVA_GC_MAX_SKIPS, java_gc_max_skips);
+			continue;
+		}
+
+		if (token.starts_with (JAVA_GC_MIN_INTERVAL)) {
+			uint64_t interval_ms = java_gc_min_interval_ns / 1000000;
+			parse_number (token, JAVA_GC_MIN_INTERVAL, interval_ms);
+			java_gc_min_interval_ns = interval_ms * 1000000;
+			continue;
+		}
+
+		if (token.starts_with (JAVA_GC_SMALL_GRAPH)) {
+			parse_number (token, JAVA_GC_SMALL_GRAPH, java_gc_small_graph_objects);
+			continue;
+		}
+
+		if (token.equal (GREF_PRESSURE_ON)) {
+			GrefPressureMonitor::enabled = true;
+			continue;
+		}
+
+		if (token.equal (GREF_PRESSURE_OFF)) {
+			GrefPressureMonitor::enabled = false;
+			continue;
+		}
+
+		if (token.starts_with (GREF_PRESSURE_HIGH)) {
+			parse_number (token, GREF_PRESSURE_HIGH, GrefPressureMonitor::high_percent);
+			continue;
+		}
+
+		if (token.starts_with (GREF_PRESSURE_LOW)) {
+			parse_number (token, GREF_PRESSURE_LOW, GrefPressureMonitor::low_percent);
+			continue;
+		}
+
+		if (token.starts_with (GREF_PRESSURE_LEAD)) {
+			parse_number (token, GREF_PRESSURE_LEAD, GrefPressureMonitor::lead_ms);
+			continue;
+		}
+
+		if (token.starts_with (GREF_PRESSURE_MIN_INTERVAL)) {
+			parse_number (token, GREF_PRESSURE_MIN_INTERVAL, GrefPressureMonitor::min_interval_ms);
+			continue;
+		}
+
+		log_warn (LOG_GC, "Unsupported '%s' option '%.*s'", SharedConstants::DEBUG_MONO_GC_BRIDGE_PROPERTY.data (), static_cast<int>(token.length ()), token.start ());
+	}
+}
+
+void
+OSBridge::register_gc_hooks (MonoProfilerHandle profiler)
 {
 	MonoGCBridgeCallbacks bridge_cbs;
 
+	parse_gc_bridge_options ();
+	GrefPressureMonitor::configure (AndroidSystem::get_max_gref_count ());
+
+	// The count returned when a global reference is created is compared with `gref_gc_threshold` by the managed code
+	// and with the GREF pressure levels.  Approximate counts are fine while they're clearly below both, near them
+	// (and with low limits, e.g. 2000 references on emulators) only the exact count will do.
+	long watched_level = std::min (AndroidSystem::get_gref_gc_threshold (), static_cast<long>(GrefPressureMonitor::get_low_level ()));
+	exact_gref_count_level = static_cast<int>(std::max (watched_level - ShardedCounter::MAX_APPROXIMATION_ERROR, 0L));
+
+	long max_gref_count = AndroidSystem::get_max_gref_count ();
+	if (max_gref_count < std::numeric_limits<int>::max ()) {
+		ref_log_flush_level = static_cast<int>(max_gref_count - max_gref_count / 20);
+	}
+
 	if (platform_supports_weak_refs ()) {
 		take_global_ref = &OSBridge::take_global_ref_jni;
 		take_weak_global_ref = &OSBridge::take_weak_global_ref_jni;
@@ -1059,6 +1950,11 @@ OSBridge::register_gc_hooks (void)
 	bridge_cbs.is_bridge_object = gc_is_bridge_object_cb;
 	bridge_cbs.cross_references = gc_cross_references_cb;
 	mono_gc_register_bridge_callbacks (&bridge_cbs);
+
+	// Only the adaptive Java GC needs to know which collection the bridge pass belongs to, see `decide_java_gc`
+	if (adaptive_java_gc) {
+		mono_profiler_set_gc_event_callback (profiler, gc_event_cb);
+	}
 }
 
 JNIEnv*
@@ -1096,6 +1992,9 @@ OSBridge::initialize_on_onload (JavaVM *vm, JNIEnv *env)
 		weakrefClass != nullptr && weakrefCtor != nullptr && weakrefGet != nullptr,
 		"Failed to look up required java.lang.ref.WeakReference members"
 	);
+
+	Object_class = reinterpret_cast<jclass> (lref_to_gref (env, env->FindClass ("java/lang/Object")));
+	abort_unless (Object_class != nullptr, "Failed to look up java.lang.Object");
 }
 
 void
@@ -1104,7 +2003,24 @@ OSBridge::initialize_on_runtime_init (JNIEnv *env, jclass runtimeClass)
 	abort_if_invalid_pointer_argument (env);
 	GCUserPeer_class      = RuntimeUtil::get_class_from_runtime_field(env, runtimeClass, "mono_android_GCUserPeer", true);
 	GCUserPeer_ctor       = env->GetMethodID (GCUserPeer_class, "<init>", "()V");
-	abort_unless (GCUserPeer_class != nullptr && GCUserPeer_ctor != nullptr, "Failed to load mono.android.GCUserPeer!");
+	GCUserPeer_clearReferences = env->GetMethodID (GCUserPeer_class, "monodroidClearReferences", "()V");
+	abort_unless (GCUserPeer_class != nullptr && GCUserPeer_ctor != nullptr && GCUserPeer_clearReferences != nullptr, "Failed to load mono.android.GCUserPeer!");
+
+	// Not fatal, if the helper is missing we fall back to adding bridge references one by one
+	GCBridge_class        = RuntimeUtil::get_class_from_runtime_field (env, runtimeClass, "mono_android_GCBridge", true);
+	if (GCBridge_class != nullptr) {
+		GCBridge_addReferences = env->GetStaticMethodID (GCBridge_class, "addReferences", "([Ljava/lang/Object;I[II[Z)V");
+		if (GCBridge_addReferences != nullptr) {
+			GCBridge_clearReferences = env->GetStaticMethodID (GCBridge_class, "clearReferences", "([Ljava/lang/Object;)V");
+		}
+	}
+
+	if (GCBridge_addReferences == nullptr || GCBridge_clearReferences == nullptr) {
+		env->ExceptionClear ();
+		GCBridge_addReferences = nullptr;
+		GCBridge_clearReferences = nullptr;
+		log_warn (LOG_GC, "mono.android.GCBridge not found, bridge references will not be batched");
+	}
 }
 
 void
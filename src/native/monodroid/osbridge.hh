@@ -2,10 +2,18 @@
 #ifndef __OS_BRIDGE_H
 #define __OS_BRIDGE_H
 
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include <jni.h>
 #include <mono/metadata/appdomain.h>
+#include <mono/metadata/profiler.h>
 #include <mono/metadata/sgen-bridge.h>
 
+#include "sharded-counter.hh"
+
 namespace xamarin::android::internal
 {
 	class OSBridge
@@ -55,6 +63,94 @@ namespace xamarin::android::internal
 
 		using MonodroidGCTakeRefFunc = mono_bool (OSBridge::*) (JNIEnv *env, MonoObject *obj);
 
+		enum class JavaGCDecision
+		{
+			Force,
+			SkipSmallGraph,
+			SkipUnchangedGraph,
+			SkipRecentCollection,
+		};
+
+		// Phases of a single bridge processing pass, `CrossReferences` covers the whole `cross_references` callback
+		enum class GCBridgePhase : uint32_t
+		{
+			CrossReferences = 0,
+			Prepare         = 1, // adding references between the Java peers
+			JavaGC          = 2,
+			Cleanup         = 3, // finding out which peers survived and clearing references
+
+			Count,
+		};
+
+		// Bucket 0 counts durations below 1us, bucket N (N > 0) counts durations in the [2^(N-1)us, 2^Nus) range. The
+		// last bucket also counts everything longer than that.
+		static constexpr size_t GC_BRIDGE_HISTOGRAM_BUCKETS = 24;
+
+		struct GCBridgePhaseStats
+		{
+			uint64_t  count;
+			uint64_t  total_ns;
+			uint64_t  max_ns;
+			uint64_t  histogram[GC_BRIDGE_HISTOGRAM_BUCKETS];
+		};
+
+		struct GCBridgeStats
+		{
+			GCBridgePhaseStats  phases[static_cast<size_t>(GCBridgePhase::Count)];
+
+			// Totals and maximums over all the bridge passes
+			uint64_t            total_sccs;
+			uint64_t            total_xrefs;
+			uint64_t            total_objects;
+			uint64_t            max_sccs;
+			uint64_t            max_xrefs;
+			uint64_t            max_objects;
+
+			// Invocations of the other two bridge callbacks.  Only every BRIDGE_CALLBACK_TIMING_INTERVAL-th call is
+			// timed, `*_timed_ns` is the total duration of the `*_timed_calls` timed ones.
+			uint64_t            class_kind_calls;
+			uint64_t            class_kind_timed_calls;
+			uint64_t            class_kind_timed_ns;
+			uint64_t            is_bridge_object_calls;
+			uint64_t            is_bridge_object_timed_calls;
+			uint64_t            is_bridge_object_timed_ns;
+
+			// Bridge passes which ran the Java GC and those which skipped it, by reason (see `decide_java_gc`)
+			uint64_t            java_gc_forced;
+			uint64_t            java_gc_skipped_small_graph;
+			uint64_t            java_gc_skipped_unchanged_graph;
+			uint64_t            java_gc_skipped_recent_collection;
+		};
+
+		// SGen calls `bridge_class_kind` and `is_bridge_object` from all of its worker threads while marking, so every
+		// thread counts the calls in a slot of its own (see `get_callback_counters`) and the slots are summed up only by
+		// `get_gc_bridge_stats`.  Threads keep their slot until the process exits, the last slot is shared by all the
+		// threads which didn't get one.
+		static constexpr size_t   MAX_CALLBACK_COUNTER_SLOTS = 32;
+		static constexpr uint64_t BRIDGE_CALLBACK_TIMING_INTERVAL = 64; // must be a power of 2
+
+		struct alignas(64) BridgeCallbackCounters
+		{
+			uint64_t  class_kind_calls;
+			uint64_t  class_kind_timed_calls;
+			uint64_t  class_kind_timed_ns;
+			uint64_t  is_bridge_object_calls;
+			uint64_t  is_bridge_object_timed_calls;
+			uint64_t  is_bridge_object_timed_ns;
+		};
+
+		// IGCUserPeer methods of a Java class, a null method ID means the class doesn't implement it. Entries are
+		// keyed by the managed class of the peer (`nullptr` for temporary peers), but since instances of the same
+		// managed class may wrap instances of different Java classes, the Java class is always compared as well.
+		struct PeerMethods
+		{
+			MonoClass    *klass;
+			jclass        java_class; // global reference
+			jmethodID     add_reference;
+			jmethodID     clear_references;
+			PeerMethods  *next;
+		};
+
 		static const MonoJavaGCBridgeType empty_bridge_type;
 		static const MonoJavaGCBridgeType mono_xa_gc_bridge_types[];
 		static const MonoJavaGCBridgeType mono_ji_gc_bridge_types[];
@@ -68,16 +164,17 @@ namespace xamarin::android::internal
 
 	public:
 		void clear_mono_java_gc_bridge_info ();
+		void invalidate_gc_bridge_class_cache ();
 		jobject	lref_to_gref (JNIEnv *env, jobject lref);
 
 		int get_gc_gref_count () const
 		{
-			return gc_gref_count;
+			return gc_gref_count.get ();
 		}
 
 		int get_gc_weak_gref_count () const
 		{
-			return gc_weak_gref_count;
+			return gc_weak_gref_count.get ();
 		}
 
 		const MonoJavaGCBridgeType& get_java_gc_bridge_type (uint32_t index)
@@ -114,7 +211,8 @@ namespace xamarin::android::internal
 		void _monodroid_lref_log_new (int lrefc, jobject handle, char type, const char *threadName, int threadId, const char *from, int from_writable);
 		void _monodroid_lref_log_delete (int lrefc, jobject handle, char type, const char *threadName, int threadId, const char *from, int from_writable);
 		void monodroid_disable_gc_hooks ();
-		void register_gc_hooks ();
+		void register_gc_hooks (MonoProfilerHandle profiler);
+		void gc_started (uint32_t generation);
 		MonoGCBridgeObjectKind gc_bridge_class_kind (MonoClass *klass);
 		mono_bool gc_is_bridge_object (MonoObject *object);
 		void gc_cross_references (int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs);
@@ -123,10 +221,35 @@ namespace xamarin::android::internal
 		void initialize_on_onload (JavaVM *vm, JNIEnv *env);
 		void initialize_on_runtime_init (JNIEnv *env, jclass runtimeClass);
 		void add_monodroid_domain (MonoDomain *domain);
+		void get_gc_bridge_stats (GCBridgeStats &stats);
+
+		BridgeCallbackCounters& get_callback_counters () noexcept
+		{
+			BridgeCallbackCounters *counters = thread_callback_counters;
+			if (counters == nullptr) [[unlikely]] {
+				counters = claim_callback_counters ();
+			}
+			return *counters;
+		}
+
+		// Returns the new value of `counter`, which must be a member of `counters`
+		uint64_t add_to_callback_counter (BridgeCallbackCounters &counters, uint64_t &counter, uint64_t value) noexcept
+		{
+			if (&counters == &callback_counters [MAX_CALLBACK_COUNTER_SLOTS - 1]) [[unlikely]] {
+				return __atomic_add_fetch (&counter, value, __ATOMIC_RELAXED);
+			}
+
+			// The slot's thread is the only writer, the readers just need to see whole values
+			uint64_t new_value = __atomic_load_n (&counter, __ATOMIC_RELAXED) + value;
+			__atomic_store_n (&counter, new_value, __ATOMIC_RELAXED);
+			return new_value;
+		}
 		void on_destroy_contexts ();
 
 	private:
+		BridgeCallbackCounters* claim_callback_counters () noexcept;
 		int get_gc_bridge_index (MonoClass *klass);
+		int find_gc_bridge_index (MonoClass *klass);
 		MonoJavaGCBridgeInfo* get_gc_bridge_info_for_class (MonoClass *klass);
 		MonoJavaGCBridgeInfo* get_gc_bridge_info_for_object (MonoObject *object);
 		char get_object_ref_type (JNIEnv *env, void *handle);
@@ -138,28 +261,50 @@ namespace xamarin::android::internal
 		mono_bool take_weak_global_ref_2_1_compat (JNIEnv *env, MonoObject *obj);
 		mono_bool take_global_ref_jni (JNIEnv *env, MonoObject *obj);
 		mono_bool take_weak_global_ref_jni (JNIEnv *env, MonoObject *obj);
-		mono_bool add_reference_jobject (JNIEnv *env, jobject handle, jobject reffed_handle);
+		mono_bool add_reference_jobject (JNIEnv *env, MonoClass *klass, jobject handle, jobject reffed_handle);
 		mono_bool load_reference_target (AddReferenceTarget target, MonoJavaGCBridgeInfo** bridge_info, jobject *handle);
 		mono_bool add_reference (JNIEnv *env, AddReferenceTarget target, AddReferenceTarget reffed_target);
 		AddReferenceTarget target_from_mono_object (MonoObject *obj);
 		AddReferenceTarget target_from_jobject (jobject jobj);
 		int scc_get_stashed_index (MonoGCBridgeSCC *scc);
 		void scc_set_stashed_index (MonoGCBridgeSCC *scc, int index);
-		AddReferenceTarget target_from_scc (MonoGCBridgeSCC **sccs, int idx, JNIEnv *env, jobject temporary_peers);
-		void target_release (JNIEnv *env, AddReferenceTarget target);
+		AddReferenceTarget target_from_scc (MonoGCBridgeSCC **sccs, int idx);
+		jobject acquire_temporary_peer (JNIEnv *env);
+		void weaken_temporary_peers (JNIEnv *env);
+		void recycle_temporary_peers (JNIEnv *env);
 		mono_bool add_reference_mono_object (JNIEnv *env, MonoObject *obj, MonoObject *reffed_obj);
 		void gc_prepare_for_java_collection (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs);
-		void gc_cleanup_after_java_collection (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs);
+		bool add_references_batched (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs);
+		void clear_references_batched (JNIEnv *env);
+		void add_references_one_by_one (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs);
+		int gc_cleanup_after_java_collection (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs);
+		JavaGCDecision decide_java_gc (uint64_t num_objects, uint64_t graph_fingerprint, uint64_t now_ns);
+		uint64_t get_graph_fingerprint (int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs);
+		bool can_flip_refs_in_bulk () const;
+		void flip_to_weak_refs (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs);
+		int flip_to_global_refs (JNIEnv *env, int num_sccs, MonoGCBridgeSCC **sccs);
 		void java_gc (JNIEnv *env);
+		PeerMethods* get_peer_methods (JNIEnv *env, MonoClass *klass, jobject handle);
 		void set_bridge_processing_field (MonodroidBridgeProcessingInfo *list, mono_bool value);
 		int platform_supports_weak_refs ();
+		void parse_gc_bridge_options ();
+		void record_gc_bridge_phase (GCBridgePhase phase, uint64_t elapsed_ns);
 
 #if DEBUG
 		char* describe_target (AddReferenceTarget target);
 #endif
 	private:
-		int gc_gref_count = 0;
-		int gc_weak_gref_count = 0;
+		// Modified on every global reference creation or deletion, from any thread
+		ShardedCounter gc_gref_count;
+		ShardedCounter gc_weak_gref_count;
+
+		// From this (approximate) number of global references on, the exact count is returned by `_monodroid_gref_inc`,
+		// see `register_gc_hooks`
+		int exact_gref_count_level = 0;
+
+		// From this number of global references on, the asynchronous reference log is flushed after every new
+		// reference: ART aborts the process when its limit is reached, without running the atexit handlers
+		int ref_log_flush_level = std::numeric_limits<int>::max ();
 		int gc_disabled = 0;
 
 		MonodroidBridgeProcessingInfo *domains_list = nullptr;
@@ -177,12 +322,78 @@ namespace xamarin::android::internal
 		// These will be loaded as needed and persist between GCs
 		// FIXME: This code assumes it is totally safe to hold onto these GREFs forever. Can
 		// mono.android.jar ever be unloaded?
-		jclass    ArrayList_class = nullptr;
 		jclass    GCUserPeer_class;
-		jmethodID ArrayList_ctor;
-		jmethodID ArrayList_get;
-		jmethodID ArrayList_add;
 		jmethodID GCUserPeer_ctor;
+		jmethodID GCUserPeer_clearReferences;
+
+		// Temporary peers stand in for SCCs without any Java objects during a bridge pass.  They are reused between
+		// passes instead of being allocated every time: `temporary_peers` holds the ones used by the current pass
+		// (indexed by the SCC stashed index, see `scc_get_stashed_index`), `temporary_peer_pool` the idle ones.
+		// All of them are global references, except for the duration of the Java collection (see
+		// `weaken_temporary_peers`), and are included in `gc_gref_count` like any other.  The pool is kept small, since
+		// every idle peer takes up a slot in the global reference table, and is used only with JNI weak references.
+		static constexpr size_t TEMPORARY_PEER_POOL_MAX_SIZE = 128;
+		std::vector<jobject>      temporary_peers;
+		std::vector<jobject>      temporary_peer_pool;
+
+		// Adaptive Java GC, see `decide_java_gc`.  Off unless enabled with `java-gc=adaptive`
+		bool      adaptive_java_gc = false;
+		uint32_t  java_gc_max_skips = 4;
+		uint64_t  java_gc_min_interval_ns = 250 * 1000 * 1000;
+		uint64_t  java_gc_small_graph_objects = 32;
+		uint32_t  java_gc_consecutive_skips = 0;
+		uint64_t  last_java_gc_ns = 0;
+		uint64_t  last_java_gc_graph_fingerprint = 0;
+		bool      last_java_gc_kept_everything = false;
+		uint32_t  collection_generation = 0;            // of the Mono collection in progress, see `gc_started`
+		std::vector<uintptr_t> graph_fingerprint_data;  // scratch buffer of `get_graph_fingerprint`
+
+		// Batched reference construction, see `add_references_batched`
+		bool      use_batched_references = true;
+		jclass    Object_class = nullptr;
+		jclass    GCBridge_class = nullptr;
+		jmethodID GCBridge_addReferences = nullptr;
+		jmethodID GCBridge_clearReferences = nullptr;
+
+		// Scratch buffers reused between bridge passes, so that we don't have to allocate in every GC
+		std::vector<MonoObject*>  batch_objects;
+		std::vector<int>          batch_scc_peer_index;
+		std::vector<jint>         batch_links;
+		std::vector<jboolean>     batch_refs_added;
+		std::vector<jobject>      batch_clear_peers;
+
+		// Results of `find_gc_bridge_index`, so that classifying a class takes a single lookup once it's been seen.
+		// Lock-free open addressing: a slot is claimed by setting `klass` once, and never changes its owner, while
+		// `value` holds the cache generation in the upper 32 bits and the bridge index (or -1) in the lower ones.
+		// Bumping the generation (see `invalidate_gc_bridge_class_cache`) invalidates all the entries at once.
+		struct BridgeClassCacheEntry
+		{
+			MonoClass  *klass;
+			uint64_t    value;
+		};
+
+		static constexpr size_t BRIDGE_CLASS_CACHE_SIZE = 4096; // must be a power of 2
+		static constexpr size_t BRIDGE_CLASS_CACHE_MAX_PROBES = 8;
+		std::array<BridgeClassCacheEntry, BRIDGE_CLASS_CACHE_SIZE> bridge_class_cache{};
+		uint32_t bridge_class_cache_generation = 1;
+
+		// Filled in during bridge processing, entries are never removed
+		static constexpr size_t PEER_METHODS_CACHE_SIZE = 256; // must be a power of 2
+		std::array<PeerMethods*, PEER_METHODS_CACHE_SIZE> peer_methods_cache{};
+
+		// Written only by the bridge callbacks, `bridge_stats_sequence` is odd while a pass updates the stats, so that
+		// readers can tell they have a consistent copy (see `get_gc_bridge_stats`)
+		GCBridgeStats             bridge_stats{};
+		uint32_t                  bridge_stats_sequence = 0;
+
+		std::array<BridgeCallbackCounters, MAX_CALLBACK_COUNTER_SLOTS> callback_counters{};
+		uint32_t                                                      callback_counter_slots_used = 0;
+		static inline thread_local BridgeCallbackCounters            *thread_callback_counters = nullptr;
+
+		// Set for the duration of a bridge pass if `flip_to_weak_refs` and `flip_to_global_refs` are used. Bridge info
+		// of every SCC object (in SCC order) is then cached in `bridge_pass_info` between the two
+		bool                                bulk_ref_flips = false;
+		std::vector<MonoJavaGCBridgeInfo*>  bridge_pass_info;
 	};
 }
 #endif // !__OS_BRIDGE_H
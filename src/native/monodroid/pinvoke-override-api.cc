@@ -5,6 +5,7 @@
 #include <mono/utils/mono-dl-fallback.h>
 
 #include "globals.hh"
+#include "gref-attribution.hh"
 #include "monodroid-glue.hh"
 #include "monodroid-glue-internal.hh"
 #include "timing.hh"
@@ -201,6 +202,36 @@ _monodroid_timezone_get_default_id ()
 	return def_id;
 }
 
+// Copies a consistent snapshot of the GC bridge phase timings and counters to `stats`
+static void
+_monodroid_gc_bridge_get_stats (OSBridge::GCBridgeStats *stats)
+{
+	if (stats == nullptr)
+		return;
+
+	osBridge.get_gc_bridge_stats (*stats);
+}
+
+// Fills `entries` with the global reference sites with the most live references, requires the `gref-attribution`
+// option of `debug.mono.log`.  Returns the number of entries filled in.
+static int
+_monodroid_gref_get_attribution (GrefAttribution::Entry *entries, int max_entries)
+{
+	if (!GrefAttribution::is_enabled () || max_entries <= 0)
+		return 0;
+
+	return static_cast<int>(GrefAttribution::get_top_sites (osBridge.ensure_jnienv (), entries, static_cast<size_t>(max_entries)));
+}
+
+static void
+_monodroid_gref_log_attribution (int count)
+{
+	if (!GrefAttribution::is_enabled () || count <= 0)
+		return;
+
+	GrefAttribution::log_top_sites (osBridge.ensure_jnienv (), static_cast<size_t>(count));
+}
+
 static void
 _monodroid_counters_dump ([[maybe_unused]] const char *format, [[maybe_unused]] va_list args)
 {
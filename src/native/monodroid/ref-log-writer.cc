@@ -0,0 +1,588 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "android-system.hh"
+#include "logger.hh"
+#include "ref-log-writer.hh"
+#include "util.hh"
+#include "xxhash.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::internal;
+
+namespace {
+	constexpr size_t MAX_THREAD_NAME_LENGTH = 127;
+	constexpr size_t MAX_LINE_LENGTH = 256;
+}
+
+void
+RefLogWriter::start (bool binary) noexcept
+{
+	if (is_running ()) {
+		return;
+	}
+
+	binary_mode = binary;
+	if (binary_mode) {
+		binary_logs[0].file = gref_log;
+		if (lref_log != gref_log) {
+			binary_logs[1].file = lref_log;
+		}
+	}
+
+	int ret = pthread_key_create (&ring_key, release_thread_ring);
+	if (ret != 0) {
+		log_warn (LOG_GREF, "Reference log: failed to create thread key, logging synchronously. %s", strerror (ret));
+		close_binary_logs ();
+		return;
+	}
+
+	pthread_attr_t attr;
+	pthread_attr_init (&attr);
+	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t thread;
+	ret = pthread_create (&thread, &attr, writer_thread, nullptr);
+	pthread_attr_destroy (&attr);
+
+	if (ret != 0) {
+		log_warn (LOG_GREF, "Reference log: failed to create the writer thread, logging synchronously. %s", strerror (ret));
+		close_binary_logs ();
+		return;
+	}
+
+	pthread_setname_np (thread, "XA ref log");
+	__atomic_store_n (&running, true, __ATOMIC_RELEASE);
+	atexit (flush);
+	log_info (LOG_GREF, "Reference log: records are written asynchronously%s", binary_mode ? ", in the binary format" : "");
+}
+
+RefLogWriter::Ring*
+RefLogWriter::get_thread_ring () noexcept
+{
+	auto ring = static_cast<Ring*>(pthread_getspecific (ring_key));
+	if (ring != nullptr) [[likely]] {
+		return ring;
+	}
+
+	// Reuse a ring left by a thread which has exited, the writer will catch up with its contents eventually
+	for (ring = __atomic_load_n (&rings, __ATOMIC_ACQUIRE); ring != nullptr; ring = ring->next) {
+		bool expected = false;
+		if (__atomic_compare_exchange_n (&ring->owned, &expected, true, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+
+	if (ring == nullptr) {
+		if (__atomic_add_fetch (&ring_count, 1, __ATOMIC_RELAXED) > MAX_RINGS) {
+			__atomic_sub_fetch (&ring_count, 1, __ATOMIC_RELAXED);
+			return nullptr;
+		}
+
+		ring = new Ring {};
+		ring->owned = true;
+		ring->next = __atomic_load_n (&rings, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n (&rings, &ring->next, ring, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			;
+		}
+	}
+
+	pthread_setspecific (ring_key, ring);
+	return ring;
+}
+
+void
+RefLogWriter::release_thread_ring (void *ring) noexcept
+{
+	__atomic_store_n (&static_cast<Ring*>(ring)->owned, false, __ATOMIC_RELEASE);
+}
+
+force_inline void
+RefLogWriter::copy_to_ring (Ring *ring, uint64_t pos, const void *src, size_t length) noexcept
+{
+	// `src` may be a null pointer when there's nothing to copy, memcpy must not see it then
+	if (length == 0) {
+		return;
+	}
+
+	size_t offset = static_cast<size_t>(pos & (RING_SIZE - 1));
+	size_t first = length < RING_SIZE - offset ? length : RING_SIZE - offset;
+
+	memcpy (ring->data + offset, src, first);
+	if (first < length) {
+		memcpy (ring->data, static_cast<const uint8_t*>(src) + first, length - first);
+	}
+}
+
+force_inline void
+RefLogWriter::copy_from_ring (Ring *ring, uint64_t pos, void *dest, size_t length) noexcept
+{
+	if (length == 0) {
+		return;
+	}
+
+	size_t offset = static_cast<size_t>(pos & (RING_SIZE - 1));
+	size_t first = length < RING_SIZE - offset ? length : RING_SIZE - offset;
+
+	memcpy (dest, ring->data + offset, first);
+	if (first < length) {
+		memcpy (static_cast<uint8_t*>(dest) + first, ring->data, length - first);
+	}
+}
+
+void
+RefLogWriter::log (RefLogRecordKind kind, int count, int weak_count, const void *handle, char handle_type,
+                   const void *new_handle, char new_handle_type, const char *thread_name, int thread_id,
+                   const char *text, bool text_writable) noexcept
+{
+	Ring *ring = get_thread_ring ();
+	if (ring == nullptr) [[unlikely]] {
+		__atomic_add_fetch (&dropped_record_count, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n (&writer_waiting, __ATOMIC_SEQ_CST)) {
+			wake_writer ();
+		}
+		return;
+	}
+
+	if (thread_name == nullptr) {
+		thread_name = "(null)";
+	}
+
+	size_t thread_name_length = strlen (thread_name);
+	if (thread_name_length > MAX_THREAD_NAME_LENGTH) {
+		thread_name_length = MAX_THREAD_NAME_LENGTH;
+	}
+
+	// Stack traces which don't fit are truncated, rather than dropped
+	size_t text_length = text == nullptr ? 0 : strlen (text);
+	size_t max_text_length = MAX_RECORD_SIZE - sizeof (RefLogRecord) - thread_name_length;
+	if (text_length > max_text_length) {
+		text_length = max_text_length;
+	}
+
+	size_t size = (sizeof (RefLogRecord) + thread_name_length + text_length + 7) & ~static_cast<size_t>(7);
+	uint64_t head = ring->head;
+	uint64_t tail = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE);
+	if (RING_SIZE - (head - tail) < size) {
+		// The ring isn't empty, so the writer isn't waiting
+		__atomic_add_fetch (&dropped_record_count, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+
+	RefLogRecord record {
+		.size = static_cast<uint32_t>(size),
+		.kind = kind,
+		.handle_type = handle_type,
+		.new_handle_type = new_handle_type,
+		.flags = text_writable ? FLAG_TEXT_WRITABLE : static_cast<uint8_t>(0),
+		.count = count,
+		.weak_count = weak_count,
+		.thread_id = thread_id,
+		.thread_name_length = static_cast<uint16_t>(thread_name_length),
+		.reserved = 0,
+		.text_length = static_cast<uint32_t>(text_length),
+		.timestamp_ns = (static_cast<uint64_t>(now.tv_sec) * 1000000000ULL) + static_cast<uint64_t>(now.tv_nsec),
+		.handle = handle,
+		.new_handle = new_handle,
+	};
+
+	copy_to_ring (ring, head, &record, sizeof (record));
+	copy_to_ring (ring, head + sizeof (record), thread_name, thread_name_length);
+	copy_to_ring (ring, head + sizeof (record) + thread_name_length, text, text_length);
+
+	// Sequentially consistent, so that either the writer sees the new head or we see `writer_waiting` set (see
+	// `wait_for_records`)
+	__atomic_store_n (&ring->head, head + size, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n (&writer_waiting, __ATOMIC_SEQ_CST)) [[unlikely]] {
+		wake_writer ();
+	}
+}
+
+void
+RefLogWriter::wake_writer () noexcept
+{
+	pthread_mutex_lock (&writer_mutex);
+	pthread_cond_signal (&writer_cond);
+	pthread_mutex_unlock (&writer_mutex);
+}
+
+bool
+RefLogWriter::has_pending_records () noexcept
+{
+	for (Ring *ring = __atomic_load_n (&rings, __ATOMIC_ACQUIRE); ring != nullptr; ring = ring->next) {
+		// `flush` may be draining the rings meanwhile, so the values written under `drain_mutex` are read atomically
+		if (__atomic_load_n (&ring->head, __ATOMIC_SEQ_CST) != __atomic_load_n (&ring->tail, __ATOMIC_RELAXED)) {
+			return true;
+		}
+	}
+
+	return __atomic_load_n (&dropped_record_count, __ATOMIC_SEQ_CST) != __atomic_load_n (&reported_dropped_record_count, __ATOMIC_RELAXED);
+}
+
+// Blocks the writer thread until a producer publishes a record (or drops one)
+void
+RefLogWriter::wait_for_records () noexcept
+{
+	pthread_mutex_lock (&writer_mutex);
+	__atomic_store_n (&writer_waiting, true, __ATOMIC_SEQ_CST);
+	while (!has_pending_records ()) {
+		pthread_cond_wait (&writer_cond, &writer_mutex);
+	}
+	__atomic_store_n (&writer_waiting, false, __ATOMIC_RELAXED);
+	pthread_mutex_unlock (&writer_mutex);
+}
+
+bool
+RefLogWriter::drain_ring (Ring *ring) noexcept
+{
+	uint64_t tail = ring->tail;
+	uint64_t head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+	if (tail == head) {
+		return false;
+	}
+
+	char thread_name[MAX_THREAD_NAME_LENGTH + 1];
+	while (tail < head) {
+		RefLogRecord record;
+		copy_from_ring (ring, tail, &record, sizeof (record));
+
+		uint64_t pos = tail + sizeof (record);
+		copy_from_ring (ring, pos, thread_name, record.thread_name_length);
+		thread_name[record.thread_name_length] = '\0';
+
+		pos += record.thread_name_length;
+		copy_from_ring (ring, pos, record_buffer, record.text_length);
+		record_buffer[record.text_length] = '\0';
+
+		write_record (record, thread_name, reinterpret_cast<char*>(record_buffer));
+		tail += record.size;
+	}
+
+	__atomic_store_n (&ring->tail, tail, __ATOMIC_RELEASE);
+	return true;
+}
+
+void
+RefLogWriter::write_text_to_logcat (LogCategories category, char *text, bool writable) noexcept
+{
+	if (!writable) {
+		log_info (category, "%s", text);
+		return;
+	}
+
+	// Same as OSBridge::_write_stack_trace, every line is a separate logcat message
+	char *line = text;
+	for (;;) {
+		char *end = strchr (line, '\n');
+		if (end == nullptr) {
+			log_debug (category, "%s", line);
+			return;
+		}
+
+		*end = '\0';
+		log_debug (category, "%s", line);
+		line = end + 1;
+	}
+}
+
+// Produces exactly the same output as the synchronous logging code in osbridge.cc
+void
+RefLogWriter::write_record (RefLogRecord const& record, const char *thread_name, char *text) noexcept
+{
+	if (binary_mode) {
+		write_binary_record (record, thread_name, text);
+		return;
+	}
+
+	LogCategories category = LOG_GREF;
+	FILE *to = gref_log;
+	bool to_logcat = gref_to_logcat;
+	char line[MAX_LINE_LENGTH];
+
+	switch (record.kind) {
+		case RefLogRecordKind::Message:
+			if (gref_to_logcat) {
+				log_debug (LOG_GREF, "%s", text);
+			}
+			if (gref_log != nullptr) {
+				fputs (text, gref_log);
+			}
+			return;
+
+		case RefLogRecordKind::GrefNew:
+		case RefLogRecordKind::WeakGrefNew:
+			snprintf (line, sizeof (line), "%s grefc %i gwrefc %i obj-handle %p/%c -> new-handle %p/%c from thread '%s'(%i)",
+			          record.kind == RefLogRecordKind::GrefNew ? "+g+" : "+w+",
+			          record.count,
+			          record.weak_count,
+			          record.handle,
+			          record.handle_type,
+			          record.new_handle,
+			          record.new_handle_type,
+			          thread_name,
+			          record.thread_id);
+			break;
+
+		case RefLogRecordKind::GrefDelete:
+		case RefLogRecordKind::WeakGrefDelete:
+			snprintf (line, sizeof (line), "%s grefc %i gwrefc %i handle %p/%c from thread '%s'(%i)",
+			          record.kind == RefLogRecordKind::GrefDelete ? "-g-" : "-w-",
+			          record.count,
+			          record.weak_count,
+			          record.handle,
+			          record.handle_type,
+			          thread_name,
+			          record.thread_id);
+			break;
+
+		case RefLogRecordKind::LrefNew:
+		case RefLogRecordKind::LrefDelete:
+			category = LOG_LREF;
+			to = lref_log;
+			to_logcat = lref_to_logcat;
+			snprintf (line, sizeof (line), "%s lrefc %i handle %p/%c from thread '%s'(%i)",
+			          record.kind == RefLogRecordKind::LrefNew ? "+l+" : "-l-",
+			          record.count,
+			          record.handle,
+			          record.handle_type,
+			          thread_name,
+			          record.thread_id);
+			break;
+	}
+
+	log_info (category, "%s", line);
+	if (to_logcat) {
+		write_text_to_logcat (category, text, (record.flags & FLAG_TEXT_WRITABLE) != 0);
+	}
+
+	if (to != nullptr) {
+		fprintf (to, "%s\n%s\n", line, text);
+	}
+}
+
+void
+RefLogWriter::write_binary_header (FILE *file) noexcept
+{
+	RefLogBinaryHeader header {
+		.magic = {},
+		.version = RefLogBinaryHeader::VERSION,
+		.reserved = 0,
+	};
+	memcpy (header.magic, RefLogBinaryHeader::MAGIC, sizeof (header.magic));
+
+	fwrite (&header, sizeof (header), 1, file);
+	fflush (file);
+}
+
+// Without the writer thread, the synchronous logging code would write text to the files meant for the binary format,
+// which the decoder can't read.  The binary log is given up on instead.
+void
+RefLogWriter::close_binary_logs () noexcept
+{
+	if (!binary_mode) {
+		return;
+	}
+
+	log_warn (LOG_GREF, "Reference log: binary log files can't be written without the writer thread, disabling them");
+	for (BinaryLogFile &log : binary_logs) {
+		if (log.file != nullptr) {
+			fclose (log.file);
+			log.file = nullptr;
+		}
+	}
+
+	gref_log = nullptr;
+	lref_log = nullptr;
+	binary_mode = false;
+}
+
+// Returns id of the string, writing its definition to the file first if it hasn't been seen before.  After
+// MAX_INTERNED_STRINGS distinct strings or MAX_INTERNED_STRING_BYTES of their contents, new strings are no longer
+// remembered (but are still written) to bound memory use.
+uint32_t
+RefLogWriter::intern_string (BinaryLogFile &log, const char *str, size_t length) noexcept
+{
+	if (length == 0) {
+		return 0;
+	}
+
+	uint64_t hash = xxhash64::hash (str, length);
+	if (!log.strings.empty ()) {
+		size_t mask = log.strings.size () - 1;
+		for (size_t i = static_cast<size_t>(hash) & mask; log.strings[i].id != 0; i = (i + 1) & mask) {
+			InternedString const& entry = log.strings[i];
+			if (entry.hash == hash && entry.length == length && memcmp (log.string_data.data () + entry.offset, str, length) == 0) {
+				return entry.id;
+			}
+		}
+	}
+
+	uint32_t id = ++log.last_string_id;
+	uint32_t length32 = static_cast<uint32_t>(length);
+	RefLogBinaryTag tag = RefLogBinaryTag::String;
+	fwrite (&tag, sizeof (tag), 1, log.file);
+	fwrite (&id, sizeof (id), 1, log.file);
+	fwrite (&length32, sizeof (length32), 1, log.file);
+	fwrite (str, length, 1, log.file);
+
+	if (log.string_count >= MAX_INTERNED_STRINGS || log.string_data.size () + length > MAX_INTERNED_STRING_BYTES) {
+		return id;
+	}
+
+	// Keep the table at most half full
+	if ((log.string_count + 1) * 2 > log.strings.size ()) {
+		std::vector<InternedString> old_strings (log.strings.size () == 0 ? 1024 : log.strings.size () * 2);
+		old_strings.swap (log.strings);
+
+		size_t mask = log.strings.size () - 1;
+		for (InternedString const& entry : old_strings) {
+			if (entry.id == 0) {
+				continue;
+			}
+
+			size_t i = static_cast<size_t>(entry.hash) & mask;
+			while (log.strings[i].id != 0) {
+				i = (i + 1) & mask;
+			}
+			log.strings[i] = entry;
+		}
+	}
+
+	size_t mask = log.strings.size () - 1;
+	size_t i = static_cast<size_t>(hash) & mask;
+	while (log.strings[i].id != 0) {
+		i = (i + 1) & mask;
+	}
+	log.strings[i] = { hash, id, static_cast<uint32_t>(length), log.string_data.size () };
+	log.string_data.insert (log.string_data.end (), str, str + length);
+	log.string_count++;
+
+	return id;
+}
+
+void
+RefLogWriter::write_binary_record (RefLogRecord const& record, const char *thread_name, const char *text) noexcept
+{
+	bool is_lref = record.kind == RefLogRecordKind::LrefNew || record.kind == RefLogRecordKind::LrefDelete;
+	FILE *file = is_lref ? lref_log : gref_log;
+	if (file == nullptr) {
+		return;
+	}
+
+	BinaryLogFile &log = binary_logs[0].file == file ? binary_logs[0] : binary_logs[1];
+	RefLogBinaryRecord binary_record {
+		.kind = record.kind,
+		.handle_type = record.handle_type,
+		.new_handle_type = record.new_handle_type,
+		.flags = record.flags,
+		.count = record.count,
+		.weak_count = record.weak_count,
+		.thread_id = record.thread_id,
+		.thread_name_id = record.kind == RefLogRecordKind::Message ? 0 : intern_string (log, thread_name, record.thread_name_length),
+		.text_id = intern_string (log, text, record.text_length),
+		.timestamp_ns = record.timestamp_ns,
+		.handle = reinterpret_cast<uintptr_t>(record.handle),
+		.new_handle = reinterpret_cast<uintptr_t>(record.new_handle),
+	};
+
+	RefLogBinaryTag tag = RefLogBinaryTag::Record;
+	fwrite (&tag, sizeof (tag), 1, file);
+	fwrite (&binary_record, sizeof (binary_record), 1, file);
+}
+
+void
+RefLogWriter::write_binary_dropped_count (size_t dropped) noexcept
+{
+	RefLogBinaryTag tag = RefLogBinaryTag::Dropped;
+	uint64_t count = dropped;
+
+	for (BinaryLogFile &log : binary_logs) {
+		if (log.file == nullptr) {
+			continue;
+		}
+
+		fwrite (&tag, sizeof (tag), 1, log.file);
+		fwrite (&count, sizeof (count), 1, log.file);
+	}
+}
+
+// Must be called with `drain_mutex` held.  Returns `true` if anything was written.
+bool
+RefLogWriter::drain_all_rings () noexcept
+{
+	// Written by the first drain rather than in `start`, so that a file gets the header only if the records will
+	// follow it
+	if (binary_mode && !binary_headers_written) [[unlikely]] {
+		for (BinaryLogFile &log : binary_logs) {
+			if (log.file != nullptr) {
+				write_binary_header (log.file);
+			}
+		}
+		binary_headers_written = true;
+	}
+
+	bool wrote = false;
+	for (Ring *ring = __atomic_load_n (&rings, __ATOMIC_ACQUIRE); ring != nullptr; ring = ring->next) {
+		wrote |= drain_ring (ring);
+	}
+
+	size_t dropped = dropped_records ();
+	if (dropped != reported_dropped_record_count) {
+		log_warn (LOG_GREF, "Reference log: %zu records dropped so far, the log is incomplete", dropped);
+		__atomic_store_n (&reported_dropped_record_count, dropped, __ATOMIC_RELAXED);
+		if (binary_mode) {
+			write_binary_dropped_count (dropped);
+			wrote = true;
+		}
+	}
+
+	if (!wrote) {
+		return false;
+	}
+
+	// Flush once per batch instead of once per record
+	if (gref_log != nullptr) {
+		fflush (gref_log);
+	}
+
+	if (lref_log != nullptr && lref_log != gref_log) {
+		fflush (lref_log);
+	}
+
+	return true;
+}
+
+void
+RefLogWriter::flush () noexcept
+{
+	if (!is_running ()) {
+		return;
+	}
+
+	// The records published by other threads until we're done may or may not make it, those of the calling thread do
+	pthread_mutex_lock (&drain_mutex);
+	drain_all_rings ();
+	pthread_mutex_unlock (&drain_mutex);
+}
+
+void*
+RefLogWriter::writer_thread ([[maybe_unused]] void *arg) noexcept
+{
+	for (;;) {
+		pthread_mutex_lock (&drain_mutex);
+		bool wrote = drain_all_rings ();
+		pthread_mutex_unlock (&drain_mutex);
+
+		if (!wrote) {
+			wait_for_records ();
+		}
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,197 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __REF_LOG_WRITER_HH
+#define __REF_LOG_WRITER_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <pthread.h>
+
+#include "log_types.hh"
+
+namespace xamarin::android::internal
+{
+	enum class RefLogRecordKind : uint8_t
+	{
+		Message        = 0,
+		GrefNew        = 1,
+		GrefDelete     = 2,
+		WeakGrefNew    = 3,
+		WeakGrefDelete = 4,
+		LrefNew        = 5,
+		LrefDelete     = 6,
+	};
+
+	// Every record is followed by `thread_name_length` bytes of the thread name and `text_length` bytes of the
+	// stack trace (or of the message, for `RefLogRecordKind::Message`), neither is NUL-terminated.  Records are
+	// padded to a multiple of 8 bytes.
+	struct RefLogRecord
+	{
+		uint32_t          size;
+		RefLogRecordKind  kind;
+		char              handle_type;
+		char              new_handle_type;
+		uint8_t           flags;
+		int32_t           count;             // grefc or lrefc
+		int32_t           weak_count;
+		int32_t           thread_id;
+		uint16_t          thread_name_length;
+		uint16_t          reserved;
+		uint32_t          text_length;
+		uint64_t          timestamp_ns;      // CLOCK_MONOTONIC
+		const void       *handle;
+		const void       *new_handle;
+	};
+
+	// Binary log format, used with the `ref-binary` option of `debug.mono.log` (decoded on the host with
+	// tools/ref-log-decoder).  All values are little-endian.  The file starts with a RefLogBinaryHeader, followed by a
+	// sequence of entries, each of them starting with a single RefLogBinaryTag byte:
+	//
+	//   String:   uint32 id, uint32 length, `length` bytes of the string
+	//   Record:   RefLogBinaryRecord
+	//   Dropped:  uint64 number of records dropped so far
+	//
+	// Thread names and stack traces are stored only once per file, as strings, records refer to them by their ids
+	// (0 is the empty string).  The header is written by the writer thread, if it can't be started the files are
+	// closed and left empty, rather than getting the text format.
+	enum class RefLogBinaryTag : uint8_t
+	{
+		String  = 1,
+		Record  = 2,
+		Dropped = 3,
+	};
+
+	struct RefLogBinaryHeader
+	{
+		static constexpr char MAGIC[] = "XAREFLOG";
+		static constexpr uint32_t VERSION = 1;
+
+		char      magic[8];
+		uint32_t  version;
+		uint32_t  reserved;
+	};
+
+	struct RefLogBinaryRecord
+	{
+		RefLogRecordKind  kind;
+		char              handle_type;
+		char              new_handle_type;
+		uint8_t           flags;
+		int32_t           count;
+		int32_t           weak_count;
+		int32_t           thread_id;
+		uint32_t          thread_name_id;
+		uint32_t          text_id;
+		uint64_t          timestamp_ns;
+		uint64_t          handle;
+		uint64_t          new_handle;
+	};
+	static_assert (sizeof (RefLogBinaryRecord) == 48);
+
+	// Writes the global and local reference log records on a background thread, instead of formatting and flushing
+	// them on the thread which creates or deletes the reference.  Every thread gets its own single producer, single
+	// consumer ring buffer, so logging a reference is a couple of memcpy calls.  Memory use is bounded: there are at
+	// most MAX_RINGS rings of RING_SIZE bytes each (rings of threads which exited are reused) and records which don't
+	// fit are dropped and counted.
+	class RefLogWriter
+	{
+		static constexpr size_t RING_SIZE = 64 * 1024; // must be a power of 2
+		static constexpr size_t MAX_RINGS = 64;
+		static constexpr size_t MAX_RECORD_SIZE = RING_SIZE / 4;
+		static constexpr uint8_t FLAG_TEXT_WRITABLE = 0x01;
+
+		static constexpr size_t MAX_INTERNED_STRINGS = 1024 * 1024;
+		static constexpr size_t MAX_INTERNED_STRING_BYTES = 16 * 1024 * 1024;
+
+		struct InternedString
+		{
+			uint64_t  hash;
+			uint32_t  id;     // 0 marks an empty slot
+			uint32_t  length;
+			size_t    offset; // in BinaryLogFile::string_data
+		};
+
+		struct BinaryLogFile
+		{
+			FILE                         *file;
+			std::vector<InternedString>   strings;
+			std::vector<char>             string_data; // contents of the interned strings, to tell hash collisions apart
+			size_t                        string_count;
+			uint32_t                      last_string_id;
+		};
+
+		struct Ring
+		{
+			uint64_t  head;   // written only by the owning thread
+			uint64_t  tail;   // written only by the writer thread
+			bool      owned;
+			Ring     *next;
+			uint8_t   data[RING_SIZE];
+		};
+
+	public:
+		static bool is_running () noexcept
+		{
+			return __atomic_load_n (&running, __ATOMIC_ACQUIRE);
+		}
+
+		static size_t dropped_records () noexcept
+		{
+			return __atomic_load_n (&dropped_record_count, __ATOMIC_RELAXED);
+		}
+
+		static void start (bool binary) noexcept;
+
+		// Synchronously writes all the records logged so far and flushes the files.  Called at exit and when the gref
+		// count approaches the limit at which ART aborts the process, which no atexit handler would see.
+		static void flush () noexcept;
+		static void log (RefLogRecordKind kind, int count, int weak_count, const void *handle, char handle_type,
+		                 const void *new_handle, char new_handle_type, const char *thread_name, int thread_id,
+		                 const char *text, bool text_writable) noexcept;
+
+	private:
+		static Ring* get_thread_ring () noexcept;
+		static void release_thread_ring (void *ring) noexcept;
+		static void copy_to_ring (Ring *ring, uint64_t pos, const void *src, size_t length) noexcept;
+		static void copy_from_ring (Ring *ring, uint64_t pos, void *dest, size_t length) noexcept;
+		static bool drain_ring (Ring *ring) noexcept;
+		static bool drain_all_rings () noexcept;
+		static bool has_pending_records () noexcept;
+		static void wait_for_records () noexcept;
+		static void wake_writer () noexcept;
+		static void write_record (RefLogRecord const& record, const char *thread_name, char *text) noexcept;
+		static void write_text_to_logcat (LogCategories category, char *text, bool writable) noexcept;
+		static void write_binary_header (FILE *file) noexcept;
+		static void close_binary_logs () noexcept;
+		static void write_binary_record (RefLogRecord const& record, const char *thread_name, const char *text) noexcept;
+		static void write_binary_dropped_count (size_t dropped) noexcept;
+		static uint32_t intern_string (BinaryLogFile &log, const char *str, size_t length) noexcept;
+		static void* writer_thread (void *arg) noexcept;
+
+	private:
+		static inline bool           running = false;
+		static inline size_t         dropped_record_count = 0;
+		static inline size_t         ring_count = 0;
+		static inline Ring          *rings = nullptr;
+		static inline pthread_key_t  ring_key;
+
+		// The writer thread sleeps on `writer_cond` while all the rings are empty.  It sets `writer_waiting` before it
+		// checks the rings for the last time, and the producers check it after they publish a record, so that only
+		// the first record after a quiet period has to signal the writer.
+		static inline bool             writer_waiting = false;
+		static inline pthread_mutex_t  writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+		static inline pthread_cond_t   writer_cond = PTHREAD_COND_INITIALIZER;
+
+		// Held while the rings are drained, by the writer thread or by `flush`.  All below are protected by it.
+		static inline pthread_mutex_t  drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+		static inline bool           binary_headers_written = false;
+		static inline size_t         reported_dropped_record_count = 0;
+		static inline uint8_t        record_buffer[MAX_RECORD_SIZE];
+		static inline bool           binary_mode = false;
+		static inline BinaryLogFile  binary_logs[2]; // gref and lref, unless they share the file
+	};
+}
+#endif // ndef __REF_LOG_WRITER_HH
@@ -0,0 +1,84 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __SHARDED_COUNTER_HH
+#define __SHARDED_COUNTER_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include <unistd.h>
+
+#include "platform-compat.hh"
+
+namespace xamarin::android::internal
+{
+	// Counter which can be modified from many threads at once without all of them contending for the same cache line.
+	// Every thread updates one of SHARD_COUNT shards (each in a cache line of its own) and, once the shard's value
+	// drifts by FOLD_THRESHOLD or more, folds it into the shared total.  This makes the shared total an approximation
+	// which is never off by more than `SHARD_COUNT * FOLD_THRESHOLD`, cheap enough to be returned from every
+	// update.  The exact value is obtained by summing all the shards, which is meant for the (rare) readers.
+	class ShardedCounter
+	{
+		static constexpr size_t CACHE_LINE_SIZE = 64;
+		static constexpr size_t SHARD_COUNT = 16; // must be a power of 2
+		static constexpr int32_t FOLD_THRESHOLD = 64;
+
+		struct alignas(CACHE_LINE_SIZE) Shard
+		{
+			int32_t value;
+		};
+
+	public:
+		static constexpr int32_t MAX_APPROXIMATION_ERROR = static_cast<int32_t>(SHARD_COUNT) * FOLD_THRESHOLD;
+
+		// Returns the approximate value of the counter after the update
+		force_inline int add (int32_t delta) noexcept
+		{
+			Shard &shard = shards [current_shard ()];
+			int32_t local = __atomic_add_fetch (&shard.value, delta, __ATOMIC_RELAXED);
+
+			if (local < FOLD_THRESHOLD && local > -FOLD_THRESHOLD) [[likely]] {
+				return __atomic_load_n (&total, __ATOMIC_RELAXED) + local;
+			}
+
+			// Add to the total first, so that concurrent readers may briefly see a value which is too high rather
+			// than one which is too low
+			int32_t new_total = __atomic_add_fetch (&total, local, __ATOMIC_RELAXED);
+			__atomic_sub_fetch (&shard.value, local, __ATOMIC_RELAXED);
+			return new_total;
+		}
+
+		force_inline int increment () noexcept
+		{
+			return add (1);
+		}
+
+		force_inline int decrement () noexcept
+		{
+			return add (-1);
+		}
+
+		// Exact, as long as no other thread modifies the counter at the same time
+		int get () const noexcept
+		{
+			int32_t ret = __atomic_load_n (&total, __ATOMIC_RELAXED);
+			for (Shard const& shard : shards) {
+				ret += __atomic_load_n (&shard.value, __ATOMIC_RELAXED);
+			}
+
+			return ret;
+		}
+
+	private:
+		// Thread IDs are allocated sequentially, so threads created one after another land in different shards.
+		// bionic caches the thread ID in the thread structure, gettid(2) doesn't make a system call there.
+		force_inline static size_t current_shard () noexcept
+		{
+			return static_cast<size_t>(gettid ()) & (SHARD_COUNT - 1);
+		}
+
+	private:
+		alignas(CACHE_LINE_SIZE) int32_t  total = 0;
+		Shard                             shards[SHARD_COUNT] {};
+	};
+}
+#endif // ndef __SHARDED_COUNTER_HH
@@ -9,23 +9,21 @@ namespace xamarin::android::internal
 	{
 	public:
 		explicit StartupAwareLock (std::mutex &m)
-			: lock (m)
+			: lock (m),
+			  locked (!MonodroidRuntime::is_startup_single_threaded ())
 		{
-			if (MonodroidRuntime::is_startup_in_progress ()) {
-				// During startup we run without threads, do nothing
-				return;
+			// During startup we usually run without threads, do nothing then
+			if (locked) {
+				lock.lock ();
 			}
-
-			lock.lock ();
 		}
 
 		~StartupAwareLock ()
 		{
-			if (MonodroidRuntime::is_startup_in_progress ()) {
-				return;
+			// Startup may have ended in the meantime, unlock only what we locked
+			if (locked) {
+				lock.unlock ();
 			}
-
-			lock.unlock ();
 		}
 
 		StartupAwareLock (StartupAwareLock const&) = delete;
@@ -35,6 +33,7 @@ namespace xamarin::android::internal
 
 	private:
 		std::mutex& lock;
+		bool        locked;
 	};
 }
 #endif
@@ -0,0 +1,111 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __TIMING_HISTOGRAM_HH
+#define __TIMING_HISTOGRAM_HH
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include "platform-compat.hh"
+
+namespace xamarin::android::internal
+{
+	// Histogram of durations (in nanoseconds) with logarithmic buckets, in the fashion of HdrHistogram: every power of
+	// two is split into SUB_BUCKET_COUNT linear sub-buckets, so a value is recorded with a relative error of at most
+	// 1/SUB_BUCKET_COUNT (~6%) no matter its magnitude, in constant time and space.  Values of MAX_EXPONENT bits or more
+	// (18 minutes and up) all land in the last bucket, the maximum is kept exactly.
+	class TimingHistogram
+	{
+		static constexpr uint32_t SUB_BUCKET_BITS = 4;
+		static constexpr uint64_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+		static constexpr uint32_t MAX_EXPONENT = 40;
+		static constexpr size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+	public:
+		force_inline void record (uint64_t value) noexcept
+		{
+			buckets [bucket_index (value)]++;
+			count++;
+			if (value > max) {
+				max = value;
+			}
+		}
+
+		force_inline uint64_t total_count () const noexcept
+		{
+			return count;
+		}
+
+		force_inline uint64_t max_value () const noexcept
+		{
+			return max;
+		}
+
+		// Returns the upper bound of the bucket containing the requested percentile (never more than the recorded
+		// maximum), or 0 if the histogram is empty
+		uint64_t percentile (unsigned int percent) const noexcept
+		{
+			if (count == 0) {
+				return 0;
+			}
+
+			// Rank of the value, rounded up: p50 of 3 values is the 2nd one
+			uint64_t rank = (count * percent + 99) / 100;
+			if (rank == 0) {
+				rank = 1;
+			}
+
+			uint64_t seen = 0;
+			for (size_t i = 0; i < BUCKET_COUNT; i++) {
+				seen += buckets [i];
+				if (seen >= rank) {
+					if (i == BUCKET_COUNT - 1) {
+						return max;
+					}
+
+					uint64_t upper = bucket_upper_bound (i);
+					return upper < max ? upper : max;
+				}
+			}
+
+			return max;
+		}
+
+	private:
+		force_inline static size_t bucket_index (uint64_t value) noexcept
+		{
+			if (value < SUB_BUCKET_COUNT) {
+				return static_cast<size_t>(value);
+			}
+
+			uint32_t exponent = static_cast<uint32_t>(std::bit_width (value)) - 1;
+			if (exponent >= MAX_EXPONENT) [[unlikely]] {
+				return BUCKET_COUNT - 1;
+			}
+
+			// The top SUB_BUCKET_BITS bits below the leading one select the sub-bucket
+			uint64_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+			return static_cast<size_t>(SUB_BUCKET_COUNT + (exponent - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT + sub_bucket);
+		}
+
+		force_inline static uint64_t bucket_upper_bound (size_t index) noexcept
+		{
+			if (index < SUB_BUCKET_COUNT) {
+				return index;
+			}
+
+			uint64_t exponent = (index - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT + SUB_BUCKET_BITS;
+			uint64_t sub_bucket = (index - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+			uint64_t width = 1ull << (exponent - SUB_BUCKET_BITS);
+
+			return (1ull << exponent) + (sub_bucket + 1) * width - 1;
+		}
+
+	private:
+		std::array<uint32_t, BUCKET_COUNT> buckets {};
+		uint64_t count = 0;
+		uint64_t max = 0;
+	};
+}
+#endif // ndef __TIMING_HISTOGRAM_HH
@@ -1,3 +1,13 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "android-system.hh"
+#include "timing-histogram.hh"
 #include "timing-internal.hh"
 #include "util.hh"
 
@@ -11,6 +21,128 @@ namespace xamarin::android::internal {
 bool FastTiming::is_enabled = false;
 bool FastTiming::immediate_logging = false;
 TimingEvent FastTiming::init_time {};
+pid_t FastTiming::init_thread_id = 0;
+
+namespace {
+	// Names used for the trace slices, kept short so that they fit the slices in the timeline.  The full description
+	// of the event is in the `more_info` argument.
+	const char*
+	event_kind_name (TimingEventKind kind) noexcept
+	{
+		switch (kind) {
+			case TimingEventKind::AssemblyDecompression:
+				return "AssemblyDecompression";
+
+			case TimingEventKind::AssemblyLoad:
+				return "AssemblyLoad";
+
+			case TimingEventKind::AssemblyPreload:
+				return "AssemblyPreload";
+
+			case TimingEventKind::DebugStart:
+				return "DebugStart";
+
+			case TimingEventKind::Init:
+				return "Init";
+
+			case TimingEventKind::JavaToManaged:
+				return "JavaToManaged";
+
+			case TimingEventKind::ManagedToJava:
+				return "ManagedToJava";
+
+			case TimingEventKind::MonoRuntimeInit:
+				return "MonoRuntimeInit";
+
+			case TimingEventKind::NativeToManagedTransition:
+				return "NativeToManagedTransition";
+
+			case TimingEventKind::RuntimeConfigBlob:
+				return "RuntimeConfigBlob";
+
+			case TimingEventKind::RuntimeRegister:
+				return "RuntimeRegister";
+
+			case TimingEventKind::TotalRuntimeInit:
+				return "TotalRuntimeInit";
+
+			case TimingEventKind::DSOWarmup:
+				return "DSOWarmup";
+
+			case TimingEventKind::AssemblyPrefetch:
+				return "AssemblyPrefetch";
+
+			default:
+				return "Unspecified";
+		}
+	}
+
+	void
+	write_json_string (FILE *out, const char *str) noexcept
+	{
+		fputc ('"', out);
+		for (const char *p = str; *p != '\0'; p++) {
+			auto c = static_cast<unsigned char>(*p);
+			switch (c) {
+				case '"':
+					fputs ("\\\"", out);
+					break;
+
+				case '\\':
+					fputs ("\\\\", out);
+					break;
+
+				case '\n':
+					fputs ("\\n", out);
+					break;
+
+				case '\t':
+					fputs ("\\t", out);
+					break;
+
+				default:
+					if (c < 0x20) {
+						fprintf (out, "\\u%04x", c);
+					} else {
+						fputc (c, out);
+					}
+					break;
+			}
+		}
+		fputc ('"', out);
+	}
+
+	// Writes a complete ("X") event of the Chrome Trace Event format.  Timestamps are in microseconds, with the
+	// nanoseconds as the fractional part, and come from CLOCK_MONOTONIC, the same clock systrace/Perfetto uses for
+	// the rest of the system.
+	void
+	write_trace_event (FILE *out, TimingEvent const& event, pid_t pid, pid_t tid, bool &first) noexcept
+	{
+		uint64_t start_ns = (static_cast<uint64_t>(event.start.sec) * 1000000000ULL) + event.start.ns;
+		uint64_t end_ns = (static_cast<uint64_t>(event.end.sec) * 1000000000ULL) + event.end.ns;
+		uint64_t duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+
+		fprintf (
+			out,
+			"%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ".%03u,\"dur\":%" PRIu64 ".%03u,\"pid\":%d,\"tid\":%d,\"args\":{\"kind\":%u",
+			first ? "" : ",",
+			event_kind_name (event.kind),
+			event.before_managed ? "native-init" : "managed",
+			start_ns / 1000, static_cast<unsigned int>(start_ns % 1000),
+			duration_ns / 1000, static_cast<unsigned int>(duration_ns % 1000),
+			pid,
+			tid,
+			static_cast<uint32_t>(event.kind)
+		);
+
+		if (event.more_info != nullptr && *event.more_info != '\0') {
+			fputs (",\"more_info\":", out);
+			write_json_string (out, event.more_info);
+		}
+		fputs ("}}", out);
+		first = false;
+	}
+}
 
 void
 FastTiming::really_initialize (bool log_immediately) noexcept
@@ -18,6 +150,7 @@ FastTiming::really_initialize (bool log_immediately) noexcept
 	internal_timing = new FastTiming ();
 	is_enabled = true;
 	immediate_logging = log_immediately;
+	init_thread_id = gettid ();
 
 	if (immediate_logging) {
 		return;
@@ -26,22 +159,128 @@ FastTiming::really_initialize (bool log_immediately) noexcept
 	log_write (LOG_TIMING, LogLevel::Info, "[2/1] To get timing results, send the mono.android.app.DUMP_TIMING_DATA intent to the application");
 }
 
+// Called when the thread's current chunk is full (or it has none yet).  The chunk it abandons stays in the table, to
+// be dumped together with all the others.
+bool
+FastTiming::acquire_chunk (ThreadChunk &tc) noexcept
+{
+	size_t chunk_index = next_chunk_index.fetch_add (1, std::memory_order_relaxed);
+	if (chunk_index >= MAX_CHUNKS) [[unlikely]] {
+		// Keep the index from growing without bound, any thread which gets here again will fail as well
+		next_chunk_index.store (MAX_CHUNKS, std::memory_order_relaxed);
+		if (chunk_index == MAX_CHUNKS) {
+			log_warn (LOG_TIMING, "Timing event buffer is full (%zu events), further events will not be recorded", MAX_CHUNKS * TimingEventChunk::EVENT_COUNT);
+		}
+		return false;
+	}
+
+	auto chunk = new TimingEventChunk {};
+	chunk->thread_id = gettid ();
+	chunks[chunk_index].store (chunk, std::memory_order_release);
+
+	tc.chunk = chunk;
+	tc.chunk_index = chunk_index;
+	tc.next_slot = 0;
+	return true;
+}
+
+// Writes all the recorded events to `timing-trace.json` in the override directory, in the Chrome Trace Event format
+// (loaded by `chrome://tracing` and https://ui.perfetto.dev).  Events recorded by a thread nest as slices on that
+// thread's track, e.g. the assembly loads within `MonoRuntimeInit`.
+void
+FastTiming::write_trace () noexcept
+{
+	const char *dir = AndroidSystem::override_dirs [0];
+	if (dir == nullptr) {
+		log_warn (LOG_TIMING, "No override directory, timing trace will not be written");
+		return;
+	}
+
+	std::unique_ptr<char> trace_path {Util::path_combine (dir, "timing-trace.json")};
+	Util::create_directory (dir, 0755);
+	FILE *out = Util::monodroid_fopen (trace_path.get (), "w");
+	if (out == nullptr) {
+		return;
+	}
+
+	pid_t pid = getpid ();
+	bool first = true;
+	size_t skipped = 0;
+
+	fputs ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+	write_trace_event (out, init_time, pid, init_thread_id, first);
+
+	size_t chunk_count = std::min (next_chunk_index.load (std::memory_order_acquire), MAX_CHUNKS);
+	for (size_t i = 0; i < chunk_count; i++) {
+		TimingEventChunk const *chunk = chunks[i].load (std::memory_order_acquire);
+		if (chunk == nullptr) {
+			continue;
+		}
+
+		size_t used = chunk->used.load (std::memory_order_acquire);
+		for (size_t j = 0; j < used; j++) {
+			TimingEvent const& event = chunk->events[j];
+
+			// Still in progress (or never ended), there's no duration to show
+			if (event.end.sec == 0 && event.end.ns == 0) {
+				skipped++;
+				continue;
+			}
+
+			write_trace_event (out, event, pid, chunk->thread_id, first);
+		}
+	}
+
+	fputs ("\n]}\n", out);
+	fclose (out);
+	Util::set_world_accessable (trace_path.get ());
+
+	if (skipped > 0) {
+		log_info_nocheck (LOG_TIMING, "Timing trace: skipped %zu unfinished events", skipped);
+	}
+	log_info_nocheck (LOG_TIMING, "Timing trace written to %s", trace_path.get ());
+}
+
 void
 FastTiming::dump () noexcept
 {
+	if (is_trace_mode ()) {
+		write_trace ();
+	}
+
 	if (immediate_logging) {
 		return;
 	}
 
-	StartupAwareLock lock { event_vector_realloc_mutex };
-	size_t entries = next_event_index.load ();
+	// Merge the per-thread chunks into a single list, in the order the events started
+	std::vector<TimingEvent const*> sorted_events;
+	size_t chunk_count = std::min (next_chunk_index.load (std::memory_order_acquire), MAX_CHUNKS);
+	for (size_t i = 0; i < chunk_count; i++) {
+		TimingEventChunk const *chunk = chunks[i].load (std::memory_order_acquire);
+		if (chunk == nullptr) { // index taken, but not stored yet
+			continue;
+		}
+
+		size_t used = chunk->used.load (std::memory_order_acquire);
+		for (size_t j = 0; j < used; j++) {
+			sorted_events.push_back (&chunk->events[j]);
+		}
+	}
 
 	log_write (LOG_TIMING, LogLevel::Info, "[2/2] Performance measurement results");
-	if (entries == 0) {
+	if (sorted_events.empty ()) {
 		log_write (LOG_TIMING, LogLevel::Info, "[2/3] No events logged");
 		return;
 	}
 
+	std::stable_sort (
+		sorted_events.begin (),
+		sorted_events.end (),
+		[](TimingEvent const* a, TimingEvent const* b) {
+			return a->start.sec < b->start.sec || (a->start.sec == b->start.sec && a->start.ns < b->start.ns);
+		}
+	);
+
 	dynamic_local_string<SharedConstants::MAX_LOGCAT_MESSAGE_LENGTH, char> message;
 
 	// Values are in nanoseconds
@@ -51,8 +290,8 @@ FastTiming::dump () noexcept
 	uint64_t total_ns;
 
 	format_and_log (init_time, message, total_ns, true /* indent */);
-	for (size_t i = 0; i < entries; i++) {
-		TimingEvent const& event = events[i];
+	for (TimingEvent const* ev : sorted_events) {
+		TimingEvent const& event = *ev;
 		format_and_log (event, message, total_ns, true /* indent */);
 
 		switch (event.kind) {
@@ -85,4 +324,94 @@ FastTiming::dump () noexcept
 
 	ns_to_time (total_managed_to_java_time, sec, ms, ns);
 	log_info_nocheck (LOG_TIMING, "  [2/7] Managed to Java lookup: %u:%u::%u", sec, ms, ns);
+
+	log_statistics (sorted_events);
+}
+
+// Totals hide outliers, so report the distribution of durations for every kind of event as well as for every name
+// (assembly, type etc) recorded in `more_info`.  The names are reported only for the slowest of them, as there can be
+// hundreds.
+void
+FastTiming::log_statistics (std::vector<TimingEvent const*> const& events) noexcept
+{
+	constexpr size_t KIND_COUNT = static_cast<size_t>(TimingEventKind::AssemblyPrefetch) + 1;
+	constexpr size_t MAX_NAMES_PER_KIND = 5;
+
+	std::array<TimingHistogram, KIND_COUNT> kind_histograms {};
+	std::array<std::unordered_map<std::string_view, TimingHistogram>, KIND_COUNT> name_histograms {};
+
+	for (TimingEvent const* ev : events) {
+		auto kind = static_cast<size_t>(ev->kind);
+		if (kind >= KIND_COUNT || (ev->end.sec == 0 && ev->end.ns == 0)) {
+			continue;
+		}
+
+		TimingInterval interval;
+		uint64_t total_ns;
+		calculate_interval (ev->start, ev->end, interval, total_ns);
+
+		kind_histograms [kind].record (total_ns);
+		if (ev->more_info != nullptr && *ev->more_info != '\0') {
+			name_histograms [kind][ev->more_info].record (total_ns);
+		}
+	}
+
+	log_write (LOG_TIMING, LogLevel::Info, "[2/8] Event duration statistics");
+
+	auto log_histogram = [](const char *format, const char *name, TimingHistogram const& histogram) {
+		uint32_t sec[4], ms[4], ns[4];
+
+		ns_to_time (histogram.percentile (50), sec[0], ms[0], ns[0]);
+		ns_to_time (histogram.percentile (95), sec[1], ms[1], ns[1]);
+		ns_to_time (histogram.percentile (99), sec[2], ms[2], ns[2]);
+		ns_to_time (histogram.max_value (), sec[3], ms[3], ns[3]);
+
+		log_info_nocheck (
+			LOG_TIMING,
+			format,
+			name,
+			histogram.total_count (),
+			sec[0], ms[0], ns[0],
+			sec[1], ms[1], ns[1],
+			sec[2], ms[2], ns[2],
+			sec[3], ms[3], ns[3]
+		);
+	};
+
+	std::vector<std::pair<std::string_view, TimingHistogram const*>> names;
+	for (size_t kind = 0; kind < KIND_COUNT; kind++) {
+		TimingHistogram const& histogram = kind_histograms [kind];
+		if (histogram.total_count () == 0) {
+			continue;
+		}
+
+		log_histogram (
+			"  [2/9] %s: count %" PRIu64 ", p50 %u:%u::%u, p95 %u:%u::%u, p99 %u:%u::%u, max %u:%u::%u",
+			event_kind_name (static_cast<TimingEventKind>(kind)),
+			histogram
+		);
+
+		names.clear ();
+		for (auto const& [name, name_histogram] : name_histograms [kind]) {
+			names.emplace_back (name, &name_histogram);
+		}
+
+		size_t name_count = std::min (names.size (), MAX_NAMES_PER_KIND);
+		std::partial_sort (
+			names.begin (),
+			names.begin () + static_cast<ptrdiff_t>(name_count),
+			names.end (),
+			[](auto const& a, auto const& b) {
+				return a.second->max_value () > b.second->max_value ();
+			}
+		);
+
+		for (size_t i = 0; i < name_count; i++) {
+			log_histogram (
+				"    [2/10] %s: count %" PRIu64 ", p50 %u:%u::%u, p95 %u:%u::%u, p99 %u:%u::%u, max %u:%u::%u",
+				names[i].first.data (),
+				*names[i].second
+			);
+		}
+	}
 }
@@ -1,14 +1,19 @@
 #if !defined (__TIMING_INTERNAL_HH)
 #define __TIMING_INTERNAL_HH
 
+#include <array>
 #include <atomic>
 #include <concepts>
 #include <ctime>
+#include <limits>
 #include <vector>
 
+#include <sys/types.h>
+#include <unistd.h>
+
 #include "cpp-util.hh"
+#include "globals.hh"
 #include "logger.hh"
-#include "startup-aware-lock.hh"
 #include "strings.hh"
 #include "util.hh"
 #include "shared-constants.hh"
@@ -38,6 +43,8 @@ namespace xamarin::android::internal
 		RuntimeRegister           = 10,
 		TotalRuntimeInit          = 11,
 		Unspecified               = 12,
+		DSOWarmup                 = 13,
+		AssemblyPrefetch          = 14,
 	};
 
 	struct TimingEventPoint
@@ -62,6 +69,17 @@ namespace xamarin::android::internal
 		const char*      more_info;
 	};
 
+	// Events recorded by a single thread, never moved once recorded.  Only the owning thread writes to the chunk, `used`
+	// is published with release semantics so that `FastTiming::dump` sees the complete start of every event it counts.
+	struct TimingEventChunk
+	{
+		static constexpr size_t EVENT_COUNT = 512;
+
+		std::atomic_size_t  used;
+		pid_t               thread_id;
+		TimingEvent         events[EVENT_COUNT];
+	};
+
 	template<typename T>
 	concept TimingPointType = requires (T a) {
 		{ a.sec } -> std::same_as<time_t&>;
@@ -77,20 +95,15 @@ namespace xamarin::android::internal
 
 	class FastTiming final
 	{
-		// Number of TimingEvent entries in the event vector allocated at the
-		// time of class instantiation.  It's an arbitrary value, but it should
-		// be large enough to not require any dynamic reallocation of memory at
-		// the run time.
-		static constexpr size_t INITIAL_EVENT_VECTOR_SIZE = 4096;
+		// Size of the global chunk table, limits the number of events to `MAX_CHUNKS * TimingEventChunk::EVENT_COUNT`
+		static constexpr size_t MAX_CHUNKS = 2048;
+		static constexpr size_t INVALID_EVENT_INDEX = std::numeric_limits<size_t>::max ();
 		static constexpr uint32_t ns_in_millisecond = 1000000;
 		static constexpr uint32_t ms_in_second = 1000;
 		static constexpr uint32_t ns_in_second = ms_in_second * ns_in_millisecond;
 
 	protected:
-		FastTiming () noexcept
-		{
-			events.reserve (INITIAL_EVENT_VECTOR_SIZE);
-		}
+		FastTiming () noexcept = default;
 
 	public:
 		force_inline static bool enabled () noexcept
@@ -105,6 +118,11 @@ namespace xamarin::android::internal
 				(Logger::log_timing_categories() & LogTimingCategories::FastBare) == LogTimingCategories::FastBare;
 		}
 
+		force_inline static bool is_trace_mode () noexcept
+		{
+			return (Logger::log_timing_categories() & LogTimingCategories::Trace) == LogTimingCategories::Trace;
+		}
+
 		force_inline static void initialize (bool log_immediately) noexcept
 		{
 			if (!Util::should_log (LOG_TIMING)) [[likely]] {
@@ -125,66 +143,63 @@ namespace xamarin::android::internal
 			log (init_time, false /* skip_log_if_more_info_missing */);
 		}
 
-		// std::vector<T> isn't used in a conventional manner here. We treat it as if it was a standard array and we
-		// don't take advantage of any emplacement functionality, merely using vector's ability to resize itself when
-		// needed.  The reason for this is speed - we can atomically increase index into the array and relatively
-		// quickly check whether it's within the boundaries.  We can then safely use thus indexed element without
-		// worrying about concurrency.  Emplacing a new element in the vector would require holding the mutex, something
-		// that's fairly costly and has unpredictable effect on time spent acquiring and holding the lock (the OS can
-		// preempt us at this point)
+		// Every thread records its events into its own chunk (see `TimingEventChunk`), so recording an event takes no
+		// locks and no atomic read-modify-write operations, and events never move once recorded.  A new chunk is
+		// registered in the global chunk table when the thread's current one fills up.  The returned index identifies
+		// the event globally and may be passed to `end_event` and `add_more_info` on any thread.
 		force_inline size_t start_event (TimingEventKind kind = TimingEventKind::Unspecified) noexcept
 		{
-			size_t index = next_event_index.fetch_add (1);
-
-			if (index >= events.capacity ()) [[unlikely]] {
-				StartupAwareLock lock (event_vector_realloc_mutex);
-				if (index >= events.size ()) { // don't increase unnecessarily, if another thread has already done that
-					// Double the vector size. We should, in theory, check for integer overflow here, but it's more
-					// likely we'll run out of memory way, way, way before that happens
-					size_t old_size = events.capacity ();
-					events.reserve (old_size << 1);
-					log_warn (LOG_TIMING, "Reallocated timing event buffer from %zu to %zu", old_size, events.size ());
+			ThreadChunk &tc = thread_chunk;
+
+			if (tc.chunk == nullptr || tc.next_slot >= TimingEventChunk::EVENT_COUNT) [[unlikely]] {
+				if (!acquire_chunk (tc)) {
+					return INVALID_EVENT_INDEX;
 				}
 			}
 
-			TimingEvent &ev = events[index];
+			size_t slot = tc.next_slot++;
+			TimingEvent &ev = tc.chunk->events[slot];
 			mark (ev.start);
 			ev.kind = kind;
 			ev.before_managed = MonodroidRuntime::is_startup_in_progress ();
 			ev.more_info = nullptr;
+			tc.chunk->used.store (tc.next_slot, std::memory_order_release);
 
-			return index;
+			return tc.chunk_index * TimingEventChunk::EVENT_COUNT + slot;
 		}
 
 		force_inline void end_event (size_t event_index, bool uses_more_info = false) noexcept
 		{
-			if (!is_valid_event_index (event_index, __PRETTY_FUNCTION__)) [[unlikely]] {
+			TimingEvent *ev = get_event (event_index, __PRETTY_FUNCTION__);
+			if (ev == nullptr) [[unlikely]] {
 				return;
 			}
 
-			mark (events[event_index].end);
-			log (events[event_index], uses_more_info /* skip_log_if_more_info_missing */);
+			mark (ev->end);
+			log (*ev, uses_more_info /* skip_log_if_more_info_missing */);
 		}
 
 		template<size_t MaxStackSize, typename TStorage, typename TChar = char>
 		force_inline void add_more_info (size_t event_index, string_base<MaxStackSize, TStorage, TChar> const& str) noexcept
 		{
-			if (!is_valid_event_index (event_index, __PRETTY_FUNCTION__)) [[unlikely]] {
+			TimingEvent *ev = get_event (event_index, __PRETTY_FUNCTION__);
+			if (ev == nullptr) [[unlikely]] {
 				return;
 			}
 
-			events[event_index].more_info = Util::strdup_new (str.get (), str.length ());
-			log (events[event_index], false /* skip_log_if_more_info_missing */);
+			ev->more_info = Util::strdup_new (str.get (), str.length ());
+			log (*ev, false /* skip_log_if_more_info_missing */);
 		}
 
 		force_inline void add_more_info (size_t event_index, const char* str) noexcept
 		{
-			if (!is_valid_event_index (event_index, __PRETTY_FUNCTION__)) [[unlikely]] {
+			TimingEvent *ev = get_event (event_index, __PRETTY_FUNCTION__);
+			if (ev == nullptr) [[unlikely]] {
 				return;
 			}
 
-			events[event_index].more_info = Util::strdup_new (str, strlen (str));
-			log (events[event_index], false /* skip_log_if_more_info_missing */);
+			ev->more_info = Util::strdup_new (str, strlen (str));
+			log (*ev, false /* skip_log_if_more_info_missing */);
 		}
 
 		force_inline static void get_time (time_t &seconds_out, uint64_t& ns_out) noexcept
@@ -234,22 +249,37 @@ namespace xamarin::android::internal
 		void dump () noexcept;
 
 	private:
+		struct ThreadChunk
+		{
+			TimingEventChunk *chunk;
+			size_t            chunk_index;
+			size_t            next_slot;
+		};
+
 		static void really_initialize (bool log_immediately) noexcept;
 		static void* timing_signal_thread (void *arg) noexcept;
+		bool acquire_chunk (ThreadChunk &tc) noexcept;
+		void write_trace () noexcept;
+		static void log_statistics (std::vector<TimingEvent const*> const& events) noexcept;
 
 		force_inline static void mark (TimingEventPoint &point) noexcept
 		{
 			get_time (point.sec, point.ns);
 		}
 
-		force_inline bool is_valid_event_index (size_t index, const char *method_name) noexcept
+		force_inline TimingEvent* get_event (size_t index, const char *method_name) noexcept
 		{
-			if (index >= events.capacity ()) [[unlikely]] {
-				log_warn (LOG_TIMING, "Invalid event index passed to method '%s'", method_name);
-				return false;
+			size_t chunk_index = index / TimingEventChunk::EVENT_COUNT;
+			TimingEventChunk *chunk = chunk_index < MAX_CHUNKS ? chunks[chunk_index].load (std::memory_order_acquire) : nullptr;
+
+			if (chunk == nullptr) [[unlikely]] {
+				if (index != INVALID_EVENT_INDEX) {
+					log_warn (LOG_TIMING, "Invalid event index passed to method '%s'", method_name);
+				}
+				return nullptr;
 			}
 
-			return true;
+			return &chunk->events[index % TimingEventChunk::EVENT_COUNT];
 		}
 
 		template<size_t BufferSize>
@@ -328,6 +358,18 @@ namespace xamarin::android::internal
 					return;
 				}
 
+				case TimingEventKind::DSOWarmup: {
+					constexpr char desc[] = "DSO warm-up: end, number of preloaded shared libraries: ";
+					message.append (desc);
+					return;
+				}
+
+				case TimingEventKind::AssemblyPrefetch: {
+					constexpr char desc[] = "Assembly prefetch: end, number of prefetched assemblies: ";
+					message.append (desc);
+					return;
+				}
+
 				default: {
 					constexpr char desc[] = "Unknown timing event";
 					message.append (desc);
@@ -439,11 +481,13 @@ namespace xamarin::android::internal
 		}
 
 	private:
-		std::atomic_size_t next_event_index = 0;
-		std::mutex event_vector_realloc_mutex;
-		std::vector<TimingEvent> events;
+		std::atomic_size_t next_chunk_index = 0;
+		std::array<std::atomic<TimingEventChunk*>, MAX_CHUNKS> chunks {};
+
+		static inline thread_local ThreadChunk thread_chunk {};
 
 		static TimingEvent init_time;
+		static pid_t init_thread_id;
 		static bool is_enabled;
 		static bool immediate_logging;
 	};
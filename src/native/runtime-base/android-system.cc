@@ -7,6 +7,7 @@
 
 #include "android-system.hh"
 #include "cpp-util.hh"
+#include "cppcompat.hh"
 #include "java-interop-dlfcn.h"
 #include "java-interop.h"
 #include "jni-wrappers.hh"
@@ -25,6 +26,9 @@ FILE  *lref_log;
 bool    gref_to_logcat;
 bool    lref_to_logcat;
 
+// Held only while a directory index is created, lookups are lock-free
+static std::mutex dso_directory_index_lock;
+
 #if defined (DEBUG)
 namespace xamarin::android::internal {
 	struct BundledProperty {
@@ -307,11 +311,15 @@ AndroidSystem::load_dso (const char *path, unsigned int dl_flags, bool skip_exis
 		return nullptr;
 
 	log_info (LOG_ASSEMBLY, "Trying to load shared library '%s'", path);
-	if (!skip_exists_check && !is_embedded_dso_mode_enabled () && !Util::file_exists (path)) {
-		log_info (LOG_ASSEMBLY, "Shared library '%s' not found", path);
-		return nullptr;
+	if (!skip_exists_check && !is_embedded_dso_mode_enabled ()) {
+		dso_probe_stat_count.fetch_add (1, std::memory_order_relaxed);
+		if (!Util::file_exists (path)) {
+			log_info (LOG_ASSEMBLY, "Shared library '%s' not found", path);
+			return nullptr;
+		}
 	}
 
+	dso_probe_dlopen_count.fetch_add (1, std::memory_order_relaxed);
 	char *error = nullptr;
 	void *handle = java_interop_lib_load (path, dl_flags, &error);
 	if (handle == nullptr && Util::should_log (LOG_ASSEMBLY))
@@ -329,10 +337,15 @@ AndroidSystem::load_dso_from_specified_dirs (const char **directories, size_t nu
 
 	dynamic_local_string<SENSIBLE_PATH_MAX> full_path;
 	for (size_t i = 0; i < num_entries; i++) {
+		DsoLookupResult lookup = dso_directory_lookup (directories [i], dso_name);
+		if (lookup == DsoLookupResult::Absent) {
+			continue;
+		}
+
 		if (!get_full_dso_path (directories [i], dso_name, full_path)) {
 			continue;
 		}
-		void *handle = load_dso (full_path.get (), dl_flags, false);
+		void *handle = load_dso (full_path.get (), dl_flags, lookup == DsoLookupResult::Present /* skip_exists_check */);
 		if (handle != nullptr)
 			return handle;
 	}
@@ -368,10 +381,163 @@ AndroidSystem::load_dso_from_any_directories (const char *name, unsigned int dl_
 bool
 AndroidSystem::get_existing_dso_path_on_disk (const char *base_dir, const char *dso_name, dynamic_local_string<SENSIBLE_PATH_MAX>& path) noexcept
 {
-	if (get_full_dso_path (base_dir, dso_name, path) && Util::file_exists (path.get ()))
+	DsoLookupResult lookup = dso_directory_lookup (base_dir, dso_name);
+	if (lookup == DsoLookupResult::Absent) {
+		return false;
+	}
+
+	if (!get_full_dso_path (base_dir, dso_name, path)) {
+		return false;
+	}
+
+	if (lookup == DsoLookupResult::Present) {
 		return true;
+	}
 
-	return false;
+	dso_probe_stat_count.fetch_add (1, std::memory_order_relaxed);
+	return Util::file_exists (path.get ());
+}
+
+AndroidSystem::DsoDirectoryIndex*
+AndroidSystem::create_dso_directory_index (const char *directory) noexcept
+{
+	auto index = new DsoDirectoryIndex {
+		.directory = directory,
+		.name_hashes = nullptr,
+		.name_count = 0,
+		.usable = false,
+		.next = nullptr,
+	};
+
+	DIR *dir = ::opendir (directory);
+	if (dir == nullptr) {
+		log_debug (LOG_ASSEMBLY, "Unable to index DSO directory '%s', it will be probed instead. %s", directory, strerror (errno));
+		return index;
+	}
+	dso_directory_scan_count.fetch_add (1, std::memory_order_relaxed);
+
+	size_t capacity = 32;
+	hash_t *hashes = new hash_t[capacity];
+	size_t count = 0;
+	dirent *e;
+
+	while ((e = ::readdir (dir)) != nullptr) {
+		// We can't rely on d_type being set on all file systems, any non-directory entry is a candidate
+		if (e->d_type == DT_DIR) {
+			continue;
+		}
+
+		if (count == capacity) {
+			size_t new_capacity = Helpers::multiply_with_overflow_check<size_t> (capacity, 2);
+			auto new_hashes = new hash_t[new_capacity];
+			memcpy (new_hashes, hashes, sizeof (hash_t) * count);
+			delete[] hashes;
+			hashes = new_hashes;
+			capacity = new_capacity;
+		}
+
+		hashes[count++] = xxhash::hash (e->d_name, strlen (e->d_name));
+	}
+	::closedir (dir);
+
+	auto compare = [](const void *a, const void *b) -> int {
+		hash_t ha = *static_cast<const hash_t*>(a);
+		hash_t hb = *static_cast<const hash_t*>(b);
+
+		return ha < hb ? -1 : (ha > hb ? 1 : 0);
+	};
+	qsort (hashes, count, sizeof (hash_t), compare);
+
+	index->name_hashes = hashes;
+	index->name_count = count;
+	index->usable = true;
+
+	log_debug (LOG_ASSEMBLY, "Indexed DSO directory '%s', %zu entries", directory, count);
+	return index;
+}
+
+AndroidSystem::DsoDirectoryIndex*
+AndroidSystem::get_dso_directory_index (const char *directory) noexcept
+{
+	auto find = [](const char *dir) -> DsoDirectoryIndex* {
+		for (DsoDirectoryIndex *index = dso_directory_indexes.load (std::memory_order_acquire); index != nullptr; index = index->next) {
+			if (index->directory == dir || strcmp (index->directory, dir) == 0) {
+				return index;
+			}
+		}
+
+		return nullptr;
+	};
+
+	DsoDirectoryIndex *index = find (directory);
+	if (index != nullptr) [[likely]] {
+		return index;
+	}
+
+	// Indexes are never removed, so the list can be walked without the lock. We take it only to make sure that a
+	// directory is scanned just once, even if two threads race to load a DSO (e.g. the DSO warm-up thread)
+	std::lock_guard<std::mutex> lock (dso_directory_index_lock);
+	index = find (directory);
+	if (index != nullptr) {
+		return index;
+	}
+
+	index = create_dso_directory_index (directory);
+	index->next = dso_directory_indexes.load (std::memory_order_relaxed);
+	dso_directory_indexes.store (index, std::memory_order_release);
+
+	return index;
+}
+
+AndroidSystem::DsoLookupResult
+AndroidSystem::dso_directory_lookup (const char *directory, const char *dso_name) noexcept
+{
+	// In the embedded DSO mode the "directories" point into the APK, they can't be read with readdir(3)
+	if (directory == nullptr || dso_name == nullptr || is_embedded_dso_mode_enabled ()) {
+		return DsoLookupResult::Unknown;
+	}
+
+	// Only plain file names can be looked up, anything else has to be resolved by the file system
+	if (Util::is_path_rooted (dso_name) || strchr (dso_name, '/') != nullptr) {
+		return DsoLookupResult::Unknown;
+	}
+
+	DsoDirectoryIndex *index = get_dso_directory_index (directory);
+	if (!index->usable) {
+		return DsoLookupResult::Unknown;
+	}
+
+	auto compare = [](const void *key, const void *entry) -> int {
+		hash_t hk = *static_cast<const hash_t*>(key);
+		hash_t he = *static_cast<const hash_t*>(entry);
+
+		return hk < he ? -1 : (hk > he ? 1 : 0);
+	};
+
+	hash_t name_hash = xxhash::hash (dso_name, strlen (dso_name));
+	if (bsearch (&name_hash, index->name_hashes, index->name_count, sizeof (hash_t), compare) != nullptr) {
+		return DsoLookupResult::Present;
+	}
+
+	dso_probes_avoided_count.fetch_add (1, std::memory_order_relaxed);
+	return DsoLookupResult::Absent;
+}
+
+void
+AndroidSystem::log_dso_probe_stats () noexcept
+{
+	if (!Util::should_log (LOG_ASSEMBLY)) [[likely]] {
+		return;
+	}
+
+	log_info_nocheck (
+		LOG_ASSEMBLY,
+		"DSO probing: %zu directories indexed; %zu stat(2) probes, %zu dlopen(3) calls; %zu probes avoided thanks to the directory index",
+		dso_directory_scan_count.load (std::memory_order_relaxed),
+		dso_probe_stat_count.load (std::memory_order_relaxed),
+		dso_probe_dlopen_count.load (std::memory_order_relaxed),
+		dso_probes_avoided_count.load (std::memory_order_relaxed)
+	);
 }
 
 bool
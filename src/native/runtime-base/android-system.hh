@@ -2,6 +2,7 @@
 #define ANDROID_SYSTEM_HH
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -94,6 +95,7 @@ namespace xamarin::android::internal {
 		static void setup_environment () noexcept;
 		static void setup_process_args (jstring_array_wrapper &runtimeApks) noexcept;
 		static void create_update_dir (char *override_dir) noexcept;
+		static void log_dso_probe_stats () noexcept;
 		static int monodroid_get_system_property (const char *name, char **value) noexcept;
 		static int monodroid_get_system_property (const char *name, dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> &value) noexcept;
 
@@ -211,6 +213,30 @@ namespace xamarin::android::internal {
 		static void* load_dso_from_override_dirs (const char *name, unsigned int dl_flags) noexcept;
 		static bool get_existing_dso_path_on_disk (const char *base_dir, const char *dso_name, dynamic_local_string<SENSIBLE_PATH_MAX>& path) noexcept;
 
+		// Contents of a directory we load DSOs from, read once with a single readdir(3) pass, so that probing the
+		// directory for a library is a binary search instead of a stat(2) or a dlopen(3) call.  The index is
+		// complete, so a name not found in it is known not to exist in the directory (negative lookups are
+		// cached as well)
+		struct DsoDirectoryIndex
+		{
+			const char         *directory;
+			hash_t             *name_hashes; // sorted
+			size_t              name_count;
+			bool                usable;      // false if the directory couldn't be read, we must probe it then
+			DsoDirectoryIndex  *next;
+		};
+
+		enum class DsoLookupResult
+		{
+			Present,
+			Absent,
+			Unknown,
+		};
+
+		static DsoDirectoryIndex* get_dso_directory_index (const char *directory) noexcept;
+		static DsoDirectoryIndex* create_dso_directory_index (const char *directory) noexcept;
+		static DsoLookupResult dso_directory_lookup (const char *directory, const char *dso_name) noexcept;
+
 	private:
 		static void add_apk_libdir (const char *apk, size_t &index, const char *abi) noexcept;
 		static void setup_apk_directories (unsigned short running_on_cpu, jstring_array_wrapper &runtimeApks, bool have_split_apks) noexcept;
@@ -228,6 +254,12 @@ namespace xamarin::android::internal {
 		static inline long max_gref_count = 0;
 		static inline MonoAotMode aotMode = MonoAotMode::MONO_AOT_MODE_NONE;
 		static inline bool running_in_emulator = false;
+
+		static inline std::atomic<DsoDirectoryIndex*>  dso_directory_indexes { nullptr };
+		static inline std::atomic_size_t               dso_probe_stat_count { 0 };
+		static inline std::atomic_size_t               dso_probe_dlopen_count { 0 };
+		static inline std::atomic_size_t               dso_probes_avoided_count { 0 };
+		static inline std::atomic_size_t               dso_directory_scan_count { 0 };
 	};
 }
 #endif // !ANDROID_SYSTEM_HH
@@ -89,7 +89,7 @@ void
 Logger::init_reference_logging (const char *override_dir) noexcept
 {
 	if ((log_categories & LOG_GREF) != 0 && !light_gref) {
-		gref_log  = open_file (LOG_GREF, gref_file, override_dir, "grefs.txt");
+		gref_log  = open_file (LOG_GREF, gref_file, override_dir, _ref_log_binary ? "grefs.bin" : "grefs.txt");
 	}
 
 	if ((log_categories & LOG_LREF) != 0 && !light_lref) {
@@ -97,7 +97,7 @@ Logger::init_reference_logging (const char *override_dir) noexcept
 		if (lref_file != nullptr && strcmp (lref_file, gref_file != nullptr ? gref_file : "") == 0) {
 			lref_log  = gref_log;
 		} else {
-			lref_log  = open_file (LOG_LREF, lref_file, override_dir, "lrefs.txt");
+			lref_log  = open_file (LOG_LREF, lref_file, override_dir, _ref_log_binary ? "lrefs.bin" : "lrefs.txt");
 		}
 	}
 }
@@ -173,6 +173,37 @@ Logger::init_logging_categories (char*& mono_log_mask, char*& mono_log_level) no
 			continue;
 		}
 
+		constexpr std::string_view REF_ASYNC { "ref-async" };
+		if (param.equal (REF_ASYNC)) {
+			_ref_log_async = true;
+			continue;
+		}
+
+		constexpr std::string_view REF_BINARY { "ref-binary" };
+		if (param.equal (REF_BINARY)) {
+			_ref_log_async = true;
+			_ref_log_binary = true;
+			continue;
+		}
+
+		constexpr std::string_view JIT_BINARY { "jit-binary" };
+		if (param.equal (JIT_BINARY)) {
+			_jit_log_binary = true;
+			continue;
+		}
+
+		constexpr std::string_view JIT_PROFILE { "jit-profile" };
+		if (param.equal (JIT_PROFILE)) {
+			_jit_profile = true;
+			continue;
+		}
+
+		constexpr std::string_view GREF_ATTRIBUTION { "gref-attribution" };
+		if (param.equal (GREF_ATTRIBUTION)) {
+			_gref_attribution = true;
+			continue;
+		}
+
 		constexpr std::string_view CAT_GREF_EQUALS { "gref=" };
 		if (set_category (CAT_GREF_EQUALS, param, LOG_GREF, true /* arg_starts_with_name */)) {
 			gref_file = Util::strdup_new (param, CAT_GREF_EQUALS.length ());
@@ -211,6 +242,12 @@ Logger::init_logging_categories (char*& mono_log_mask, char*& mono_log_level) no
 			continue;
 		}
 
+		if (param.starts_with ("timing=trace")) {
+			log_categories |= LOG_TIMING;
+			_log_timing_categories |= LogTimingCategories::Trace;
+			continue;
+		}
+
 		if (param.starts_with ("timing=bare")) {
 			log_categories |= LOG_TIMING;
 			_log_timing_categories |= LogTimingCategories::Bare;
@@ -18,6 +18,31 @@ namespace xamarin::android {
 			return _log_timing_categories;
 		}
 
+		static bool ref_log_async () noexcept
+		{
+			return _ref_log_async;
+		}
+
+		static bool ref_log_binary () noexcept
+		{
+			return _ref_log_binary;
+		}
+
+		static bool gref_attribution () noexcept
+		{
+			return _gref_attribution;
+		}
+
+		static bool jit_log_binary () noexcept
+		{
+			return _jit_log_binary;
+		}
+
+		static bool jit_profile () noexcept
+		{
+			return _jit_profile;
+		}
+
 #if defined(DEBUG)
 		static void set_debugger_log_level (const char *level) noexcept;
 
@@ -47,6 +72,11 @@ namespace xamarin::android {
 
 	private:
 		static inline LogTimingCategories _log_timing_categories;
+		static inline bool _ref_log_async = false;
+		static inline bool _ref_log_binary = false;
+		static inline bool _gref_attribution = false;
+		static inline bool _jit_log_binary = false;
+		static inline bool _jit_profile = false;
 #if defined(DEBUG)
 		static inline bool _got_debugger_log_level = false;
 		static inline int _debugger_log_level = 0;
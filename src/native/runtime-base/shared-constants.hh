@@ -47,14 +47,18 @@ namespace xamarin::android::internal
 		static constexpr std::string_view OVERRIDE_DIRECTORY_NAME             { ".__override__" };
 
 		/* Android property containing connection information, set by XS */
+		static inline constexpr std::string_view DEBUG_MONO_ASSEMBLY_PREFETCH_PROPERTY { "debug.mono.assembly_prefetch" };
 		static inline constexpr std::string_view DEBUG_MONO_CONNECT_PROPERTY      { "debug.mono.connect" };
 		static inline constexpr std::string_view DEBUG_MONO_DEBUG_PROPERTY        { "debug.mono.debug" };
+		static inline constexpr std::string_view DEBUG_MONO_DSO_WARMUP_PROPERTY   { "debug.mono.dso_warmup" };
 		static inline constexpr std::string_view DEBUG_MONO_ENV_PROPERTY          { "debug.mono.env" };
 		static inline constexpr std::string_view DEBUG_MONO_EXTRA_PROPERTY        { "debug.mono.extra" };
 		static inline constexpr std::string_view DEBUG_MONO_GC_PROPERTY           { "debug.mono.gc" };
+		static inline constexpr std::string_view DEBUG_MONO_GC_BRIDGE_PROPERTY    { "debug.mono.gc_bridge" };
 		static inline constexpr std::string_view DEBUG_MONO_GDB_PROPERTY          { "debug.mono.gdb" };
 		static inline constexpr std::string_view DEBUG_MONO_LOG_PROPERTY          { "debug.mono.log" };
 		static inline constexpr std::string_view DEBUG_MONO_MAX_GREFC             { "debug.mono.max_grefc" };
+		static inline constexpr std::string_view DEBUG_MONO_NATIVE_PROFILER_PROPERTY { "debug.mono.native_profiler" };
 		static inline constexpr std::string_view DEBUG_MONO_PROFILE_PROPERTY      { "debug.mono.profile" };
 		static inline constexpr std::string_view DEBUG_MONO_RUNTIME_ARGS_PROPERTY { "debug.mono.runtime_args" };
 		static inline constexpr std::string_view DEBUG_MONO_SOFT_BREAKPOINTS      { "debug.mono.soft_breakpoints" };
@@ -11,6 +11,7 @@ namespace xamarin::android {
 		Default  = 0,
 		Bare     = 1 << 0,
 		FastBare = 1 << 1,
+		Trace    = 1 << 2,
 	};
 
 	// Keep in sync with LogLevel defined in JNIEnv.cs
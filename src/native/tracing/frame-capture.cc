@@ -0,0 +1,143 @@
+#include <array>
+
+#include <ucontext.h>
+
+#include "frame-capture.hh"
+
+using namespace xamarin::android::internal;
+
+namespace {
+	constexpr size_t MAX_PREPARE_FRAMES = 256;
+
+	// snprintf isn't async-signal-safe, the numbers are formatted by hand.  Returns the number of characters stored in
+	// `buffer`, which must be big enough.
+	size_t format_number (char *buffer, uintptr_t value, unsigned base, size_t min_width) noexcept
+	{
+		constexpr char DIGITS[] = "0123456789abcdef";
+
+		std::array<char, sizeof (uintptr_t) * 8> digits;
+		size_t count = 0;
+		do {
+			digits[count++] = DIGITS[value % base];
+			value /= base;
+		} while (value != 0);
+
+		while (count < min_width && count < digits.size ()) {
+			digits[count++] = '0';
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			buffer[i] = digits[count - i - 1];
+		}
+		return count;
+	}
+}
+
+// Not async-signal-safe, meant to be called before the signal handlers which capture stacks are installed
+void
+FrameCapture::prepare () noexcept
+{
+	std::array<uintptr_t, MAX_PREPARE_FRAMES> frames;
+	capture_current (frames.data (), frames.size ());
+}
+
+size_t
+FrameCapture::capture_signal_context (uintptr_t *frames, size_t max_frames, void *signal_context) noexcept
+{
+	if (frames == nullptr || max_frames == 0 || signal_context == nullptr) {
+		return 0;
+	}
+
+#if defined (__arm__)
+	// libunwind's ARM context holds just the core registers, which the kernel stores in order starting with r0
+	unw_context_t uc;
+	auto mcontext = &static_cast<ucontext_t*>(signal_context)->uc_mcontext;
+	auto regs = &mcontext->arm_r0;
+	for (size_t i = 0; i < sizeof (uc.regs) / sizeof (uc.regs[0]); i++) {
+		uc.regs[i] = regs[i];
+	}
+	unw_context_t *context = &uc;
+#else
+	// On the other targets libunwind's context is laid out like `ucontext_t` (or a prefix of it, on arm64)
+	auto context = static_cast<unw_context_t*>(signal_context);
+#endif
+
+	unw_cursor_t cursor;
+	if (unw_init_local2 (&cursor, context, UNW_INIT_SIGNAL_FRAME) < 0) {
+		return 0;
+	}
+
+	size_t     frame_count = 0;
+	unw_word_t ip;
+	do {
+		if (unw_get_reg (&cursor, UNW_REG_IP, &ip) < 0 || ip == 0) {
+			break;
+		}
+		frames[frame_count++] = static_cast<uintptr_t>(ip);
+	} while (frame_count < max_frames && unw_step (&cursor) > 0);
+
+	return frame_count;
+}
+
+size_t
+FrameCapture::format (char *buffer, size_t buffer_size, uintptr_t const* frames, size_t frame_count) noexcept
+{
+	// "    #", up to 20 digits of the frame number, ": 0x", up to 16 hex digits of the address and a newline
+	constexpr size_t MAX_LINE_LENGTH = 5 + 20 + 4 + 16 + 1;
+	constexpr size_t ADDRESS_WIDTH = sizeof (uintptr_t) * 2;
+
+	if (buffer == nullptr || buffer_size == 0) {
+		return 0;
+	}
+
+	std::array<char, MAX_LINE_LENGTH> line;
+	size_t length = 0;
+
+	for (size_t i = 0; i < frame_count; i++) {
+		size_t line_length = 0;
+		for (char c : { ' ', ' ', ' ', ' ', '#' }) {
+			line[line_length++] = c;
+		}
+		line_length += format_number (line.data () + line_length, i, 10, 0);
+		for (char c : { ':', ' ', '0', 'x' }) {
+			line[line_length++] = c;
+		}
+		line_length += format_number (line.data () + line_length, frames[i], 16, ADDRESS_WIDTH);
+		line[line_length++] = '\n';
+
+		// Leave room for the terminating NUL
+		if (length + line_length >= buffer_size) {
+			break;
+		}
+
+		for (size_t c = 0; c < line_length; c++) {
+			buffer[length++] = line[c];
+		}
+	}
+
+	buffer[length] = '\0';
+	return length;
+}
+
+size_t xa_capture_native_frames (uintptr_t *frames, size_t max_frames, void *signal_context) noexcept
+{
+	if (signal_context != nullptr) {
+		return FrameCapture::capture_signal_context (frames, max_frames, signal_context);
+	}
+
+	if (frames == nullptr || max_frames == 0) {
+		return 0;
+	}
+
+	return FrameCapture::capture_current (frames, max_frames);
+}
+
+size_t xa_format_native_frames (char *buffer, size_t buffer_size, uintptr_t const* frames, size_t frame_count) noexcept
+{
+	return FrameCapture::format (buffer, buffer_size, frames, frame_count);
+}
+
+void xa_prepare_native_frame_capture () noexcept
+{
+	FrameCapture::prepare ();
+}
@@ -0,0 +1,54 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#if !defined (__FRAME_CAPTURE_HH)
+#define __FRAME_CAPTURE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include "native-tracing.hh"
+
+namespace xamarin::android::internal
+{
+	// Unwinds stacks into storage provided by the caller, without allocating memory or taking locks, so that it can be
+	// used in signal handlers (crash handlers, the sampling profiler) and when memory is short.  libunwind's own caches
+	// are protected with locks taken with all signals blocked, so they can't be interrupted by a handler on the same
+	// thread.  The one exception is an interrupted thread which is inside the dynamic linker: libunwind calls
+	// `dl_iterate_phdr` to find the unwind tables of code it hasn't seen yet.  `prepare` lets libunwind see the code of
+	// the calling thread's stack before any signal handler needs it.
+	//
+	// The addresses are stored as libunwind returns them: the interrupted instruction for the innermost frame of a
+	// signal context, return addresses (see `adjust_address`) for all the others.
+	class FrameCapture
+	{
+	public:
+		static void prepare () noexcept;
+
+		// Must be inlined into the function whose caller's frame is the first one to capture
+		[[gnu::always_inline]]
+		static size_t capture_current (uintptr_t *frames, size_t max_frames) noexcept
+		{
+			unw_cursor_t   cursor;
+			unw_context_t  uc;
+			unw_word_t     ip;
+
+			unw_getcontext (&uc);
+			unw_init_local (&cursor, &uc);
+
+			size_t frame_count = 0;
+			while (frame_count < max_frames && unw_step (&cursor) > 0) {
+				unw_get_reg (&cursor, UNW_REG_IP, &ip);
+				frames[frame_count++] = static_cast<uintptr_t>(ip);
+			}
+
+			return frame_count;
+		}
+
+		// `signal_context` is the third argument of a signal handler installed with `SA_SIGINFO`
+		static size_t capture_signal_context (uintptr_t *frames, size_t max_frames, void *signal_context) noexcept;
+
+		// Writes one line per frame with its number and address, terminated with a NUL.  Frames which don't fit are
+		// left out.  Returns the length of the text.
+		static size_t format (char *buffer, size_t buffer_size, uintptr_t const* frames, size_t frame_count) noexcept;
+	};
+}
+#endif // ndef __FRAME_CAPTURE_HH
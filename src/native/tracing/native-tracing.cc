@@ -1,20 +1,25 @@
 #include <array>
 #include <cstring>
 #include <string>
+#include <vector>
 
 #include <dlfcn.h>
-#include <cxxabi.h>
 
 #include <android/log.h>
 
+#include "frame-capture.hh"
 #include "native-tracing.hh"
 #include "shared-constants.hh"
+#include "symbol-cache.hh"
+#include "trace-store.hh"
 #include "cppcompat.hh"
 
+using namespace xamarin::android::internal;
+
 constexpr int PRIORITY = ANDROID_LOG_INFO;
 
 static void append_frame_number (std::string &trace, size_t count) noexcept;
-static unw_word_t adjust_address (unw_word_t addr) noexcept;
+static void format_native_trace (std::string &trace, uintptr_t const* frames, size_t frame_count) noexcept;
 static void init_jni (JNIEnv *env) noexcept;
 
 // java.lang.Thread
@@ -35,107 +40,46 @@ const char* xa_get_managed_backtrace () noexcept
 	return strdup (trace.c_str ());
 }
 
-const char* xa_get_native_backtrace () noexcept
+// The addresses are adjusted to point to the call instructions, ready to be symbolized
+[[gnu::always_inline]]
+static inline void adjust_frame_addresses (uintptr_t *frames, size_t frame_count) noexcept
 {
-	constexpr int FRAME_OFFSET_WIDTH = sizeof(uintptr_t) * 2;
-
-	unw_cursor_t           cursor;
-	unw_context_t          uc;
-	unw_word_t             ip;
-	unw_word_t             offp;
-	std::array<char, 512>  name_buf;
-	std::array<char, 32>   num_buf; // Enough for text representation of a decimal 64-bit integer + some possible
-									// additions (sign, padding, punctuation etc)
-	const char            *symbol_name;
-	Dl_info                info;
-
-	unw_getcontext (&uc);
-	unw_init_local (&cursor, &uc);
+	for (size_t i = 0; i < frame_count; i++) {
+		frames[i] = static_cast<uintptr_t>(adjust_address (frames[i]));
+	}
+}
 
-	size_t frame_counter = 0;
+const char* xa_get_native_backtrace () noexcept
+{
+	std::array<uintptr_t, TraceStore::MAX_FRAMES> frames;
+	size_t frame_count = FrameCapture::capture_current (frames.data (), frames.size ());
+	adjust_frame_addresses (frames.data (), frame_count);
 
 	std::string trace;
-	while (unw_step (&cursor) > 0) {
-		if (!trace.empty ()) {
-			trace.append ("\n");
-		}
-
-		unw_get_reg (&cursor, UNW_REG_IP, &ip);
-		ip = adjust_address (ip);
-
-		auto ptr = reinterpret_cast<void*>(ip);
-		const char *fname = nullptr;
-		const void *symptr = nullptr;
-		unw_word_t  frame_offset = 0;
-		bool info_valid = false;
-
-		if (dladdr (ptr, &info) != 0) {
-			if (info.dli_fname != nullptr) {
-				fname = info.dli_fname;
-			}
-			symptr = info.dli_sname;
-			frame_offset = ip - reinterpret_cast<unw_word_t>(info.dli_fbase);
-			info_valid = true;
-		} else {
-			frame_offset = ip;
-		}
+	format_native_trace (trace, frames.data (), frame_count);
 
-		append_frame_number (trace, frame_counter++);
-
-		std::snprintf (num_buf.data (), num_buf.size (), "%0*zx (", FRAME_OFFSET_WIDTH, frame_offset);
-		trace.append (num_buf.data ());
-		std::snprintf (num_buf.data (), num_buf.size (), "%p) ", ptr);
-		trace.append (num_buf.data ());
-
-		// TODO: consider searching /proc/self/maps for the beginning of the corresponding region to calculate the
-		// correct offset (like done in bionic stack trace)
-		trace.append (fname != nullptr ? fname : "[anonymous]");
-
-		bool symbol_name_allocated = false;
-		offp = 0;
-		if (unw_get_proc_name (&cursor, name_buf.data (), name_buf.size (), &offp) == 0) {
-			symbol_name = name_buf.data ();
-		} else if (info_valid && info.dli_sname != nullptr) {
-			symbol_name = info.dli_sname;
-		} else {
-			symbol_name = nullptr;
-		}
-		offp = adjust_address (offp);
-
-		if (symbol_name != nullptr) {
-			char *demangled_symbol_name;
-			int demangle_status;
-
-			// https://itanium-cxx-abi.github.io/cxx-abi/abi.html#demangler
-			demangled_symbol_name = abi::__cxa_demangle (symbol_name, nullptr, nullptr, &demangle_status);
-			symbol_name_allocated = demangle_status == 0 && demangled_symbol_name != nullptr;
-			if (symbol_name_allocated) {
-				symbol_name = demangled_symbol_name;
-			}
-		}
+	return strdup (trace.c_str ());
+}
 
-		if (symbol_name != nullptr) {
-			trace.append (" ");
-			trace.append (symbol_name);
-			if (offp != 0) {
-				trace.append (" + ");
-				std::snprintf (num_buf.data (), num_buf.size (), "%zu", offp);
-				trace.append (num_buf.data ());
-			}
-		}
+uint32_t xa_capture_native_trace () noexcept
+{
+	std::array<uintptr_t, TraceStore::MAX_FRAMES> frames;
+	size_t frame_count = FrameCapture::capture_current (frames.data (), frames.size ());
+	adjust_frame_addresses (frames.data (), frame_count);
 
-		if (symptr != nullptr) {
-			trace.append (" (symaddr: ");
-			std::snprintf (num_buf.data (), num_buf.size (), "%p", symptr);
-			trace.append (num_buf.data ());
-			trace.append (")");
-		}
+	return TraceStore::add (frames.data (), frame_count);
+}
 
-		if (symbol_name_allocated && symbol_name != nullptr) {
-			std::free (reinterpret_cast<void*>(const_cast<char*>(symbol_name)));
-		}
+const char* xa_resolve_native_trace (uint32_t trace_id) noexcept
+{
+	std::vector<uintptr_t> const* frames = TraceStore::find (trace_id);
+	if (frames == nullptr) {
+		return nullptr;
 	}
 
+	std::string trace;
+	format_native_trace (trace, frames->data (), frames->size ());
+
 	return strdup (trace.c_str ());
 }
 
@@ -274,6 +218,51 @@ const char* xa_get_interesting_signal_handlers () noexcept
 	return strdup (trace.c_str ());
 }
 
+void format_native_trace (std::string &trace, uintptr_t const* frames, size_t frame_count) noexcept
+{
+	constexpr int FRAME_OFFSET_WIDTH = sizeof(uintptr_t) * 2;
+
+	std::array<char, 32>   num_buf; // Enough for text representation of a decimal 64-bit integer + some possible
+									// additions (sign, padding, punctuation etc)
+
+	for (size_t i = 0; i < frame_count; i++) {
+		if (!trace.empty ()) {
+			trace.append ("\n");
+		}
+
+		uintptr_t ip = frames[i];
+		SymbolCache::Symbol const& symbol = SymbolCache::lookup (ip);
+
+		append_frame_number (trace, i);
+
+		std::snprintf (num_buf.data (), num_buf.size (), "%0*zx (", FRAME_OFFSET_WIDTH, symbol.library_base != 0 ? ip - symbol.library_base : ip);
+		trace.append (num_buf.data ());
+		std::snprintf (num_buf.data (), num_buf.size (), "%p) ", reinterpret_cast<void*>(ip));
+		trace.append (num_buf.data ());
+
+		// TODO: consider searching /proc/self/maps for the beginning of the corresponding region to calculate the
+		// correct offset (like done in bionic stack trace)
+		trace.append (symbol.library.empty () ? "[anonymous]" : symbol.library);
+
+		if (!symbol.name.empty ()) {
+			trace.append (" ");
+			trace.append (symbol.name);
+			if (symbol.name_offset != 0) {
+				trace.append (" + ");
+				std::snprintf (num_buf.data (), num_buf.size (), "%zu", symbol.name_offset);
+				trace.append (num_buf.data ());
+			}
+		}
+
+		if (symbol.symbol_address != 0) {
+			trace.append (" (symaddr: ");
+			std::snprintf (num_buf.data (), num_buf.size (), "%p", reinterpret_cast<void*>(symbol.symbol_address));
+			trace.append (num_buf.data ());
+			trace.append (")");
+		}
+	}
+}
+
 [[gnu::always_inline]]
 void append_frame_number (std::string &trace, size_t count) noexcept
 {
@@ -1,6 +1,8 @@
 #if !defined (__NATIVE_TRACING_HH)
 #define __NATIVE_TRACING_HH
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <jni.h>
 #include <android/log.h>
@@ -21,6 +23,33 @@ extern "C" {
 	[[gnu::visibility("default")]]
 	const char* xa_get_native_backtrace () noexcept;
 
+	// Captures the native stack of the calling thread without symbolizing it and returns its id, to be passed to
+	// `xa_resolve_native_trace` if and when the trace is needed.  Identical stacks get the same id.  Returns 0 if the
+	// trace couldn't be stored.
+	[[gnu::visibility("default")]]
+	uint32_t xa_capture_native_trace () noexcept;
+
+	// Returns the trace in the same format as `xa_get_native_backtrace`, or `nullptr` if the id is not known
+	[[gnu::visibility("default")]]
+	const char* xa_resolve_native_trace (uint32_t trace_id) noexcept;
+
+	// Async-signal-safe: doesn't allocate memory or take locks.  Stores up to `max_frames` addresses of the calling
+	// thread's stack in `frames`, starting with the caller of this function or, if `signal_context` isn't `nullptr`,
+	// with the instruction interrupted by the signal (`signal_context` is the third argument of a `SA_SIGINFO` signal
+	// handler).  All but that instruction are return addresses.  Returns the number of frames stored.
+	[[gnu::visibility("default")]]
+	size_t xa_capture_native_frames (uintptr_t *frames, size_t max_frames, void *signal_context) noexcept;
+
+	// Async-signal-safe: formats the frames (number and address, one per line) into `buffer`, as many as fit.  Returns
+	// the length of the NUL-terminated text.
+	[[gnu::visibility("default")]]
+	size_t xa_format_native_frames (char *buffer, size_t buffer_size, uintptr_t const* frames, size_t frame_count) noexcept;
+
+	// Not async-signal-safe: should be called before installing a signal handler which calls
+	// `xa_capture_native_frames`, to initialize the unwinder
+	[[gnu::visibility("default")]]
+	void xa_prepare_native_frame_capture () noexcept;
+
 	[[gnu::visibility("default")]]
 	const char* xa_get_java_backtrace (JNIEnv *env) noexcept;
 
@@ -29,6 +58,22 @@ extern "C" {
 
 	[[gnu::visibility("default")]]
 	const char* xa_get_interesting_signal_handlers () noexcept;
+
+	// Sampling profiler, samples the stacks of all the threads which use the CPU (`all_threads == true`) or only of those
+	// which call `xa_sample_current_thread` (including the one which starts the profiler) every `interval_us`
+	// microseconds of CPU time.  Uses SIGPROF.
+	[[gnu::visibility("default")]]
+	bool xa_start_sampling_profiler (uint32_t interval_us, bool all_threads) noexcept;
+
+	[[gnu::visibility("default")]]
+	bool xa_sample_current_thread () noexcept;
+
+	[[gnu::visibility("default")]]
+	void xa_stop_sampling_profiler () noexcept;
+
+	// Returns the stacks sampled since the profiler was first started, in the folded format used by flame graph tools
+	[[gnu::visibility("default")]]
+	const char* xa_get_sampled_stacks () noexcept;
 }
 
 template<class TJavaPointer>
@@ -45,4 +90,5 @@ inline TJavaPointer to_gref (JNIEnv *env, TJavaPointer lref) noexcept
 }
 
 bool assert_valid_jni_pointer (void *o, const char *missing_kind, const char *missing_name) noexcept;
+unw_word_t adjust_address (unw_word_t addr) noexcept;
 #endif // ndef __NATIVE_TRACING_HH
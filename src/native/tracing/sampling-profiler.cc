@@ -0,0 +1,471 @@
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <android/log.h>
+
+#include "frame-capture.hh"
+#include "native-tracing.hh"
+#include "sampling-profiler.hh"
+#include "shared-constants.hh"
+#include "symbol-cache.hh"
+
+using namespace xamarin::android::internal;
+
+namespace {
+	constexpr int PRIORITY = ANDROID_LOG_INFO;
+
+	// Folded stacks use `;` to separate the frames
+	void append_folded_frame (std::string &line, uintptr_t address) noexcept
+	{
+		size_t start = line.length ();
+
+		line.append (";");
+		SymbolCache::append_name (line, address);
+		for (size_t i = start + 1; i < line.length (); i++) {
+			if (line[i] == ';') {
+				line[i] = ':';
+			}
+		}
+	}
+}
+
+bool
+SamplingProfiler::start (uint32_t interval, bool all_threads) noexcept
+{
+	if (interval == 0) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard (lock);
+	if (running) {
+		return false;
+	}
+
+	if (threads == nullptr) {
+		// Reserved, not committed: the pages are backed by memory only once the threads store samples in them
+		void *memory = mmap (nullptr, sizeof (ThreadSamples) * MAX_THREADS, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			__android_log_print (PRIORITY, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), "Sampling profiler: failed to allocate sample buffers. %s", strerror (errno));
+			return false;
+		}
+
+		// Default-initialized, not value-initialized: the latter would zero (and commit) all of the sample buffers.
+		// The pages of an anonymous mapping are zero-filled already.
+		auto thread_samples = static_cast<ThreadSamples*>(memory);
+		for (size_t i = 0; i < MAX_THREADS; i++) {
+			new (&thread_samples[i]) ThreadSamples;
+		}
+		threads = thread_samples;
+	}
+
+	FrameCapture::prepare ();
+	if (!install_signal_handler ()) {
+		return false;
+	}
+
+	interval_us = interval;
+	sample_all_threads = all_threads;
+	sampling.store (true, std::memory_order_release);
+
+	if (all_threads) {
+		itimerval timer {};
+		timer.it_interval.tv_sec = static_cast<time_t>(interval / 1000000);
+		timer.it_interval.tv_usec = static_cast<suseconds_t>(interval % 1000000);
+		timer.it_value = timer.it_interval;
+
+		if (setitimer (ITIMER_PROF, &timer, nullptr) != 0) {
+			__android_log_print (PRIORITY, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), "Sampling profiler: failed to start the profiling timer. %s", strerror (errno));
+			sampling.store (false, std::memory_order_release);
+			return false;
+		}
+	} else {
+		ThreadSamples *thread = find_thread_samples (gettid ());
+		if (thread == nullptr || !start_thread_timer (*thread)) {
+			sampling.store (false, std::memory_order_release);
+			return false;
+		}
+	}
+
+	int ret = pthread_create (&drainer, nullptr, drain_thread, nullptr);
+	if (ret != 0) {
+		__android_log_print (PRIORITY, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), "Sampling profiler: failed to create the drain thread. %s", strerror (ret));
+	} else {
+		pthread_setname_np (drainer, DRAIN_THREAD_NAME);
+		have_drainer = true;
+	}
+
+	// Without the drain thread, the samples are collected until the thread rings fill up
+	running = true;
+	return true;
+}
+
+bool
+SamplingProfiler::add_current_thread () noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+	if (!running) {
+		return false;
+	}
+
+	if (sample_all_threads) {
+		return true;
+	}
+
+	ThreadSamples *thread = find_thread_samples (gettid ());
+	if (thread == nullptr) {
+		return false;
+	}
+
+	return thread->has_timer || start_thread_timer (*thread);
+}
+
+void
+SamplingProfiler::stop () noexcept
+{
+	bool join_drainer;
+	{
+		std::lock_guard<std::mutex> guard (lock);
+		if (!running) {
+			return;
+		}
+
+		if (sample_all_threads) {
+			itimerval timer {};
+			setitimer (ITIMER_PROF, &timer, nullptr);
+		} else {
+			for (size_t i = 0; i < MAX_THREADS; i++) {
+				stop_thread_timer (threads[i]);
+			}
+		}
+
+		// The signal handler stays installed: a signal which is already pending would kill the process with the default
+		// SIGPROF action
+		sampling.store (false, std::memory_order_release);
+		join_drainer = have_drainer;
+		have_drainer = false;
+		running = false;
+	}
+
+	if (join_drainer) {
+		pthread_join (drainer, nullptr);
+	}
+	drain ();
+}
+
+bool
+SamplingProfiler::install_signal_handler () noexcept
+{
+	if (handler_installed) {
+		return true;
+	}
+
+	struct sigaction sa {};
+	sa.sa_sigaction = signal_handler;
+	sa.sa_flags = SA_SIGINFO | SA_RESTART;
+	sigemptyset (&sa.sa_mask);
+
+	if (sigaction (SIGPROF, &sa, nullptr) != 0) {
+		__android_log_print (PRIORITY, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), "Sampling profiler: failed to install the SIGPROF handler. %s", strerror (errno));
+		return false;
+	}
+
+	handler_installed = true;
+	return true;
+}
+
+// Runs on the interrupted thread: no allocations and no locks, the thread might be holding them
+void
+SamplingProfiler::signal_handler ([[maybe_unused]] int signo, [[maybe_unused]] siginfo_t *info, void *context) noexcept
+{
+	if (!sampling.load (std::memory_order_acquire)) [[unlikely]] {
+		return;
+	}
+
+	int saved_errno = errno;
+
+	ThreadSamples *thread = find_thread_samples (gettid ());
+	if (thread == nullptr) [[unlikely]] {
+		unassigned_samples.fetch_add (1, std::memory_order_relaxed);
+		errno = saved_errno;
+		return;
+	}
+
+	uint32_t head = thread->head.load (std::memory_order_relaxed);
+	if (head - thread->tail.load (std::memory_order_acquire) >= SAMPLES_PER_THREAD) {
+		thread->dropped.fetch_add (1, std::memory_order_relaxed);
+		errno = saved_errno;
+		return;
+	}
+
+	// Not `unw_backtrace2`: it takes the signal context for libunwind's context, which on 32-bit ARM it isn't laid out
+	// like.  `capture_signal_context` builds the libunwind context from the registers of the signal context there.
+	Sample &sample = thread->samples[head & (SAMPLES_PER_THREAD - 1)];
+	sample.frame_count = static_cast<uint32_t>(FrameCapture::capture_signal_context (sample.frames, MAX_FRAMES, context));
+	thread->head.store (head + 1, std::memory_order_release);
+
+	errno = saved_errno;
+}
+
+// Async-signal-safe, claims a free slot for the thread if it doesn't have one yet
+SamplingProfiler::ThreadSamples*
+SamplingProfiler::find_thread_samples (pid_t tid) noexcept
+{
+	for (size_t i = 0; i < MAX_THREADS; i++) {
+		if (threads[i].tid.load (std::memory_order_acquire) == tid) {
+			return &threads[i];
+		}
+	}
+
+	for (size_t i = 0; i < MAX_THREADS; i++) {
+		pid_t expected = 0;
+		if (threads[i].tid.compare_exchange_strong (expected, tid, std::memory_order_acq_rel)) {
+			return &threads[i];
+		}
+	}
+
+	return nullptr;
+}
+
+// Must be called on the thread to sample, with `lock` held
+bool
+SamplingProfiler::start_thread_timer (ThreadSamples &thread) noexcept
+{
+	sigevent event {};
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event._sigev_un._tid = gettid (); // Not every libc defines `sigev_notify_thread_id`
+
+	if (timer_create (CLOCK_THREAD_CPUTIME_ID, &event, &thread.timer) != 0) {
+		__android_log_print (PRIORITY, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), "Sampling profiler: failed to create the thread profiling timer. %s", strerror (errno));
+		return false;
+	}
+
+	itimerspec spec {};
+	spec.it_interval.tv_sec = static_cast<time_t>(interval_us / 1000000);
+	spec.it_interval.tv_nsec = static_cast<long>(interval_us % 1000000) * 1000;
+	spec.it_value = spec.it_interval;
+
+	if (timer_settime (thread.timer, 0, &spec, nullptr) != 0) {
+		__android_log_print (PRIORITY, SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (), "Sampling profiler: failed to start the thread profiling timer. %s", strerror (errno));
+		timer_delete (thread.timer);
+		return false;
+	}
+
+	thread.has_timer = true;
+	return true;
+}
+
+// Must be called with `lock` held
+void
+SamplingProfiler::stop_thread_timer (ThreadSamples &thread) noexcept
+{
+	if (!thread.has_timer) {
+		return;
+	}
+
+	timer_delete (thread.timer);
+	thread.has_timer = false;
+}
+
+void*
+SamplingProfiler::drain_thread ([[maybe_unused]] void *arg) noexcept
+{
+	timespec interval {
+		.tv_sec = 0,
+		.tv_nsec = static_cast<long>(DRAIN_INTERVAL_MS) * 1000000,
+	};
+
+	while (sampling.load (std::memory_order_acquire)) {
+		nanosleep (&interval, nullptr);
+		drain ();
+	}
+
+	return nullptr;
+}
+
+void
+SamplingProfiler::drain () noexcept
+{
+	std::lock_guard<std::mutex> guard (stacks_lock);
+	pid_t pid = getpid ();
+
+	for (size_t i = 0; i < MAX_THREADS; i++) {
+		ThreadSamples &thread = threads[i];
+		pid_t tid = thread.tid.load (std::memory_order_acquire);
+		if (tid <= 0) {
+			continue;
+		}
+
+		// Read while the thread is still alive
+		uint32_t thread_name_id = get_thread_name_id (tid);
+
+		uint32_t tail = thread.tail.load (std::memory_order_relaxed);
+		uint32_t head = thread.head.load (std::memory_order_acquire);
+
+		Stack stack { thread_name_id, {} };
+		for (; tail != head; tail++) {
+			Sample const& sample = thread.samples[tail & (SAMPLES_PER_THREAD - 1)];
+
+			stack.frames.clear ();
+			for (uint32_t f = 0; f < sample.frame_count; f++) {
+				stack.frames.push_back (sample.frames[f]);
+			}
+			stacks[stack]++;
+			total_samples++;
+		}
+		thread.tail.store (tail, std::memory_order_release);
+		dropped_samples += thread.dropped.exchange (0, std::memory_order_relaxed);
+
+		// Release the slots of the threads which exited, there are only so many of them
+		if (syscall (SYS_tgkill, pid, tid, 0) != 0 && errno == ESRCH) {
+			// Neither found by a new thread which reuses the id, nor claimed by another one, until it's reset
+			thread.tid.store (-1, std::memory_order_release);
+			{
+				std::lock_guard<std::mutex> timer_guard (lock);
+				stop_thread_timer (thread);
+			}
+
+			thread.head.store (0, std::memory_order_relaxed);
+			thread.tail.store (0, std::memory_order_relaxed);
+			thread.tid.store (0, std::memory_order_release);
+
+			// A new thread which gets the same id has a name of its own
+			thread_name_ids.erase (tid);
+		}
+	}
+}
+
+// Must be called with `stacks_lock` held.  The name is read the first time the thread is seen, so that it's known even
+// after the thread exits.  Threads with the same name share the id.
+uint32_t
+SamplingProfiler::get_thread_name_id (pid_t tid) noexcept
+{
+	auto iter = thread_name_ids.find (tid);
+	if (iter != thread_name_ids.end ()) {
+		return iter->second;
+	}
+
+	std::array<char, 64> path;
+	std::array<char, 32> name;
+	std::string thread_name;
+
+	snprintf (path.data (), path.size (), "/proc/self/task/%d/comm", tid);
+	FILE *comm = fopen (path.data (), "r");
+	if (comm != nullptr) {
+		if (fgets (name.data (), static_cast<int>(name.size ()), comm) != nullptr) {
+			thread_name.assign (name.data (), strcspn (name.data (), "\n"));
+		}
+		fclose (comm);
+	}
+
+	if (thread_name.empty ()) {
+		snprintf (name.data (), name.size (), "thread-%d", tid);
+		thread_name.assign (name.data ());
+	}
+
+	for (char &c : thread_name) {
+		if (c == ';' || c == ' ') {
+			c = '_';
+		}
+	}
+
+	auto [name_iter, added] = thread_name_ids_by_name.try_emplace (thread_name, static_cast<uint32_t>(thread_names.size ()));
+	if (added) {
+		thread_names.push_back (std::move (thread_name));
+	}
+
+	thread_name_ids.emplace (tid, name_iter->second);
+	return name_iter->second;
+}
+
+// Returns one line per distinct stack, the thread name and the frames starting with the outermost one separated with
+// semicolons, followed by a space and the number of samples.  This is the input format of `flamegraph.pl` and most
+// other flame graph tools.
+const char*
+SamplingProfiler::get_folded_stacks () noexcept
+{
+	{
+		std::lock_guard<std::mutex> guard (lock);
+		if (threads == nullptr) {
+			return nullptr;
+		}
+	}
+	drain ();
+
+	std::lock_guard<std::mutex> guard (stacks_lock);
+
+	// Different addresses within the same function fold into the same line.  Symbols are cached across calls, the
+	// sanitized frame names only for this one.
+	std::unordered_map<uintptr_t, std::string> frame_names;
+	std::unordered_map<std::string, uint64_t> lines;
+	std::string line;
+
+	for (auto const& [stack, count] : stacks) {
+		line.assign (thread_names[stack.thread_name_id]);
+
+		for (size_t i = stack.frames.size (); i > 0; i--) {
+			// All but the innermost frame are return addresses, pointing past the call instruction
+			uintptr_t address = i == 1 ? stack.frames[0] : static_cast<uintptr_t>(adjust_address (stack.frames[i - 1]));
+
+			auto iter = frame_names.find (address);
+			if (iter == frame_names.end ()) {
+				std::string frame_name;
+				append_folded_frame (frame_name, address);
+				iter = frame_names.emplace (address, std::move (frame_name)).first;
+			}
+			line.append (iter->second);
+		}
+
+		lines[line] += count;
+	}
+
+	std::string folded;
+	std::array<char, 32> num_buf;
+	for (auto const& [folded_line, count] : lines) {
+		folded.append (folded_line);
+		snprintf (num_buf.data (), num_buf.size (), " %" PRIu64 "\n", count);
+		folded.append (num_buf.data ());
+	}
+
+	__android_log_print (
+		PRIORITY,
+		SharedConstants::LOG_CATEGORY_NAME_MONODROID.data (),
+		"Sampling profiler: %" PRIu64 " samples in %zu distinct stacks, %" PRIu64 " dropped (%" PRIu64 " from threads over the limit of %zu)",
+		total_samples,
+		lines.size (),
+		dropped_samples + unassigned_samples.load (std::memory_order_relaxed),
+		unassigned_samples.load (std::memory_order_relaxed),
+		MAX_THREADS
+	);
+
+	return strdup (folded.c_str ());
+}
+
+bool xa_start_sampling_profiler (uint32_t interval_us, bool all_threads) noexcept
+{
+	return SamplingProfiler::start (interval_us, all_threads);
+}
+
+bool xa_sample_current_thread () noexcept
+{
+	return SamplingProfiler::add_current_thread ();
+}
+
+void xa_stop_sampling_profiler () noexcept
+{
+	SamplingProfiler::stop ();
+}
+
+const char* xa_get_sampled_stacks () noexcept
+{
+	return SamplingProfiler::get_folded_stacks ();
+}
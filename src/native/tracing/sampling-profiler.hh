@@ -0,0 +1,133 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#if !defined (__SAMPLING_PROFILER_HH)
+#define __SAMPLING_PROFILER_HH
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "cppcompat.hh"
+
+namespace xamarin::android::internal
+{
+	// Statistical CPU profiler driven by SIGPROF.  The signal handler runs on the interrupted thread, unwinds its stack
+	// (see FrameCapture) and stores the raw addresses in the thread's sample ring.  Nothing is symbolized in the handler:
+	// a background thread drains the rings every DRAIN_INTERVAL_MS and counts the identical stacks, the addresses are
+	// turned into function names only when the folded stacks are requested.
+	//
+	// With `all_threads`, the process CPU time timer (ITIMER_PROF) is used and the kernel signals whichever thread is
+	// running when it expires, so that every thread is sampled in proportion to the CPU time it uses.  Otherwise only the
+	// threads which call `add_current_thread` (including the one which started the profiler) are sampled, each with its
+	// own thread CPU time timer.
+	class SamplingProfiler
+	{
+		static constexpr size_t   MAX_THREADS = 64;
+		static constexpr size_t   MAX_FRAMES = 48;
+		static constexpr uint32_t SAMPLES_PER_THREAD = 256; // Must be a power of 2
+		static constexpr uint32_t DRAIN_INTERVAL_MS = 100;
+		static constexpr char     DRAIN_THREAD_NAME[] = "XA profiler";
+
+		static_assert ((SAMPLES_PER_THREAD & (SAMPLES_PER_THREAD - 1)) == 0, "SAMPLES_PER_THREAD must be a power of 2");
+
+		struct Sample
+		{
+			uint32_t  frame_count;
+			uintptr_t frames[MAX_FRAMES];
+		};
+
+		// The signal handler (running on the thread which owns the slot) is the only writer of `head` and the samples,
+		// the drain thread is the only writer of `tail`.  A slot is claimed by storing the thread id in `tid`, and
+		// released by the drain thread once the thread no longer exists.
+		//
+		// `samples` is left uninitialized and comes last, so that constructing a slot touches only its first page: the
+		// sample pages are committed by the first signal which writes to them.
+		struct ThreadSamples
+		{
+			std::atomic<pid_t>                     tid { 0 };
+			std::atomic<uint32_t>                  head { 0 };
+			std::atomic<uint32_t>                  tail { 0 };
+			std::atomic<uint32_t>                  dropped { 0 };
+
+			// Protected by `lock`
+			timer_t                                timer {};
+			bool                                   has_timer = false;
+
+			std::array<Sample, SAMPLES_PER_THREAD> samples;
+		};
+
+		// Stacks are counted per thread name (as they're folded), not per thread id: ids are reused once the threads exit
+		struct Stack
+		{
+			uint32_t               thread_name_id;
+			std::vector<uintptr_t> frames;
+
+			bool operator== (Stack const& other) const noexcept
+			{
+				return thread_name_id == other.thread_name_id && frames == other.frames;
+			}
+		};
+
+		struct StackHash
+		{
+			size_t operator() (Stack const& stack) const noexcept
+			{
+				size_t hash = std::hash<uint32_t>{} (stack.thread_name_id);
+				for (uintptr_t frame : stack.frames) {
+					hash = (hash * 31) ^ std::hash<uintptr_t>{} (frame);
+				}
+				return hash;
+			}
+		};
+
+	public:
+		static bool start (uint32_t interval_us, bool all_threads) noexcept;
+		static bool add_current_thread () noexcept;
+		static void stop () noexcept;
+		static const char* get_folded_stacks () noexcept;
+
+	private:
+		static bool install_signal_handler () noexcept;
+		static void signal_handler (int signo, siginfo_t *info, void *context) noexcept;
+		static ThreadSamples* find_thread_samples (pid_t tid) noexcept;
+		static bool start_thread_timer (ThreadSamples &thread) noexcept;
+		static void stop_thread_timer (ThreadSamples &thread) noexcept;
+		static void* drain_thread (void *arg) noexcept;
+		static void drain () noexcept;
+		static uint32_t get_thread_name_id (pid_t tid) noexcept;
+
+	private:
+		// Set once, never freed: the signal handler may run on any thread at any time
+		static inline ThreadSamples        *threads = nullptr;
+		static inline std::atomic<bool>     sampling { false };
+		static inline std::atomic<uint64_t> unassigned_samples { 0 };
+
+		// All below protected by `lock`
+		static inline std::mutex  lock;
+		static inline bool        handler_installed = false;
+		static inline bool        running = false;
+		static inline bool        sample_all_threads = false;
+		static inline uint32_t    interval_us = 0;
+		static inline pthread_t   drainer;
+		static inline bool        have_drainer = false;
+
+		// All below protected by `stacks_lock`
+		static inline std::mutex                                    stacks_lock;
+		static inline std::unordered_map<Stack, uint64_t, StackHash> stacks;
+		static inline std::unordered_map<pid_t, uint32_t>           thread_name_ids;      // of the sampled threads, by thread id
+		static inline std::unordered_map<std::string, uint32_t>     thread_name_ids_by_name;
+		static inline std::vector<std::string>                      thread_names;         // indexed by name id
+		static inline uint64_t                                      total_samples = 0;
+		static inline uint64_t                                      dropped_samples = 0;
+	};
+}
+#endif // ndef __SAMPLING_PROFILER_HH
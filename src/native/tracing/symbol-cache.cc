@@ -0,0 +1,97 @@
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dlfcn.h>
+#include <cxxabi.h>
+
+#include "native-tracing.hh"
+#include "symbol-cache.hh"
+
+using namespace xamarin::android::internal;
+
+SymbolCache::Symbol const&
+SymbolCache::lookup (uintptr_t address) noexcept
+{
+	{
+		std::lock_guard<std::mutex> guard (lock);
+		auto iter = symbols.find (address);
+		if (iter != symbols.end ()) {
+			return iter->second;
+		}
+	}
+
+	// Symbolized without holding the lock, it may take a while.  Should another thread get there first, its result is
+	// kept.
+	Symbol symbol = symbolize (address);
+
+	std::lock_guard<std::mutex> guard (lock);
+	return symbols.emplace (address, std::move (symbol)).first->second;
+}
+
+SymbolCache::Symbol
+SymbolCache::symbolize (uintptr_t address) noexcept
+{
+	Symbol                 symbol { {}, 0, {}, 0, 0 };
+	std::array<char, 512>  name_buf;
+	unw_word_t             offp = 0;
+	Dl_info                info;
+	const char            *symbol_name = nullptr;
+
+	bool info_valid = dladdr (reinterpret_cast<void*>(address), &info) != 0;
+	if (info_valid) {
+		if (info.dli_fname != nullptr) {
+			symbol.library.assign (info.dli_fname);
+		}
+		symbol.library_base = reinterpret_cast<uintptr_t>(info.dli_fbase);
+		symbol.symbol_address = reinterpret_cast<uintptr_t>(info.dli_saddr);
+	}
+
+	// libunwind also finds the symbols which aren't exported, if the library's symbol table wasn't stripped
+	if (unw_get_proc_name_by_ip (unw_local_addr_space, address, name_buf.data (), name_buf.size (), &offp, nullptr) == 0) {
+		symbol_name = name_buf.data ();
+	} else if (info_valid && info.dli_sname != nullptr) {
+		symbol_name = info.dli_sname;
+		offp = address - symbol.symbol_address;
+	}
+
+	if (symbol_name != nullptr) {
+		int demangle_status;
+
+		// https://itanium-cxx-abi.github.io/cxx-abi/abi.html#demangler
+		char *demangled_symbol_name = abi::__cxa_demangle (symbol_name, nullptr, nullptr, &demangle_status);
+		if (demangle_status == 0 && demangled_symbol_name != nullptr) {
+			symbol.name.assign (demangled_symbol_name);
+			std::free (demangled_symbol_name);
+		} else {
+			symbol.name.assign (symbol_name);
+		}
+		symbol.name_offset = offp;
+	}
+
+	return symbol;
+}
+
+void
+SymbolCache::append_name (std::string &out, uintptr_t address) noexcept
+{
+	Symbol const& symbol = lookup (address);
+
+	if (!symbol.name.empty ()) {
+		out.append (symbol.name);
+		return;
+	}
+
+	if (symbol.library.empty ()) {
+		out.append ("[anonymous]");
+		return;
+	}
+
+	size_t slash = symbol.library.rfind ('/');
+	out.append (slash == std::string::npos ? symbol.library : symbol.library.substr (slash + 1));
+
+	std::array<char, 32> num_buf;
+	std::snprintf (num_buf.data (), num_buf.size (), "+0x%zx", address - symbol.library_base);
+	out.append (num_buf.data ());
+}
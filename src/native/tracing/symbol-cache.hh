@@ -0,0 +1,48 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#if !defined (__SYMBOL_CACHE_HH)
+#define __SYMBOL_CACHE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "cppcompat.hh"
+
+namespace xamarin::android::internal
+{
+	// Symbolizes code addresses, remembering the result for each address.  Looking up a symbol (with `dladdr`, libunwind
+	// which may have to read the symbol table of the library from disk and the C++ demangler) costs much more than
+	// unwinding the stack, while the same few addresses appear in most of the stacks captured by a process.
+	//
+	// Entries are never removed, so the address of a library which is unloaded and replaced by another one at the same
+	// address resolves to the old name.  Libraries are practically never unloaded on Android.
+	class SymbolCache
+	{
+	public:
+		struct Symbol
+		{
+			std::string library;       // Full path, empty if the address isn't in any loaded library
+			uintptr_t   library_base;
+			std::string name;          // Demangled, empty if not known
+			uintptr_t   name_offset;   // Offset of the address from the start of `name`
+			uintptr_t   symbol_address;
+		};
+
+	public:
+		// The returned reference remains valid for the lifetime of the process
+		static Symbol const& lookup (uintptr_t address) noexcept;
+
+		// Appends the function name or, if it isn't known, the library name and the offset into it
+		static void append_name (std::string &out, uintptr_t address) noexcept;
+
+	private:
+		static Symbol symbolize (uintptr_t address) noexcept;
+
+	private:
+		// Nodes of the map are never moved, the references returned by `lookup` don't need the lock
+		static inline std::mutex                              lock;
+		static inline std::unordered_map<uintptr_t, Symbol>   symbols;
+	};
+}
+#endif // ndef __SYMBOL_CACHE_HH
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <functional>
+
+#include "trace-store.hh"
+
+using namespace xamarin::android::internal;
+
+uint32_t
+TraceStore::add (uintptr_t const* frames, size_t frame_count) noexcept
+{
+	size_t trace_hash = hash (frames, frame_count);
+
+	std::lock_guard<std::mutex> guard (lock);
+
+	auto range = ids_by_hash.equal_range (trace_hash);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		std::vector<uintptr_t> const& trace = traces[iter->second - 1];
+		if (trace.size () == frame_count && std::equal (trace.begin (), trace.end (), frames)) {
+			return iter->second;
+		}
+	}
+
+	if (traces.size () >= MAX_TRACES) {
+		return 0;
+	}
+
+	traces.emplace_back (frames, frames + frame_count);
+
+	auto id = static_cast<uint32_t>(traces.size ());
+	ids_by_hash.emplace (trace_hash, id);
+	return id;
+}
+
+std::vector<uintptr_t> const*
+TraceStore::find (uint32_t id) noexcept
+{
+	std::lock_guard<std::mutex> guard (lock);
+
+	if (id == 0 || id > traces.size ()) {
+		return nullptr;
+	}
+
+	return &traces[id - 1];
+}
+
+size_t
+TraceStore::hash (uintptr_t const* frames, size_t frame_count) noexcept
+{
+	size_t trace_hash = frame_count;
+	for (size_t i = 0; i < frame_count; i++) {
+		trace_hash = (trace_hash * 31) ^ std::hash<uintptr_t>{} (frames[i]);
+	}
+	return trace_hash;
+}
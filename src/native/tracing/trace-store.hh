@@ -0,0 +1,42 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#if !defined (__TRACE_STORE_HH)
+#define __TRACE_STORE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "cppcompat.hh"
+
+namespace xamarin::android::internal
+{
+	// Keeps the raw (unsymbolized) native stacks captured with `xa_capture_native_trace`, so that they can be symbolized
+	// only if and when they're needed.  Identical stacks are stored once and get the same id, so capturing a stack at
+	// a call site which is hit over and over again (e.g. whenever a global reference is created) costs only the
+	// unwinding and a hash table lookup.  Ids start at 1, 0 means "no trace".
+	class TraceStore
+	{
+	public:
+		static constexpr size_t MAX_FRAMES = 128;
+		static constexpr size_t MAX_TRACES = 65536;
+
+	public:
+		static uint32_t add (uintptr_t const* frames, size_t frame_count) noexcept;
+
+		// The returned pointer remains valid for the lifetime of the process, `nullptr` if there's no such trace
+		static std::vector<uintptr_t> const* find (uint32_t id) noexcept;
+
+	private:
+		static size_t hash (uintptr_t const* frames, size_t frame_count) noexcept;
+
+	private:
+		// All below protected by `lock`.  Elements of the deque are never moved, the pointers returned by `find` don't
+		// need the lock.
+		static inline std::mutex                                lock;
+		static inline std::deque<std::vector<uintptr_t>>        traces;
+		static inline std::unordered_multimap<size_t, uint32_t> ids_by_hash;
+	};
+}
+#endif // ndef __TRACE_STORE_HH
@@ -0,0 +1,201 @@
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+
+#include "bridge-graph.hh"
+#include "fake-mono.hh"
+#include "globals.hh"
+
+using namespace xamarin::android::bench;
+
+namespace {
+	struct ShapeName
+	{
+		GraphShape        shape;
+		std::string_view  name;
+	};
+
+	constexpr ShapeName shape_names[] = {
+		{ GraphShape::Chain, "chain" },
+		{ GraphShape::Star, "star" },
+		{ GraphShape::Scc, "scc" },
+	};
+}
+
+std::optional<GraphShape>
+xamarin::android::bench::parse_graph_shape (std::string_view const& name) noexcept
+{
+	for (auto const& entry : shape_names) {
+		if (entry.name == name) {
+			return entry.shape;
+		}
+	}
+
+	return std::nullopt;
+}
+
+const char*
+xamarin::android::bench::graph_shape_name (GraphShape shape) noexcept
+{
+	for (auto const& entry : shape_names) {
+		if (entry.shape == shape) {
+			return entry.name.data ();
+		}
+	}
+
+	return "unknown";
+}
+
+BridgeGraph::BridgeGraph (FakeJvm &vm, std::vector<PeerType> const& peer_types, GraphShape shape, size_t object_count, unsigned alive_percent, uint32_t seed)
+	: jvm (vm)
+{
+	switch (shape) {
+		case GraphShape::Chain:
+			for (size_t i = 0; i < object_count; i++) {
+				sccs.push_back (new_scc (peer_types, 1));
+				if (i > 0) {
+					xrefs.push_back ({ static_cast<int>(i - 1), static_cast<int>(i) });
+				}
+			}
+			break;
+
+		case GraphShape::Star:
+			sccs.push_back (new_scc (peer_types, 0));
+			for (size_t i = 1; i <= object_count; i++) {
+				sccs.push_back (new_scc (peer_types, 1));
+				xrefs.push_back ({ 0, static_cast<int>(i) });
+			}
+			break;
+
+		case GraphShape::Scc:
+			sccs.push_back (new_scc (peer_types, object_count));
+			break;
+	}
+
+	// Keeping the first object of an SCC alive is enough, the bridge links all of its objects together
+	std::mt19937 random (seed);
+	std::uniform_int_distribution<unsigned> percent (0, 99);
+	std::vector<bool> rooted (sccs.size ());
+
+	for (size_t i = 0; i < sccs.size (); i++) {
+		if (sccs[i]->num_objs == 0 || percent (random) >= alive_percent) {
+			continue;
+		}
+
+		rooted[i] = true;
+		jvm.resolve (sccs[i]->objs[0]->handle)->rooted = true;
+	}
+
+	compute_expected (rooted);
+}
+
+BridgeGraph::~BridgeGraph ()
+{
+	for (MonoGCBridgeSCC *scc : sccs) {
+		for (int i = 0; i < scc->num_objs; i++) {
+			MonoObject *obj = scc->objs[i];
+
+			// Handles of the collected peers are cleared by the bridge, the others are global references again
+			if (obj->handle != nullptr) {
+				jvm.resolve (obj->handle)->rooted = false;
+				osBridge._monodroid_gref_log_delete (obj->handle, 'G', "bench", 0, "BridgeGraph::~BridgeGraph", 0);
+				jvm.delete_global_ref (obj->handle);
+			}
+			FakeMono::free_object (obj);
+		}
+		free (scc);
+	}
+
+	jvm.collect ();
+}
+
+MonoGCBridgeSCC*
+BridgeGraph::new_scc (std::vector<PeerType> const& peer_types, size_t count)
+{
+	auto scc = static_cast<MonoGCBridgeSCC*>(malloc (offsetof (MonoGCBridgeSCC, objs) + count * sizeof (MonoObject*)));
+	if (scc == nullptr) {
+		abort ();
+	}
+
+	scc->is_alive = 0;
+	scc->num_objs = static_cast<int>(count);
+	for (size_t i = 0; i < count; i++) {
+		PeerType const& type = peer_types [next_peer_type++ % peer_types.size ()];
+		jobject handle = jvm.new_global_ref (jvm.new_object (type.java_class));
+
+		// Like the managed peers do, so that the gref logging and attribution see the peers from the start.  The managed
+		// code passes its stack trace only when `gref` logging is enabled.
+		const char *from = (log_categories & LOG_GREF) != 0 ? "BridgeGraph::new_scc" : nullptr;
+		osBridge._monodroid_gref_log_new (nullptr, '*', handle, 'G', "bench", 0, from, 0);
+		scc->objs[i] = FakeMono::new_object (type.mono_class, handle);
+	}
+	objects += count;
+
+	return scc;
+}
+
+void
+BridgeGraph::compute_expected (std::vector<bool> const& rooted)
+{
+	std::vector<std::vector<int>> successors (sccs.size ());
+	for (MonoGCBridgeXRef const& xref : xrefs) {
+		successors [static_cast<size_t>(xref.src_scc_index)].push_back (xref.dst_scc_index);
+	}
+
+	expected_alive.assign (sccs.size (), false);
+
+	std::vector<size_t> pending;
+	for (size_t i = 0; i < sccs.size (); i++) {
+		if (rooted[i]) {
+			expected_alive[i] = true;
+			pending.push_back (i);
+		}
+	}
+
+	while (!pending.empty ()) {
+		size_t index = pending.back ();
+		pending.pop_back ();
+
+		for (int dst : successors [index]) {
+			if (!expected_alive [static_cast<size_t>(dst)]) {
+				expected_alive [static_cast<size_t>(dst)] = true;
+				pending.push_back (static_cast<size_t>(dst));
+			}
+		}
+	}
+
+	alive_objects = 0;
+	for (size_t i = 0; i < sccs.size (); i++) {
+		if (expected_alive[i]) {
+			alive_objects += static_cast<size_t>(sccs[i]->num_objs);
+		}
+	}
+}
+
+size_t
+BridgeGraph::verify (bool java_gc_ran) const
+{
+	size_t mismatches = 0;
+
+	for (size_t i = 0; i < sccs.size (); i++) {
+		MonoGCBridgeSCC *scc = sccs[i];
+
+		// The bridge doesn't report on SCCs without bridge objects
+		if (scc->num_objs == 0) {
+			continue;
+		}
+
+		bool alive = !java_gc_ran || expected_alive[i];
+		bool ok = (scc->is_alive != 0) == alive;
+		for (int j = 0; ok && j < scc->num_objs; j++) {
+			MonoObject *obj = scc->objs[j];
+			ok = (obj->handle != nullptr) == alive && (obj->handle == nullptr || obj->handle_type == JNIGlobalRefType);
+		}
+
+		if (!ok) {
+			mismatches++;
+		}
+	}
+
+	return mismatches;
+}
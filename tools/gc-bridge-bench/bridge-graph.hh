@@ -0,0 +1,95 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_BRIDGE_GRAPH_HH
+#define __GC_BRIDGE_BENCH_BRIDGE_GRAPH_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <mono/metadata/sgen-bridge.h>
+
+#include "fake-jni.hh"
+
+namespace xamarin::android::bench
+{
+	enum class GraphShape
+	{
+		Chain, // one object per SCC, each SCC references the next one
+		Star,  // a hub SCC without bridge objects (so it gets a temporary peer) referencing one object SCCs
+		Scc,   // a single SCC containing all the objects
+	};
+
+	std::optional<GraphShape> parse_graph_shape (std::string_view const& name) noexcept;
+	const char* graph_shape_name (GraphShape shape) noexcept;
+
+	// Managed class of a bridge object and the Java class of its peer
+	struct PeerType
+	{
+		MonoClass  *mono_class;
+		JavaClass  *java_class;
+	};
+
+	// The input of a single `cross_references` bridge callback, in the form SGen passes it, together with the Java
+	// peers of all the bridge objects.  `alive_percent` of the SCCs (picked at random) are kept alive on the Java side,
+	// an SCC is then expected to survive the pass if it is alive or reachable from an alive one through the
+	// cross references.
+	class BridgeGraph
+	{
+	public:
+		BridgeGraph (FakeJvm &jvm, std::vector<PeerType> const& peer_types, GraphShape shape, size_t object_count, unsigned alive_percent, uint32_t seed);
+		~BridgeGraph ();
+
+		BridgeGraph (BridgeGraph const&) = delete;
+		BridgeGraph& operator= (BridgeGraph const&) = delete;
+
+		int num_sccs () const noexcept
+		{
+			return static_cast<int>(sccs.size ());
+		}
+
+		MonoGCBridgeSCC** get_sccs () noexcept
+		{
+			return sccs.data ();
+		}
+
+		int num_xrefs () const noexcept
+		{
+			return static_cast<int>(xrefs.size ());
+		}
+
+		MonoGCBridgeXRef* get_xrefs () noexcept
+		{
+			return xrefs.data ();
+		}
+
+		size_t object_count () const noexcept
+		{
+			return objects;
+		}
+
+		size_t expected_alive_objects () const noexcept
+		{
+			return alive_objects;
+		}
+
+		// Number of SCCs whose fate (the `is_alive` flag and the peer handles) isn't what the Java side says it should
+		// be.  Everything survives a pass which skipped the Java GC.
+		size_t verify (bool java_gc_ran) const;
+
+	private:
+		MonoGCBridgeSCC* new_scc (std::vector<PeerType> const& peer_types, size_t count);
+		void compute_expected (std::vector<bool> const& rooted);
+
+	private:
+		FakeJvm                        &jvm;
+		std::vector<MonoGCBridgeSCC*>   sccs;
+		std::vector<MonoGCBridgeXRef>   xrefs;
+		std::vector<bool>               expected_alive;
+		size_t                          objects = 0;
+		size_t                          alive_objects = 0;
+		size_t                          next_peer_type = 0;
+	};
+}
+#endif // ndef __GC_BRIDGE_BENCH_BRIDGE_GRAPH_HH
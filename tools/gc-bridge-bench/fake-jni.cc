@@ -0,0 +1,1342 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <utility>
+
+#include "fake-jni.hh"
+
+using namespace xamarin::android::bench;
+
+namespace {
+	uint64_t
+	now_ns () noexcept
+	{
+		timespec ts;
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+		return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+	}
+
+	constexpr const char* jni_function_names[] = {
+		"GetEnv",
+		"FindClass",
+		"GetMethodID",
+		"GetStaticMethodID",
+		"GetStaticFieldID",
+		"GetStaticObjectField",
+		"GetObjectClass",
+		"IsSameObject",
+		"GetObjectRefType",
+		"NewLocalRef",
+		"DeleteLocalRef",
+		"NewGlobalRef",
+		"DeleteGlobalRef",
+		"NewWeakGlobalRef",
+		"DeleteWeakGlobalRef",
+		"NewObject",
+		"CallObjectMethod",
+		"CallIntMethod",
+		"CallVoidMethod",
+		"CallStaticObjectMethod",
+		"CallStaticVoidMethod",
+		"NewObjectArray",
+		"GetObjectArrayElement",
+		"SetObjectArrayElement",
+		"GetArrayLength",
+		"NewIntArray",
+		"GetIntArrayRegion",
+		"SetIntArrayRegion",
+		"NewBooleanArray",
+		"GetBooleanArrayRegion",
+		"SetBooleanArrayRegion",
+		"NewStringUTF",
+		"GetStringUTFChars",
+		"ReleaseStringUTFChars",
+		"ExceptionCheck",
+		"ExceptionOccurred",
+		"ExceptionDescribe",
+		"ExceptionClear",
+	};
+	static_assert (std::size (jni_function_names) == static_cast<size_t>(JniFunction::Count));
+
+	// JNI allows only these to be called with an exception pending (well, a few more, but these are the ones
+	// we implement)
+	bool
+	allowed_with_pending_exception (JniFunction fn) noexcept
+	{
+		switch (fn) {
+			case JniFunction::GetEnv:
+			case JniFunction::DeleteLocalRef:
+			case JniFunction::DeleteGlobalRef:
+			case JniFunction::DeleteWeakGlobalRef:
+			case JniFunction::ReleaseStringUTFChars:
+			case JniFunction::ExceptionCheck:
+			case JniFunction::ExceptionOccurred:
+			case JniFunction::ExceptionDescribe:
+			case JniFunction::ExceptionClear:
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	using TrapFunction = void (*) ();
+
+	// Every function table entry starts out pointing to one of these, so that a call to a function we don't
+	// implement can be reported with its index in the JNI function table
+	template<size_t Index>
+	void
+	unimplemented_function ()
+	{
+		fprintf (stderr, "FATAL: JNI function table entry #%zu is not implemented by the benchmark\n", Index);
+		abort ();
+	}
+
+	template<size_t... Index>
+	std::array<TrapFunction, sizeof...(Index)>
+	make_traps (std::index_sequence<Index...>)
+	{
+		return { &unimplemented_function<Index>... };
+	}
+}
+
+const char*
+xamarin::android::bench::jni_function_name (JniFunction fn) noexcept
+{
+	return jni_function_names [static_cast<size_t>(fn)];
+}
+
+FakeJvm::CallScope::CallScope (JniFunction fn) noexcept
+	: function (fn),
+	  phase (current->phase),
+	  start_ns (0)
+{
+	FakeJvm &jvm = *current;
+
+	if (jvm.pending_exception != nullptr && !allowed_with_pending_exception (fn)) {
+		fatal ("JNI %s called with an exception pending (%s)", jni_function_name (fn), jvm.pending_exception_message.c_str ());
+	}
+
+	jvm.stats.calls [static_cast<size_t>(phase)][static_cast<size_t>(fn)]++;
+	if (!jvm.time_calls && jvm.call_cost_ns == 0) [[likely]] {
+		return;
+	}
+
+	start_ns = now_ns ();
+	while (jvm.call_cost_ns != 0 && now_ns () - start_ns < jvm.call_cost_ns) {
+	}
+}
+
+FakeJvm::CallScope::~CallScope () noexcept
+{
+	FakeJvm &jvm = *current;
+
+	if (jvm.time_calls) {
+		jvm.stats.ns [static_cast<size_t>(phase)][static_cast<size_t>(function)] += now_ns () - start_ns;
+	}
+}
+
+FakeJvm::FakeJvm ()
+{
+	if (current != nullptr) {
+		fatal ("Only one instance of the fake JVM may exist at a time");
+	}
+	current = this;
+
+	fill_tables ();
+
+	JavaClass *class_class = define_class ("java/lang/Class", nullptr);
+	JavaClass *object_class = define_class ("java/lang/Object", nullptr);
+	class_class->super = object_class;
+	add_method (object_class, "<init>", "()V", false, JavaMethodKind::Nop);
+	add_method (class_class, "getName", "()Ljava/lang/String;", false, JavaMethodKind::ClassGetName);
+	add_method (object_class, "hashCode", "()I", false, JavaMethodKind::ObjectHashCode);
+
+	define_class ("java/lang/String", object_class);
+	define_class ("[Ljava/lang/Object;", object_class);
+	define_class ("[I", object_class);
+	define_class ("[Z", object_class);
+
+	JavaClass *throwable_class = define_class ("java/lang/Throwable", object_class);
+	define_class ("java/lang/NoClassDefFoundError", throwable_class);
+	define_class ("java/lang/NoSuchFieldError", throwable_class);
+	define_class ("java/lang/NoSuchMethodError", throwable_class);
+	define_class ("java/lang/NullPointerException", throwable_class);
+
+	JavaClass *runtime_class = define_class ("java/lang/Runtime", object_class);
+	add_method (runtime_class, "getRuntime", "()Ljava/lang/Runtime;", true, JavaMethodKind::RuntimeGetRuntime);
+	add_method (runtime_class, "gc", "()V", false, JavaMethodKind::RuntimeGc);
+	runtime_instance = new_object (runtime_class);
+	runtime_instance->rooted = true;
+
+	JavaClass *weakref_class = define_class ("java/lang/ref/WeakReference", object_class);
+	add_method (weakref_class, "<init>", "(Ljava/lang/Object;)V", false, JavaMethodKind::WeakReferenceCtor);
+	add_method (weakref_class, "get", "()Ljava/lang/Object;", false, JavaMethodKind::WeakReferenceGet);
+
+	// See src/java-runtime/java/mono/android/
+	JavaClass *gc_user_peer_class = define_peer_class ("mono/android/GCUserPeer");
+	add_method (gc_user_peer_class, "<init>", "()V", false, JavaMethodKind::Nop);
+
+	JavaClass *gc_bridge_class = define_class ("mono/android/GCBridge", object_class);
+	add_method (gc_bridge_class, "addReferences", "([Ljava/lang/Object;I[II[Z)V", true, JavaMethodKind::GCBridgeAddReferences);
+	add_method (gc_bridge_class, "clearReferences", "([Ljava/lang/Object;)V", true, JavaMethodKind::GCBridgeClearReferences);
+
+	JavaClass *mono_runtime_class = define_class ("mono/android/Runtime", object_class);
+	add_static_field (mono_runtime_class, "mono_android_GCUserPeer", "Ljava/lang/Class;", gc_user_peer_class);
+	add_static_field (mono_runtime_class, "mono_android_GCBridge", "Ljava/lang/Class;", gc_bridge_class);
+}
+
+FakeJvm::~FakeJvm ()
+{
+	for (JavaObject *obj : heap) {
+		delete obj;
+	}
+	current = nullptr;
+}
+
+void
+FakeJvm::fill_tables ()
+{
+	static const auto traps = make_traps (std::make_index_sequence<MAX_FUNCTION_TABLE_SIZE> ());
+
+	static_assert (sizeof (EnvFunctions) % sizeof (TrapFunction) == 0 && sizeof (EnvFunctions) / sizeof (TrapFunction) <= MAX_FUNCTION_TABLE_SIZE);
+	static_assert (sizeof (VMFunctions) % sizeof (TrapFunction) == 0 && sizeof (VMFunctions) / sizeof (TrapFunction) <= MAX_FUNCTION_TABLE_SIZE);
+
+	auto env_slots = reinterpret_cast<TrapFunction*>(&env_functions);
+	for (size_t i = 0; i < sizeof (EnvFunctions) / sizeof (TrapFunction); i++) {
+		env_slots [i] = traps [i];
+	}
+
+	auto vm_slots = reinterpret_cast<TrapFunction*>(&vm_functions);
+	for (size_t i = 0; i < sizeof (VMFunctions) / sizeof (TrapFunction); i++) {
+		vm_slots [i] = traps [i];
+	}
+
+	vm_functions.GetEnv = GetEnv;
+
+	env_functions.FindClass = FindClass;
+	env_functions.GetMethodID = GetMethodID;
+	env_functions.GetStaticMethodID = GetStaticMethodID;
+	env_functions.GetStaticFieldID = GetStaticFieldID;
+	env_functions.GetStaticObjectField = GetStaticObjectField;
+	env_functions.GetObjectClass = GetObjectClass;
+	env_functions.IsSameObject = IsSameObject;
+	env_functions.GetObjectRefType = GetObjectRefType;
+	env_functions.NewLocalRef = NewLocalRef;
+	env_functions.DeleteLocalRef = DeleteLocalRef;
+	env_functions.NewGlobalRef = NewGlobalRef;
+	env_functions.DeleteGlobalRef = DeleteGlobalRef;
+	env_functions.NewWeakGlobalRef = NewWeakGlobalRef;
+	env_functions.DeleteWeakGlobalRef = DeleteWeakGlobalRef;
+	env_functions.NewObjectV = NewObjectV;
+	env_functions.NewObjectA = NewObjectA;
+	env_functions.CallObjectMethodV = CallObjectMethodV;
+	env_functions.CallObjectMethodA = CallObjectMethodA;
+	env_functions.CallIntMethodV = CallIntMethodV;
+	env_functions.CallIntMethodA = CallIntMethodA;
+	env_functions.CallVoidMethodV = CallVoidMethodV;
+	env_functions.CallVoidMethodA = CallVoidMethodA;
+	env_functions.CallStaticObjectMethodV = CallStaticObjectMethodV;
+	env_functions.CallStaticObjectMethodA = CallStaticObjectMethodA;
+	env_functions.CallStaticVoidMethodV = CallStaticVoidMethodV;
+	env_functions.CallStaticVoidMethodA = CallStaticVoidMethodA;
+	env_functions.NewObjectArray = NewObjectArray;
+	env_functions.GetObjectArrayElement = GetObjectArrayElement;
+	env_functions.SetObjectArrayElement = SetObjectArrayElement;
+	env_functions.GetArrayLength = GetArrayLength;
+	env_functions.NewIntArray = NewIntArray;
+	env_functions.GetIntArrayRegion = GetIntArrayRegion;
+	env_functions.SetIntArrayRegion = SetIntArrayRegion;
+	env_functions.NewBooleanArray = NewBooleanArray;
+	env_functions.GetBooleanArrayRegion = GetBooleanArrayRegion;
+	env_functions.SetBooleanArrayRegion = SetBooleanArrayRegion;
+	env_functions.NewStringUTF = NewStringUTF;
+	env_functions.GetStringUTFChars = GetStringUTFChars;
+	env_functions.ReleaseStringUTFChars = ReleaseStringUTFChars;
+	env_functions.ExceptionCheck = ExceptionCheck;
+	env_functions.ExceptionOccurred = ExceptionOccurred;
+	env_functions.ExceptionDescribe = ExceptionDescribe;
+	env_functions.ExceptionClear = ExceptionClear;
+
+	jni_env.functions = &env_functions;
+	java_vm.functions = &vm_functions;
+}
+
+void
+FakeJvm::fatal (const char *format, ...)
+{
+	va_list args;
+
+	va_start (args, format);
+	fputs ("FATAL: ", stderr);
+	vfprintf (stderr, format, args);
+	fputc ('\n', stderr);
+	va_end (args);
+
+	abort ();
+}
+
+void
+FakeJvm::reset_call_stats () noexcept
+{
+	stats = {};
+}
+
+JavaClass*
+FakeJvm::define_class (std::string const& name, JavaClass *super, bool is_gc_user_peer)
+{
+	JavaClass *class_class = find_class ("java/lang/Class");
+	classes.push_back (std::make_unique<JavaClass> (class_class, name, super));
+
+	JavaClass *klass = classes.back ().get ();
+	if (klass->klass == nullptr) {
+		klass->klass = klass; // java.lang.Class itself
+	}
+	klass->is_gc_user_peer |= is_gc_user_peer;
+
+	return klass;
+}
+
+JavaClass*
+FakeJvm::define_peer_class (std::string const& name)
+{
+	JavaClass *klass = define_class (name, find_class ("java/lang/Object"), true /* is_gc_user_peer */);
+
+	add_method (klass, "monodroidAddReference", "(Ljava/lang/Object;)V", false, JavaMethodKind::AddReference);
+	add_method (klass, "monodroidClearReferences", "()V", false, JavaMethodKind::ClearReferences);
+
+	return klass;
+}
+
+JavaClass*
+FakeJvm::find_class (std::string const& name) noexcept
+{
+	for (auto const& klass : classes) {
+		if (klass->name == name) {
+			return klass.get ();
+		}
+	}
+
+	return nullptr;
+}
+
+void
+FakeJvm::add_method (JavaClass *klass, std::string const& name, std::string const& signature, bool is_static, JavaMethodKind kind)
+{
+	klass->methods.push_back (
+		std::make_unique<JavaMethod> (
+			JavaMethod {
+				.name = name,
+				.signature = signature,
+				.is_static = is_static,
+				.kind = kind,
+				.declaring_class = klass,
+			}
+		)
+	);
+}
+
+void
+FakeJvm::add_static_field (JavaClass *klass, std::string const& name, std::string const& signature, JavaObject *value)
+{
+	klass->static_fields.push_back (
+		std::make_unique<JavaField> (
+			JavaField {
+				.name = name,
+				.signature = signature,
+				.value = value,
+			}
+		)
+	);
+}
+
+JavaObject*
+FakeJvm::new_object (JavaClass *klass)
+{
+	auto obj = new JavaObject (klass);
+	heap.push_back (obj);
+
+	return obj;
+}
+
+jobject
+FakeJvm::new_global_ref (JavaObject *obj)
+{
+	return reinterpret_cast<jobject>(new_ref (obj, RefKind::Global));
+}
+
+void
+FakeJvm::delete_global_ref (jobject ref)
+{
+	delete_ref (ref, RefKind::Global, "delete_global_ref");
+}
+
+JavaObject*
+FakeJvm::resolve (jobject ref) const
+{
+	if (ref == nullptr) {
+		return nullptr;
+	}
+
+	return get_ref (ref, "resolve")->target;
+}
+
+FakeJvm::Ref*
+FakeJvm::new_ref (JavaObject *target, RefKind kind)
+{
+	Ref *ref;
+
+	if (free_refs != nullptr) {
+		ref = free_refs;
+		free_refs = ref->next_free;
+	} else {
+		ref = &refs.emplace_back ();
+	}
+
+	ref->target = target;
+	ref->kind = kind;
+	ref->next_free = nullptr;
+	live_refs [static_cast<size_t>(kind)]++;
+
+	return ref;
+}
+
+void
+FakeJvm::delete_ref (jobject handle, RefKind kind, const char *function)
+{
+	if (handle == nullptr) {
+		return;
+	}
+
+	Ref *ref = get_ref (handle, function);
+	if (ref->kind != kind) {
+		fatal ("%s: %p is not a reference of the expected kind (%u instead of %u)", function, handle, static_cast<unsigned>(ref->kind), static_cast<unsigned>(kind));
+	}
+
+	live_refs [static_cast<size_t>(kind)]--;
+	ref->target = nullptr;
+	ref->kind = RefKind::Free;
+	ref->next_free = free_refs;
+	free_refs = ref;
+}
+
+FakeJvm::Ref*
+FakeJvm::get_ref (jobject handle, const char *function) const
+{
+	auto ref = reinterpret_cast<Ref*>(handle);
+	if (ref->kind == RefKind::Free) [[unlikely]] {
+		fatal ("%s: use of a deleted reference %p", function, handle);
+	}
+
+	return ref;
+}
+
+jobject
+FakeJvm::local_ref (JavaObject *obj)
+{
+	if (obj == nullptr) {
+		return nullptr;
+	}
+
+	return reinterpret_cast<jobject>(new_ref (obj, RefKind::Local));
+}
+
+void
+FakeJvm::delete_local_refs ()
+{
+	for (Ref &ref : refs) {
+		if (ref.kind == RefKind::Local) {
+			delete_ref (reinterpret_cast<jobject>(&ref), RefKind::Local, "delete_local_refs");
+		}
+	}
+}
+
+void
+FakeJvm::throw_new (const char *class_name, std::string message)
+{
+	pending_exception = new_object (find_class (class_name));
+	pending_exception_message = std::string (class_name) + ": " + message;
+}
+
+JavaClass*
+FakeJvm::get_class (jclass clazz, const char *function) const
+{
+	JavaObject *obj = clazz == nullptr ? nullptr : get_ref (clazz, function)->target;
+	auto klass = dynamic_cast<JavaClass*>(obj);
+	if (klass == nullptr) {
+		fatal ("%s: %p is not a class reference", function, clazz);
+	}
+
+	return klass;
+}
+
+JavaArray*
+FakeJvm::get_array (jobject array, jsize start, jsize len, const char *function) const
+{
+	JavaObject *obj = array == nullptr ? nullptr : get_ref (array, function)->target;
+	auto arr = dynamic_cast<JavaArray*>(obj);
+	if (arr == nullptr) {
+		fatal ("%s: %p is not an array reference", function, array);
+	}
+
+	if (start < 0 || len < 0 || static_cast<size_t>(start) + static_cast<size_t>(len) > arr->length) {
+		fatal ("%s: region [%d, %d) out of bounds of an array of length %zu", function, start, start + len, arr->length);
+	}
+
+	return arr;
+}
+
+JavaMethod*
+FakeJvm::find_method (JavaClass *klass, const char *name, const char *sig, bool is_static)
+{
+	for (JavaClass *k = klass; k != nullptr; k = k->super) {
+		for (auto const& method : k->methods) {
+			if (method->is_static == is_static && method->name == name && method->signature == sig) {
+				return method.get ();
+			}
+		}
+
+		// Constructors and static methods aren't inherited
+		if (is_static || name [0] == '<') {
+			break;
+		}
+	}
+
+	throw_new ("java/lang/NoSuchMethodError", klass->name + "." + name + sig);
+	return nullptr;
+}
+
+JavaMethod*
+FakeJvm::get_method (jmethodID methodID, const char *function)
+{
+	if (methodID == nullptr) {
+		fatal ("%s: null method ID", function);
+	}
+
+	return reinterpret_cast<JavaMethod*>(methodID);
+}
+
+void
+FakeJvm::unpack_arguments (JavaMethod *method, va_list args, Arguments &result)
+{
+	const char *sig = method->signature.c_str ();
+
+	result.count = 0;
+	for (size_t i = 1; sig [i] != ')'; i++, result.count++) {
+		if (result.count >= Arguments::MAX_COUNT) {
+			fatal ("Method %s%s has too many parameters", method->name.c_str (), sig);
+		}
+
+		jvalue &value = result.values [result.count];
+		switch (sig [i]) {
+			case '[':
+				while (sig [i] == '[') {
+					i++;
+				}
+				[[fallthrough]];
+
+			case 'L':
+				if (sig [i] == 'L') {
+					while (sig [i] != ';') {
+						i++;
+					}
+				}
+				value.l = va_arg (args, jobject);
+				break;
+
+			case 'Z':
+				value.z = static_cast<jboolean>(va_arg (args, int));
+				break;
+
+			case 'B':
+			case 'C':
+			case 'S':
+			case 'I':
+				value.i = va_arg (args, jint);
+				break;
+
+			case 'J':
+				value.j = va_arg (args, jlong);
+				break;
+
+			case 'F':
+				value.f = static_cast<jfloat>(va_arg (args, double));
+				break;
+
+			case 'D':
+				value.d = va_arg (args, double);
+				break;
+
+			default:
+				fatal ("Unsupported signature %s", sig);
+		}
+	}
+}
+
+void
+FakeJvm::unpack_arguments (JavaMethod *method, const jvalue *args, Arguments &result)
+{
+	const char *sig = method->signature.c_str ();
+
+	result.count = 0;
+	for (size_t i = 1; sig [i] != ')'; i++, result.count++) {
+		if (result.count >= Arguments::MAX_COUNT) {
+			fatal ("Method %s%s has too many parameters", method->name.c_str (), sig);
+		}
+
+		while (sig [i] == '[') {
+			i++;
+		}
+		if (sig [i] == 'L') {
+			while (sig [i] != ';') {
+				i++;
+			}
+		}
+		result.values [result.count] = args [result.count];
+	}
+}
+
+JavaObject*
+FakeJvm::call_method (jobject obj, jclass clazz, JavaMethod *method, Arguments const& args, bool is_static, const char *function)
+{
+	if (method->is_static != is_static) {
+		fatal ("%s: %s.%s%s is %sa static method", function, method->declaring_class->name.c_str (), method->name.c_str (), method->signature.c_str (), is_static ? "not " : "");
+	}
+
+	if (is_static) {
+		if (!get_class (clazz, function)->is_subclass_of (method->declaring_class)) {
+			fatal ("%s: %s.%s isn't a method of the class", function, method->declaring_class->name.c_str (), method->name.c_str ());
+		}
+		return invoke (nullptr, method, args);
+	}
+
+	JavaObject *self = obj == nullptr ? nullptr : get_ref (obj, function)->target;
+	if (self == nullptr) {
+		fatal ("%s: %s.%s called on a null reference", function, method->declaring_class->name.c_str (), method->name.c_str ());
+	}
+
+	if (!self->klass->is_subclass_of (method->declaring_class)) {
+		fatal ("%s: %s.%s called on an instance of %s", function, method->declaring_class->name.c_str (), method->name.c_str (), self->klass->name.c_str ());
+	}
+
+	return invoke (self, method, args);
+}
+
+JavaObject*
+FakeJvm::invoke (JavaObject *self, JavaMethod *method, Arguments const& args)
+{
+	switch (method->kind) {
+		case JavaMethodKind::Nop:
+			return nullptr;
+
+		case JavaMethodKind::ClassGetName: {
+			std::string name = static_cast<JavaClass*>(self)->name;
+			for (char &c : name) {
+				if (c == '/') {
+					c = '.';
+				}
+			}
+
+			auto str = new JavaString (find_class ("java/lang/String"), std::move (name));
+			heap.push_back (str);
+			return str;
+		}
+
+		case JavaMethodKind::ObjectHashCode:
+			int_result = static_cast<jint>(reinterpret_cast<uintptr_t>(self) >> 4);
+			return nullptr;
+
+		case JavaMethodKind::RuntimeGetRuntime:
+			return runtime_instance;
+
+		case JavaMethodKind::RuntimeGc:
+			collect ();
+			return nullptr;
+
+		case JavaMethodKind::WeakReferenceCtor:
+			self->referent = resolve (args.values [0].l);
+			return nullptr;
+
+		case JavaMethodKind::WeakReferenceGet:
+			return self->referent;
+
+		case JavaMethodKind::AddReference: {
+			JavaObject *target = resolve (args.values [0].l);
+			if (target != nullptr) {
+				self->references.push_back (target);
+			}
+			return nullptr;
+		}
+
+		case JavaMethodKind::ClearReferences:
+			self->references.clear ();
+			return nullptr;
+
+		// Same as `mono.android.GCBridge.addReferences`
+		case JavaMethodKind::GCBridgeAddReferences: {
+			auto peers = dynamic_cast<JavaArray*>(resolve (args.values [0].l));
+			jint first_temporary_peer = args.values [1].i;
+			auto links = dynamic_cast<JavaArray*>(resolve (args.values [2].l));
+			jint link_count = args.values [3].i;
+			auto refs_added = dynamic_cast<JavaArray*>(resolve (args.values [4].l));
+
+			if (peers == nullptr || links == nullptr || refs_added == nullptr) {
+				throw_new ("java/lang/NullPointerException", "GCBridge.addReferences");
+				return nullptr;
+			}
+
+			for (jint i = 0; i < link_count; i++) {
+				jint source = links->ints [static_cast<size_t>(i) * 2];
+				JavaObject *peer = peers->objects [static_cast<size_t>(source)];
+
+				if (peer == nullptr || !peer->klass->is_gc_user_peer) {
+					continue;
+				}
+
+				JavaObject *target = peers->objects [static_cast<size_t>(links->ints [static_cast<size_t>(i) * 2 + 1])];
+				if (target != nullptr) {
+					peer->references.push_back (target);
+				}
+				if (source < first_temporary_peer) {
+					refs_added->booleans [static_cast<size_t>(source)] = JNI_TRUE;
+				}
+			}
+			return nullptr;
+		}
+
+		// Same as `mono.android.GCBridge.clearReferences`
+		case JavaMethodKind::GCBridgeClearReferences: {
+			auto peers = dynamic_cast<JavaArray*>(resolve (args.values [0].l));
+			if (peers == nullptr) {
+				throw_new ("java/lang/NullPointerException", "GCBridge.clearReferences");
+				return nullptr;
+			}
+
+			for (JavaObject *peer : peers->objects) {
+				if (peer != nullptr && peer->klass->is_gc_user_peer) {
+					peer->references.clear ();
+				}
+			}
+			return nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
+jobject
+FakeJvm::construct (jclass clazz, JavaMethod *ctor, Arguments const& args)
+{
+	JavaClass *klass = get_class (clazz, "NewObject");
+	if (ctor->name != "<init>" || ctor->declaring_class != klass) {
+		fatal ("NewObject: %s.%s isn't a constructor of %s", ctor->declaring_class->name.c_str (), ctor->name.c_str (), klass->name.c_str ());
+	}
+
+	JavaObject *obj = new_object (klass);
+	invoke (obj, ctor, args);
+
+	return local_ref (obj);
+}
+
+// `Runtime.gc()` is where the Java collection phase of a bridge pass starts and ends
+void
+FakeJvm::call_void_method (jobject obj, JavaMethod *method, Arguments const& args, const char *function)
+{
+	bool is_gc = method->kind == JavaMethodKind::RuntimeGc && phase == JniPhase::Prepare;
+	if (is_gc) {
+		phase = JniPhase::JavaGC;
+	}
+
+	{
+		CallScope scope (JniFunction::CallVoidMethod);
+		call_method (obj, nullptr, method, args, false /* is_static */, function);
+	}
+
+	if (is_gc) {
+		phase = JniPhase::Cleanup;
+	}
+}
+
+jint
+FakeJvm::call_int_method (jobject obj, JavaMethod *method, Arguments const& args, const char *function)
+{
+	if (!method->signature.ends_with (")I")) {
+		fatal ("%s: %s.%s%s doesn't return int", function, method->declaring_class->name.c_str (), method->name.c_str (), method->signature.c_str ());
+	}
+
+	int_result = 0;
+	call_method (obj, nullptr, method, args, false /* is_static */, function);
+	return int_result;
+}
+
+// Objects reachable from the local and global references, the static fields and the objects `rooted` by the
+// benchmark survive, weak references to the others are cleared.  References added by `monodroidAddReference` are
+// strong, the target of a `WeakReference` isn't.
+void
+FakeJvm::collect ()
+{
+	std::vector<JavaObject*> stack;
+
+	auto mark = [&stack](JavaObject *obj) {
+		if (obj != nullptr && !obj->marked) {
+			obj->marked = true;
+			stack.push_back (obj);
+		}
+	};
+
+	for (Ref &ref : refs) {
+		if (ref.kind == RefKind::Local || ref.kind == RefKind::Global) {
+			mark (ref.target);
+		}
+	}
+
+	for (auto const& klass : classes) {
+		for (auto const& field : klass->static_fields) {
+			mark (field->value);
+		}
+	}
+
+	for (JavaObject *obj : heap) {
+		if (obj->rooted) {
+			mark (obj);
+		}
+	}
+	mark (pending_exception);
+
+	while (!stack.empty ()) {
+		JavaObject *obj = stack.back ();
+		stack.pop_back ();
+
+		for (JavaObject *target : obj->references) {
+			mark (target);
+		}
+
+		if (auto array = dynamic_cast<JavaArray*>(obj); array != nullptr) {
+			for (JavaObject *target : array->objects) {
+				mark (target);
+			}
+		}
+	}
+
+	auto is_dead = [](JavaObject *obj) {
+		return obj != nullptr && !obj->marked && dynamic_cast<JavaClass*>(obj) == nullptr;
+	};
+
+	for (Ref &ref : refs) {
+		if (ref.kind == RefKind::WeakGlobal && is_dead (ref.target)) {
+			ref.target = nullptr;
+		}
+	}
+
+	// Before anything is deleted, `is_dead` reads the referent
+	for (JavaObject *obj : heap) {
+		if (obj->marked && is_dead (obj->referent)) {
+			obj->referent = nullptr;
+		}
+	}
+
+	size_t kept = 0;
+	for (JavaObject *obj : heap) {
+		if (!obj->marked) {
+			delete obj;
+			continue;
+		}
+		heap [kept++] = obj;
+	}
+	heap.resize (kept);
+
+	for (JavaObject *obj : heap) {
+		obj->marked = false;
+	}
+	for (auto const& klass : classes) {
+		klass->marked = false;
+	}
+}
+
+jint
+FakeJvm::GetEnv ([[maybe_unused]] JavaVM *vm, void **penv, [[maybe_unused]] jint version)
+{
+	CallScope scope (JniFunction::GetEnv);
+
+	*penv = current->env ();
+	return JNI_OK;
+}
+
+jclass
+FakeJvm::FindClass ([[maybe_unused]] JNIEnv *env, const char *name)
+{
+	CallScope scope (JniFunction::FindClass);
+	FakeJvm &jvm = instance ();
+
+	JavaClass *klass = jvm.find_class (name);
+	if (klass == nullptr) {
+		jvm.throw_new ("java/lang/NoClassDefFoundError", name);
+		return nullptr;
+	}
+
+	return reinterpret_cast<jclass>(jvm.local_ref (klass));
+}
+
+jmethodID
+FakeJvm::GetMethodID ([[maybe_unused]] JNIEnv *env, jclass clazz, const char *name, const char *sig)
+{
+	CallScope scope (JniFunction::GetMethodID);
+	FakeJvm &jvm = instance ();
+
+	return reinterpret_cast<jmethodID>(jvm.find_method (jvm.get_class (clazz, "GetMethodID"), name, sig, false /* is_static */));
+}
+
+jmethodID
+FakeJvm::GetStaticMethodID ([[maybe_unused]] JNIEnv *env, jclass clazz, const char *name, const char *sig)
+{
+	CallScope scope (JniFunction::GetStaticMethodID);
+	FakeJvm &jvm = instance ();
+
+	return reinterpret_cast<jmethodID>(jvm.find_method (jvm.get_class (clazz, "GetStaticMethodID"), name, sig, true /* is_static */));
+}
+
+jfieldID
+FakeJvm::GetStaticFieldID ([[maybe_unused]] JNIEnv *env, jclass clazz, const char *name, const char *sig)
+{
+	CallScope scope (JniFunction::GetStaticFieldID);
+	FakeJvm &jvm = instance ();
+
+	JavaClass *klass = jvm.get_class (clazz, "GetStaticFieldID");
+	for (auto const& field : klass->static_fields) {
+		if (field->name == name && field->signature == sig) {
+			return reinterpret_cast<jfieldID>(field.get ());
+		}
+	}
+
+	jvm.throw_new ("java/lang/NoSuchFieldError", klass->name + "." + name);
+	return nullptr;
+}
+
+jobject
+FakeJvm::GetStaticObjectField ([[maybe_unused]] JNIEnv *env, [[maybe_unused]] jclass clazz, jfieldID fieldID)
+{
+	CallScope scope (JniFunction::GetStaticObjectField);
+
+	return instance ().local_ref (reinterpret_cast<JavaField*>(fieldID)->value);
+}
+
+jclass
+FakeJvm::GetObjectClass ([[maybe_unused]] JNIEnv *env, jobject obj)
+{
+	CallScope scope (JniFunction::GetObjectClass);
+	FakeJvm &jvm = instance ();
+
+	JavaObject *target = jvm.resolve (obj);
+	if (target == nullptr) {
+		fatal ("GetObjectClass: null reference");
+	}
+
+	return reinterpret_cast<jclass>(jvm.local_ref (target->klass));
+}
+
+jboolean
+FakeJvm::IsSameObject ([[maybe_unused]] JNIEnv *env, jobject obj1, jobject obj2)
+{
+	CallScope scope (JniFunction::IsSameObject);
+	FakeJvm &jvm = instance ();
+
+	return jvm.resolve (obj1) == jvm.resolve (obj2) ? JNI_TRUE : JNI_FALSE;
+}
+
+jobjectRefType
+FakeJvm::GetObjectRefType ([[maybe_unused]] JNIEnv *env, jobject obj)
+{
+	CallScope scope (JniFunction::GetObjectRefType);
+
+	if (obj == nullptr) {
+		return JNIInvalidRefType;
+	}
+
+	switch (instance ().get_ref (obj, "GetObjectRefType")->kind) {
+		case RefKind::Local:       return JNILocalRefType;
+		case RefKind::Global:      return JNIGlobalRefType;
+		case RefKind::WeakGlobal:  return JNIWeakGlobalRefType;
+		default:                   return JNIInvalidRefType;
+	}
+}
+
+jobject
+FakeJvm::NewLocalRef ([[maybe_unused]] JNIEnv *env, jobject ref)
+{
+	CallScope scope (JniFunction::NewLocalRef);
+	FakeJvm &jvm = instance ();
+
+	return jvm.local_ref (jvm.resolve (ref));
+}
+
+void
+FakeJvm::DeleteLocalRef ([[maybe_unused]] JNIEnv *env, jobject obj)
+{
+	CallScope scope (JniFunction::DeleteLocalRef);
+
+	instance ().delete_ref (obj, RefKind::Local, "DeleteLocalRef");
+}
+
+jobject
+FakeJvm::NewGlobalRef ([[maybe_unused]] JNIEnv *env, jobject obj)
+{
+	CallScope scope (JniFunction::NewGlobalRef);
+	FakeJvm &jvm = instance ();
+
+	JavaObject *target = jvm.resolve (obj);
+	if (target == nullptr) {
+		return nullptr;
+	}
+
+	return reinterpret_cast<jobject>(jvm.new_ref (target, RefKind::Global));
+}
+
+void
+FakeJvm::DeleteGlobalRef ([[maybe_unused]] JNIEnv *env, jobject obj)
+{
+	CallScope scope (JniFunction::DeleteGlobalRef);
+
+	instance ().delete_ref (obj, RefKind::Global, "DeleteGlobalRef");
+}
+
+jweak
+FakeJvm::NewWeakGlobalRef ([[maybe_unused]] JNIEnv *env, jobject obj)
+{
+	CallScope scope (JniFunction::NewWeakGlobalRef);
+	FakeJvm &jvm = instance ();
+
+	JavaObject *target = jvm.resolve (obj);
+	if (target == nullptr) {
+		return nullptr;
+	}
+
+	return reinterpret_cast<jweak>(jvm.new_ref (target, RefKind::WeakGlobal));
+}
+
+void
+FakeJvm::DeleteWeakGlobalRef ([[maybe_unused]] JNIEnv *env, jweak obj)
+{
+	CallScope scope (JniFunction::DeleteWeakGlobalRef);
+
+	instance ().delete_ref (obj, RefKind::WeakGlobal, "DeleteWeakGlobalRef");
+}
+
+jobject
+FakeJvm::NewObjectV ([[maybe_unused]] JNIEnv *env, jclass clazz, jmethodID methodID, va_list args)
+{
+	CallScope scope (JniFunction::NewObject);
+	JavaMethod *method = get_method (methodID, "NewObjectV");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return instance ().construct (clazz, method, arguments);
+}
+
+jobject
+FakeJvm::NewObjectA ([[maybe_unused]] JNIEnv *env, jclass clazz, jmethodID methodID, const jvalue *args)
+{
+	CallScope scope (JniFunction::NewObject);
+	JavaMethod *method = get_method (methodID, "NewObjectA");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return instance ().construct (clazz, method, arguments);
+}
+
+jobject
+FakeJvm::CallObjectMethodV ([[maybe_unused]] JNIEnv *env, jobject obj, jmethodID methodID, va_list args)
+{
+	CallScope scope (JniFunction::CallObjectMethod);
+	FakeJvm &jvm = instance ();
+	JavaMethod *method = get_method (methodID, "CallObjectMethodV");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return jvm.local_ref (jvm.call_method (obj, nullptr, method, arguments, false /* is_static */, "CallObjectMethodV"));
+}
+
+jobject
+FakeJvm::CallObjectMethodA ([[maybe_unused]] JNIEnv *env, jobject obj, jmethodID methodID, const jvalue *args)
+{
+	CallScope scope (JniFunction::CallObjectMethod);
+	FakeJvm &jvm = instance ();
+	JavaMethod *method = get_method (methodID, "CallObjectMethodA");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return jvm.local_ref (jvm.call_method (obj, nullptr, method, arguments, false /* is_static */, "CallObjectMethodA"));
+}
+
+jint
+FakeJvm::CallIntMethodV ([[maybe_unused]] JNIEnv *env, jobject obj, jmethodID methodID, va_list args)
+{
+	CallScope scope (JniFunction::CallIntMethod);
+	JavaMethod *method = get_method (methodID, "CallIntMethodV");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return instance ().call_int_method (obj, method, arguments, "CallIntMethodV");
+}
+
+jint
+FakeJvm::CallIntMethodA ([[maybe_unused]] JNIEnv *env, jobject obj, jmethodID methodID, const jvalue *args)
+{
+	CallScope scope (JniFunction::CallIntMethod);
+	JavaMethod *method = get_method (methodID, "CallIntMethodA");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return instance ().call_int_method (obj, method, arguments, "CallIntMethodA");
+}
+
+void
+FakeJvm::CallVoidMethodV ([[maybe_unused]] JNIEnv *env, jobject obj, jmethodID methodID, va_list args)
+{
+	JavaMethod *method = get_method (methodID, "CallVoidMethodV");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	instance ().call_void_method (obj, method, arguments, "CallVoidMethodV");
+}
+
+void
+FakeJvm::CallVoidMethodA ([[maybe_unused]] JNIEnv *env, jobject obj, jmethodID methodID, const jvalue *args)
+{
+	JavaMethod *method = get_method (methodID, "CallVoidMethodA");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	instance ().call_void_method (obj, method, arguments, "CallVoidMethodA");
+}
+
+jobject
+FakeJvm::CallStaticObjectMethodV ([[maybe_unused]] JNIEnv *env, jclass clazz, jmethodID methodID, va_list args)
+{
+	CallScope scope (JniFunction::CallStaticObjectMethod);
+	FakeJvm &jvm = instance ();
+	JavaMethod *method = get_method (methodID, "CallStaticObjectMethodV");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return jvm.local_ref (jvm.call_method (nullptr, clazz, method, arguments, true /* is_static */, "CallStaticObjectMethodV"));
+}
+
+jobject
+FakeJvm::CallStaticObjectMethodA ([[maybe_unused]] JNIEnv *env, jclass clazz, jmethodID methodID, const jvalue *args)
+{
+	CallScope scope (JniFunction::CallStaticObjectMethod);
+	FakeJvm &jvm = instance ();
+	JavaMethod *method = get_method (methodID, "CallStaticObjectMethodA");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	return jvm.local_ref (jvm.call_method (nullptr, clazz, method, arguments, true /* is_static */, "CallStaticObjectMethodA"));
+}
+
+void
+FakeJvm::CallStaticVoidMethodV ([[maybe_unused]] JNIEnv *env, jclass clazz, jmethodID methodID, va_list args)
+{
+	CallScope scope (JniFunction::CallStaticVoidMethod);
+	JavaMethod *method = get_method (methodID, "CallStaticVoidMethodV");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	instance ().call_method (nullptr, clazz, method, arguments, true /* is_static */, "CallStaticVoidMethodV");
+}
+
+void
+FakeJvm::CallStaticVoidMethodA ([[maybe_unused]] JNIEnv *env, jclass clazz, jmethodID methodID, const jvalue *args)
+{
+	CallScope scope (JniFunction::CallStaticVoidMethod);
+	JavaMethod *method = get_method (methodID, "CallStaticVoidMethodA");
+	Arguments arguments;
+
+	unpack_arguments (method, args, arguments);
+	instance ().call_method (nullptr, clazz, method, arguments, true /* is_static */, "CallStaticVoidMethodA");
+}
+
+jobjectArray
+FakeJvm::NewObjectArray ([[maybe_unused]] JNIEnv *env, jsize len, [[maybe_unused]] jclass clazz, jobject init)
+{
+	CallScope scope (JniFunction::NewObjectArray);
+	FakeJvm &jvm = instance ();
+
+	if (len < 0) {
+		fatal ("NewObjectArray: negative length %d", len);
+	}
+
+	auto array = new JavaArray (jvm.find_class ("[Ljava/lang/Object;"), static_cast<size_t>(len));
+	array->objects.assign (array->length, jvm.resolve (init));
+	jvm.heap.push_back (array);
+
+	return reinterpret_cast<jobjectArray>(jvm.local_ref (array));
+}
+
+jobject
+FakeJvm::GetObjectArrayElement ([[maybe_unused]] JNIEnv *env, jobjectArray array, jsize index)
+{
+	CallScope scope (JniFunction::GetObjectArrayElement);
+	FakeJvm &jvm = instance ();
+
+	return jvm.local_ref (jvm.get_array (array, index, 1, "GetObjectArrayElement")->objects [static_cast<size_t>(index)]);
+}
+
+void
+FakeJvm::SetObjectArrayElement ([[maybe_unused]] JNIEnv *env, jobjectArray array, jsize index, jobject val)
+{
+	CallScope scope (JniFunction::SetObjectArrayElement);
+	FakeJvm &jvm = instance ();
+
+	jvm.get_array (array, index, 1, "SetObjectArrayElement")->objects [static_cast<size_t>(index)] = jvm.resolve (val);
+}
+
+jsize
+FakeJvm::GetArrayLength ([[maybe_unused]] JNIEnv *env, jarray array)
+{
+	CallScope scope (JniFunction::GetArrayLength);
+
+	return static_cast<jsize>(instance ().get_array (array, 0, 0, "GetArrayLength")->length);
+}
+
+jintArray
+FakeJvm::NewIntArray ([[maybe_unused]] JNIEnv *env, jsize len)
+{
+	CallScope scope (JniFunction::NewIntArray);
+	FakeJvm &jvm = instance ();
+
+	if (len < 0) {
+		fatal ("NewIntArray: negative length %d", len);
+	}
+
+	auto array = new JavaArray (jvm.find_class ("[I"), static_cast<size_t>(len));
+	array->ints.assign (array->length, 0);
+	jvm.heap.push_back (array);
+
+	return reinterpret_cast<jintArray>(jvm.local_ref (array));
+}
+
+void
+FakeJvm::GetIntArrayRegion ([[maybe_unused]] JNIEnv *env, jintArray array, jsize start, jsize len, jint *buf)
+{
+	CallScope scope (JniFunction::GetIntArrayRegion);
+
+	JavaArray *arr = instance ().get_array (array, start, len, "GetIntArrayRegion");
+	std::copy_n (arr->ints.begin () + start, len, buf);
+}
+
+void
+FakeJvm::SetIntArrayRegion ([[maybe_unused]] JNIEnv *env, jintArray array, jsize start, jsize len, const jint *buf)
+{
+	CallScope scope (JniFunction::SetIntArrayRegion);
+
+	JavaArray *arr = instance ().get_array (array, start, len, "SetIntArrayRegion");
+	std::copy_n (buf, len, arr->ints.begin () + start);
+}
+
+jbooleanArray
+FakeJvm::NewBooleanArray ([[maybe_unused]] JNIEnv *env, jsize len)
+{
+	CallScope scope (JniFunction::NewBooleanArray);
+	FakeJvm &jvm = instance ();
+
+	if (len < 0) {
+		fatal ("NewBooleanArray: negative length %d", len);
+	}
+
+	auto array = new JavaArray (jvm.find_class ("[Z"), static_cast<size_t>(len));
+	array->booleans.assign (array->length, JNI_FALSE);
+	jvm.heap.push_back (array);
+
+	return reinterpret_cast<jbooleanArray>(jvm.local_ref (array));
+}
+
+void
+FakeJvm::GetBooleanArrayRegion ([[maybe_unused]] JNIEnv *env, jbooleanArray array, jsize start, jsize len, jboolean *buf)
+{
+	CallScope scope (JniFunction::GetBooleanArrayRegion);
+
+	JavaArray *arr = instance ().get_array (array, start, len, "GetBooleanArrayRegion");
+	std::copy_n (arr->booleans.begin () + start, len, buf);
+}
+
+void
+FakeJvm::SetBooleanArrayRegion ([[maybe_unused]] JNIEnv *env, jbooleanArray array, jsize start, jsize len, const jboolean *buf)
+{
+	CallScope scope (JniFunction::SetBooleanArrayRegion);
+
+	JavaArray *arr = instance ().get_array (array, start, len, "SetBooleanArrayRegion");
+	std::copy_n (buf, len, arr->booleans.begin () + start);
+}
+
+jstring
+FakeJvm::NewStringUTF ([[maybe_unused]] JNIEnv *env, const char *utf)
+{
+	CallScope scope (JniFunction::NewStringUTF);
+	FakeJvm &jvm = instance ();
+
+	auto str = new JavaString (jvm.find_class ("java/lang/String"), utf);
+	jvm.heap.push_back (str);
+
+	return reinterpret_cast<jstring>(jvm.local_ref (str));
+}
+
+const char*
+FakeJvm::GetStringUTFChars ([[maybe_unused]] JNIEnv *env, jstring str, jboolean *isCopy)
+{
+	CallScope scope (JniFunction::GetStringUTFChars);
+
+	auto s = dynamic_cast<JavaString*>(instance ().resolve (str));
+	if (s == nullptr) {
+		fatal ("GetStringUTFChars: %p is not a string reference", str);
+	}
+
+	if (isCopy != nullptr) {
+		*isCopy = JNI_FALSE;
+	}
+	return s->value.c_str ();
+}
+
+void
+FakeJvm::ReleaseStringUTFChars ([[maybe_unused]] JNIEnv *env, [[maybe_unused]] jstring str, [[maybe_unused]] const char *chars)
+{
+	CallScope scope (JniFunction::ReleaseStringUTFChars);
+}
+
+jboolean
+FakeJvm::ExceptionCheck ([[maybe_unused]] JNIEnv *env)
+{
+	CallScope scope (JniFunction::ExceptionCheck);
+
+	return instance ().pending_exception != nullptr ? JNI_TRUE : JNI_FALSE;
+}
+
+jthrowable
+FakeJvm::ExceptionOccurred ([[maybe_unused]] JNIEnv *env)
+{
+	CallScope scope (JniFunction::ExceptionOccurred);
+	FakeJvm &jvm = instance ();
+
+	return reinterpret_cast<jthrowable>(jvm.local_ref (jvm.pending_exception));
+}
+
+void
+FakeJvm::ExceptionDescribe ([[maybe_unused]] JNIEnv *env)
+{
+	CallScope scope (JniFunction::ExceptionDescribe);
+	FakeJvm &jvm = instance ();
+
+	if (jvm.pending_exception != nullptr) {
+		fprintf (stderr, "Exception in bridge processing: %s\n", jvm.pending_exception_message.c_str ());
+	}
+	jvm.pending_exception = nullptr;
+}
+
+void
+FakeJvm::ExceptionClear ([[maybe_unused]] JNIEnv *env)
+{
+	CallScope scope (JniFunction::ExceptionClear);
+
+	instance ().pending_exception = nullptr;
+}
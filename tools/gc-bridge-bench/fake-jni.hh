@@ -0,0 +1,411 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_FAKE_JNI_HH
+#define __GC_BRIDGE_BENCH_FAKE_JNI_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <jni.h>
+
+namespace xamarin::android::bench
+{
+	struct JavaClass;
+
+	struct JavaObject
+	{
+		JavaClass                *klass;
+		std::vector<JavaObject*>  references;          // added with `monodroidAddReference`
+		JavaObject               *referent = nullptr;  // target of a `java.lang.ref.WeakReference`
+		bool                      rooted = false;      // kept alive by something the GC bridge doesn't know about
+		bool                      marked = false;
+
+		explicit JavaObject (JavaClass *k)
+			: klass (k)
+		{}
+
+		virtual ~JavaObject () = default;
+	};
+
+	struct JavaString final : public JavaObject
+	{
+		std::string  value;
+
+		JavaString (JavaClass *k, std::string v)
+			: JavaObject (k),
+			  value (std::move (v))
+		{}
+	};
+
+	struct JavaArray final : public JavaObject
+	{
+		size_t                    length;
+		std::vector<JavaObject*>  objects;
+		std::vector<jint>         ints;
+		std::vector<jboolean>     booleans;
+
+		JavaArray (JavaClass *k, size_t len)
+			: JavaObject (k),
+			  length (len)
+		{}
+	};
+
+	enum class JavaMethodKind
+	{
+		Nop,
+		ClassGetName,
+		ObjectHashCode,
+		RuntimeGetRuntime,
+		RuntimeGc,
+		WeakReferenceCtor,
+		WeakReferenceGet,
+		AddReference,
+		ClearReferences,
+		GCBridgeAddReferences,
+		GCBridgeClearReferences,
+	};
+
+	struct JavaMethod
+	{
+		std::string     name;
+		std::string     signature;
+		bool            is_static;
+		JavaMethodKind  kind;
+		JavaClass      *declaring_class;
+	};
+
+	struct JavaField
+	{
+		std::string   name;
+		std::string   signature;
+		JavaObject   *value;
+	};
+
+	struct JavaClass final : public JavaObject
+	{
+		std::string                               name;
+		JavaClass                                *super;
+		bool                                      is_gc_user_peer;
+		std::vector<std::unique_ptr<JavaMethod>>  methods;
+		std::vector<std::unique_ptr<JavaField>>   static_fields;
+
+		JavaClass (JavaClass *k, std::string n, JavaClass *s)
+			: JavaObject (k),
+			  name (std::move (n)),
+			  super (s),
+			  is_gc_user_peer (s != nullptr && s->is_gc_user_peer)
+		{}
+
+		bool is_subclass_of (JavaClass const* other) const noexcept
+		{
+			for (JavaClass const* k = this; k != nullptr; k = k->super) {
+				if (k == other) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+	};
+
+	// Every JNI function which may be called by the GC bridge code, in the order used for reporting
+	enum class JniFunction : uint32_t
+	{
+		GetEnv,
+		FindClass,
+		GetMethodID,
+		GetStaticMethodID,
+		GetStaticFieldID,
+		GetStaticObjectField,
+		GetObjectClass,
+		IsSameObject,
+		GetObjectRefType,
+		NewLocalRef,
+		DeleteLocalRef,
+		NewGlobalRef,
+		DeleteGlobalRef,
+		NewWeakGlobalRef,
+		DeleteWeakGlobalRef,
+		NewObject,
+		CallObjectMethod,
+		CallIntMethod,
+		CallVoidMethod,
+		CallStaticObjectMethod,
+		CallStaticVoidMethod,
+		NewObjectArray,
+		GetObjectArrayElement,
+		SetObjectArrayElement,
+		GetArrayLength,
+		NewIntArray,
+		GetIntArrayRegion,
+		SetIntArrayRegion,
+		NewBooleanArray,
+		GetBooleanArrayRegion,
+		SetBooleanArrayRegion,
+		NewStringUTF,
+		GetStringUTFChars,
+		ReleaseStringUTFChars,
+		ExceptionCheck,
+		ExceptionOccurred,
+		ExceptionDescribe,
+		ExceptionClear,
+
+		Count,
+	};
+
+	// JNI calls are accounted to the bridge phase they are made in, the phase changes are reported by the benchmark
+	enum class JniPhase : uint32_t
+	{
+		Other    = 0,
+		Prepare  = 1,
+		JavaGC   = 2,
+		Cleanup  = 3,
+
+		Count,
+	};
+
+	struct JniCallStats
+	{
+		uint64_t  calls[static_cast<size_t>(JniPhase::Count)][static_cast<size_t>(JniFunction::Count)];
+		uint64_t  ns[static_cast<size_t>(JniPhase::Count)][static_cast<size_t>(JniFunction::Count)];
+
+		uint64_t phase_calls (JniPhase phase) const noexcept
+		{
+			uint64_t total = 0;
+			for (uint64_t c : calls[static_cast<size_t>(phase)]) {
+				total += c;
+			}
+			return total;
+		}
+	};
+
+	// A single threaded, in-process stand-in for the Java VM: `JNIEnv` and `JavaVM` function tables backed by a tiny
+	// object heap with a mark & sweep collector.  Local, global and weak global references are distinct handles,
+	// with the JNI semantics the GC bridge relies on (weak references to objects collected by `Runtime.gc()` are
+	// cleared, using a deleted reference or a reference of the wrong kind aborts).  Every JNI call is counted (and
+	// optionally timed) per `JniPhase`.  JNI functions the bridge doesn't use abort when called.
+	class FakeJvm
+	{
+		enum class RefKind : uint8_t
+		{
+			Free,
+			Local,
+			Global,
+			WeakGlobal,
+		};
+
+		struct Ref
+		{
+			JavaObject  *target;
+			RefKind      kind;
+			Ref         *next_free;
+		};
+
+		using EnvFunctions = std::remove_const_t<std::remove_pointer_t<decltype(JNIEnv::functions)>>;
+		using VMFunctions = std::remove_const_t<std::remove_pointer_t<decltype(JavaVM::functions)>>;
+
+	public:
+		FakeJvm ();
+		~FakeJvm ();
+
+		FakeJvm (FakeJvm const&) = delete;
+		FakeJvm& operator= (FakeJvm const&) = delete;
+
+		static FakeJvm& instance () noexcept
+		{
+			return *current;
+		}
+
+		JNIEnv* env () noexcept
+		{
+			return &jni_env;
+		}
+
+		JavaVM* vm () noexcept
+		{
+			return &java_vm;
+		}
+
+		// Simulated cost of a single JNI transition, spent busy waiting in every call
+		void set_call_cost_ns (uint64_t ns) noexcept
+		{
+			call_cost_ns = ns;
+		}
+
+		void set_time_calls (bool yesno) noexcept
+		{
+			time_calls = yesno;
+		}
+
+		void set_phase (JniPhase p) noexcept
+		{
+			phase = p;
+		}
+
+		JniCallStats const& call_stats () const noexcept
+		{
+			return stats;
+		}
+
+		void reset_call_stats () noexcept;
+
+		// Java side of the benchmark setup, none of these count as JNI calls
+		JavaClass* define_class (std::string const& name, JavaClass *super, bool is_gc_user_peer = false);
+		JavaClass* define_peer_class (std::string const& name); // implements `mono.android.IGCUserPeer`
+		JavaClass* find_class (std::string const& name) noexcept;
+		void add_method (JavaClass *klass, std::string const& name, std::string const& signature, bool is_static, JavaMethodKind kind);
+		void add_static_field (JavaClass *klass, std::string const& name, std::string const& signature, JavaObject *value);
+		JavaObject* new_object (JavaClass *klass);
+		jobject new_global_ref (JavaObject *obj);
+		void delete_global_ref (jobject ref);
+
+		// Target of a reference of any kind, `nullptr` for a cleared weak reference
+		JavaObject* resolve (jobject ref) const;
+
+		// Local references are never released implicitly, the bridge callback isn't a JNI native method
+		size_t live_local_refs () const noexcept
+		{
+			return live_refs[static_cast<size_t>(RefKind::Local)];
+		}
+
+		size_t live_global_refs () const noexcept
+		{
+			return live_refs[static_cast<size_t>(RefKind::Global)];
+		}
+
+		size_t live_weak_global_refs () const noexcept
+		{
+			return live_refs[static_cast<size_t>(RefKind::WeakGlobal)];
+		}
+
+		size_t heap_size () const noexcept
+		{
+			return heap.size ();
+		}
+
+		void delete_local_refs ();
+		void collect ();
+
+	private:
+		class CallScope
+		{
+		public:
+			explicit CallScope (JniFunction fn) noexcept;
+			~CallScope () noexcept;
+
+		private:
+			JniFunction  function;
+			JniPhase     phase;
+			uint64_t     start_ns;
+		};
+
+		struct Arguments
+		{
+			static constexpr size_t MAX_COUNT = 8;
+
+			std::array<jvalue, MAX_COUNT>  values;
+			size_t                         count;
+		};
+
+		Ref* new_ref (JavaObject *target, RefKind kind);
+		void delete_ref (jobject handle, RefKind kind, const char *function);
+		Ref* get_ref (jobject handle, const char *function) const;
+		jobject local_ref (JavaObject *obj);
+		void throw_new (const char *class_name, std::string message);
+		JavaClass* get_class (jclass clazz, const char *function) const;
+		JavaArray* get_array (jobject array, jsize start, jsize len, const char *function) const;
+		JavaMethod* find_method (JavaClass *klass, const char *name, const char *sig, bool is_static);
+		void fill_tables ();
+
+		static JavaMethod* get_method (jmethodID methodID, const char *function);
+		static void unpack_arguments (JavaMethod *method, va_list args, Arguments &result);
+		static void unpack_arguments (JavaMethod *method, const jvalue *args, Arguments &result);
+
+		JavaObject* call_method (jobject obj, jclass clazz, JavaMethod *method, Arguments const& args, bool is_static, const char *function);
+		JavaObject* invoke (JavaObject *self, JavaMethod *method, Arguments const& args);
+		jobject construct (jclass clazz, JavaMethod *ctor, Arguments const& args);
+		void call_void_method (jobject obj, JavaMethod *method, Arguments const& args, const char *function);
+		jint call_int_method (jobject obj, JavaMethod *method, Arguments const& args, const char *function);
+
+		[[noreturn]] static void fatal (const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+
+		// The JNI function table entries
+		static jint JNICALL GetEnv (JavaVM *vm, void **penv, jint version);
+		static jclass JNICALL FindClass (JNIEnv *env, const char *name);
+		static jmethodID JNICALL GetMethodID (JNIEnv *env, jclass clazz, const char *name, const char *sig);
+		static jmethodID JNICALL GetStaticMethodID (JNIEnv *env, jclass clazz, const char *name, const char *sig);
+		static jfieldID JNICALL GetStaticFieldID (JNIEnv *env, jclass clazz, const char *name, const char *sig);
+		static jobject JNICALL GetStaticObjectField (JNIEnv *env, jclass clazz, jfieldID fieldID);
+		static jclass JNICALL GetObjectClass (JNIEnv *env, jobject obj);
+		static jboolean JNICALL IsSameObject (JNIEnv *env, jobject obj1, jobject obj2);
+		static jobjectRefType JNICALL GetObjectRefType (JNIEnv *env, jobject obj);
+		static jobject JNICALL NewLocalRef (JNIEnv *env, jobject ref);
+		static void JNICALL DeleteLocalRef (JNIEnv *env, jobject obj);
+		static jobject JNICALL NewGlobalRef (JNIEnv *env, jobject obj);
+		static void JNICALL DeleteGlobalRef (JNIEnv *env, jobject obj);
+		static jweak JNICALL NewWeakGlobalRef (JNIEnv *env, jobject obj);
+		static void JNICALL DeleteWeakGlobalRef (JNIEnv *env, jweak obj);
+		static jobject JNICALL NewObjectV (JNIEnv *env, jclass clazz, jmethodID methodID, va_list args);
+		static jobject JNICALL NewObjectA (JNIEnv *env, jclass clazz, jmethodID methodID, const jvalue *args);
+		static jobject JNICALL CallObjectMethodV (JNIEnv *env, jobject obj, jmethodID methodID, va_list args);
+		static jobject JNICALL CallObjectMethodA (JNIEnv *env, jobject obj, jmethodID methodID, const jvalue *args);
+		static jint JNICALL CallIntMethodV (JNIEnv *env, jobject obj, jmethodID methodID, va_list args);
+		static jint JNICALL CallIntMethodA (JNIEnv *env, jobject obj, jmethodID methodID, const jvalue *args);
+		static void JNICALL CallVoidMethodV (JNIEnv *env, jobject obj, jmethodID methodID, va_list args);
+		static void JNICALL CallVoidMethodA (JNIEnv *env, jobject obj, jmethodID methodID, const jvalue *args);
+		static jobject JNICALL CallStaticObjectMethodV (JNIEnv *env, jclass clazz, jmethodID methodID, va_list args);
+		static jobject JNICALL CallStaticObjectMethodA (JNIEnv *env, jclass clazz, jmethodID methodID, const jvalue *args);
+		static void JNICALL CallStaticVoidMethodV (JNIEnv *env, jclass clazz, jmethodID methodID, va_list args);
+		static void JNICALL CallStaticVoidMethodA (JNIEnv *env, jclass clazz, jmethodID methodID, const jvalue *args);
+		static jobjectArray JNICALL NewObjectArray (JNIEnv *env, jsize len, jclass clazz, jobject init);
+		static jobject JNICALL GetObjectArrayElement (JNIEnv *env, jobjectArray array, jsize index);
+		static void JNICALL SetObjectArrayElement (JNIEnv *env, jobjectArray array, jsize index, jobject val);
+		static jsize JNICALL GetArrayLength (JNIEnv *env, jarray array);
+		static jintArray JNICALL NewIntArray (JNIEnv *env, jsize len);
+		static void JNICALL GetIntArrayRegion (JNIEnv *env, jintArray array, jsize start, jsize len, jint *buf);
+		static void JNICALL SetIntArrayRegion (JNIEnv *env, jintArray array, jsize start, jsize len, const jint *buf);
+		static jbooleanArray JNICALL NewBooleanArray (JNIEnv *env, jsize len);
+		static void JNICALL GetBooleanArrayRegion (JNIEnv *env, jbooleanArray array, jsize start, jsize len, jboolean *buf);
+		static void JNICALL SetBooleanArrayRegion (JNIEnv *env, jbooleanArray array, jsize start, jsize len, const jboolean *buf);
+		static jstring JNICALL NewStringUTF (JNIEnv *env, const char *utf);
+		static const char* JNICALL GetStringUTFChars (JNIEnv *env, jstring str, jboolean *isCopy);
+		static void JNICALL ReleaseStringUTFChars (JNIEnv *env, jstring str, const char *chars);
+		static jboolean JNICALL ExceptionCheck (JNIEnv *env);
+		static jthrowable JNICALL ExceptionOccurred (JNIEnv *env);
+		static void JNICALL ExceptionDescribe (JNIEnv *env);
+		static void JNICALL ExceptionClear (JNIEnv *env);
+
+	private:
+		static inline FakeJvm *current = nullptr;
+		static constexpr size_t MAX_FUNCTION_TABLE_SIZE = 256;
+
+		EnvFunctions                              env_functions;
+		VMFunctions                               vm_functions;
+		JNIEnv                                    jni_env;
+		JavaVM                                    java_vm;
+
+		std::vector<std::unique_ptr<JavaClass>>   classes;
+		std::vector<JavaObject*>                  heap;
+		JavaObject                               *runtime_instance = nullptr;
+		JavaObject                               *pending_exception = nullptr;
+		jint                                      int_result = 0; // of the last method returning `int`
+		std::string                               pending_exception_message;
+
+		std::deque<Ref>                           refs;
+		Ref                                      *free_refs = nullptr;
+		std::array<size_t, 4>                     live_refs {};
+
+		JniPhase                                  phase = JniPhase::Other;
+		uint64_t                                  call_cost_ns = 0;
+		bool                                      time_calls = false;
+		JniCallStats                              stats {};
+	};
+
+	const char* jni_function_name (JniFunction fn) noexcept;
+}
+#endif // ndef __GC_BRIDGE_BENCH_FAKE_JNI_HH
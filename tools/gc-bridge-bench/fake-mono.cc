@@ -0,0 +1,247 @@
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include <mono/metadata/class.h>
+#include <mono/metadata/mono-gc.h>
+#include <mono/metadata/threads.h>
+
+#include "fake-mono.hh"
+
+using namespace xamarin::android::bench;
+
+struct _MonoDomain
+{
+	int  unused;
+};
+
+struct _MonoThread
+{
+	int  unused;
+};
+
+namespace {
+	MonoDomain  root_domain;
+	MonoThread  main_thread;
+	std::unordered_map<MonoClass*, std::unique_ptr<MonoVTable>> vtables;
+
+	MonoClassField*
+	add_instance_field (MonoClass *klass, const char *name, size_t offset, size_t size)
+	{
+		klass->fields.push_back (
+			std::make_unique<MonoClassField> (
+				MonoClassField {
+					.name = name,
+					.parent = klass,
+					.offset = offset,
+					.size = size,
+					.is_static = false,
+					.static_value = 0,
+				}
+			)
+		);
+
+		return klass->fields.back ().get ();
+	}
+}
+
+void
+FakeMono::initialize ()
+{
+	// The bridge types, see `OSBridge::mono_xa_gc_bridge_types` and `OSBridge::mono_ji_gc_bridge_types`
+	constexpr const char* bridge_types[][3] = {
+		{ "Java.Lang",     "Object",        "java/lang/Object" },
+		{ "Java.Lang",     "Throwable",     "java/lang/Throwable" },
+		{ "Java.Interop",  "JavaObject",    "java/lang/Object" },
+		{ "Java.Interop",  "JavaException", "java/lang/Throwable" },
+	};
+
+	for (auto const& type : bridge_types) {
+		MonoClass *klass = add_class (type[0], type[1], nullptr, type[2]);
+
+		add_instance_field (klass, "handle", offsetof (MonoObject, handle), sizeof (jobject));
+		add_instance_field (klass, "handle_type", offsetof (MonoObject, handle_type), sizeof (int));
+		add_instance_field (klass, "refs_added", offsetof (MonoObject, refs_added), sizeof (int));
+		add_instance_field (klass, "weak_handle", offsetof (MonoObject, weak_handle), sizeof (jobject));
+	}
+}
+
+MonoClass*
+FakeMono::add_class (const char *name_space, const char *name, MonoClass *parent, const char *java_class_name)
+{
+	classes.push_back (
+		std::make_unique<MonoClass> (
+			MonoClass {
+				.name_space = name_space,
+				.name = name,
+				.parent = parent,
+				.java_class_name = java_class_name != nullptr || parent == nullptr ? java_class_name : parent->java_class_name,
+				.fields = {},
+			}
+		)
+	);
+
+	return classes.back ().get ();
+}
+
+MonoClass*
+FakeMono::find_class (const char *name_space, const char *name)
+{
+	for (auto const& klass : classes) {
+		if (strcmp (klass->name_space, name_space) == 0 && strcmp (klass->name, name) == 0) {
+			return klass.get ();
+		}
+	}
+
+	return nullptr;
+}
+
+MonoClassField*
+FakeMono::add_static_field (MonoClass *klass, const char *name, size_t size)
+{
+	MonoClassField *field = add_instance_field (klass, name, 0, size);
+	field->is_static = true;
+
+	return field;
+}
+
+MonoObject*
+FakeMono::new_object (MonoClass *klass, jobject handle)
+{
+	return new MonoObject {
+		.klass = klass,
+		.handle = handle,
+		.handle_type = JNIGlobalRefType,
+		.refs_added = 0,
+		.weak_handle = nullptr,
+	};
+}
+
+void
+FakeMono::free_object (MonoObject *obj)
+{
+	delete obj;
+}
+
+MonoClass*
+mono_object_get_class (MonoObject *obj)
+{
+	return obj->klass;
+}
+
+void
+mono_field_get_value (MonoObject *obj, MonoClassField *field, void *value)
+{
+	if (field == nullptr || field->is_static) {
+		abort ();
+	}
+
+	memcpy (value, reinterpret_cast<char*>(obj) + field->offset, field->size);
+}
+
+void
+mono_field_set_value (MonoObject *obj, MonoClassField *field, void *value)
+{
+	if (field == nullptr || field->is_static) {
+		abort ();
+	}
+
+	memcpy (reinterpret_cast<char*>(obj) + field->offset, value, field->size);
+}
+
+void
+mono_field_static_set_value ([[maybe_unused]] MonoVTable *vt, MonoClassField *field, void *value)
+{
+	if (field == nullptr || !field->is_static || field->size > sizeof (field->static_value)) {
+		abort ();
+	}
+
+	memcpy (&field->static_value, value, field->size);
+	if (FakeMono::static_field_changed != nullptr) {
+		FakeMono::static_field_changed (field);
+	}
+}
+
+MonoVTable*
+mono_class_vtable ([[maybe_unused]] MonoDomain *domain, MonoClass *klass)
+{
+	std::unique_ptr<MonoVTable> &vtable = vtables [klass];
+	if (!vtable) {
+		vtable = std::make_unique<MonoVTable> (MonoVTable { .klass = klass });
+	}
+
+	return vtable.get ();
+}
+
+mono_bool
+mono_class_is_subclass_of (MonoClass *klass, MonoClass *klassc, [[maybe_unused]] mono_bool check_interfaces)
+{
+	for (MonoClass *k = klass; k != nullptr; k = k->parent) {
+		if (k == klassc) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+const char*
+mono_class_get_namespace (MonoClass *klass)
+{
+	return klass->name_space;
+}
+
+const char*
+mono_class_get_name (MonoClass *klass)
+{
+	return klass->name;
+}
+
+MonoClassField*
+mono_class_get_field_from_name (MonoClass *klass, const char *name)
+{
+	for (MonoClass *k = klass; k != nullptr; k = k->parent) {
+		for (auto const& field : k->fields) {
+			if (strcmp (field->name, name) == 0) {
+				return field.get ();
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+MonoDomain*
+mono_domain_get ()
+{
+	return &root_domain;
+}
+
+MonoThread*
+mono_thread_attach ([[maybe_unused]] MonoDomain *domain)
+{
+	return &main_thread;
+}
+
+void
+mono_gc_collect ([[maybe_unused]] int generation)
+{
+}
+
+int
+mono_gc_max_generation ()
+{
+	return 1;
+}
+
+void
+mono_gc_register_bridge_callbacks (MonoGCBridgeCallbacks *callbacks)
+{
+	FakeMono::set_bridge_callbacks (*callbacks);
+}
+
+void
+mono_profiler_set_gc_event_callback ([[maybe_unused]] MonoProfilerHandle handle, MonoProfilerGCEventCallback cb)
+{
+	FakeMono::set_gc_event_callback (cb);
+}
@@ -0,0 +1,99 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_FAKE_MONO_HH
+#define __GC_BRIDGE_BENCH_FAKE_MONO_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <jni.h>
+#include <mono/metadata/appdomain.h>
+#include <mono/metadata/profiler.h>
+#include <mono/metadata/sgen-bridge.h>
+
+struct _MonoClassField
+{
+	const char  *name;
+	MonoClass   *parent;
+	size_t       offset;        // instance fields only
+	size_t       size;
+	bool         is_static;
+	uint64_t     static_value;
+};
+
+struct _MonoClass
+{
+	const char                                    *name_space;
+	const char                                    *name;
+	MonoClass                                     *parent;
+	const char                                    *java_class_name; // Java peer class, `nullptr` if not a bridge class
+	std::vector<std::unique_ptr<MonoClassField>>   fields;
+};
+
+struct _MonoVTable
+{
+	MonoClass  *klass;
+};
+
+// Every managed object in the benchmark has the instance fields of `Java.Lang.Object`
+struct _MonoObject
+{
+	MonoClass  *klass;
+	jobject     handle;
+	int         handle_type;
+	int         refs_added;
+	jobject     weak_handle;
+};
+
+namespace xamarin::android::bench
+{
+	// Just enough of the Mono runtime for the GC bridge: classes with fields, objects and the bridge callbacks
+	class FakeMono
+	{
+	public:
+		static void initialize ();
+
+		static MonoClass* add_class (const char *name_space, const char *name, MonoClass *parent, const char *java_class_name = nullptr);
+		static MonoClass* find_class (const char *name_space, const char *name);
+		static MonoClassField* add_static_field (MonoClass *klass, const char *name, size_t size);
+
+		static MonoObject* new_object (MonoClass *klass, jobject handle);
+		static void free_object (MonoObject *obj);
+
+		static MonoGCBridgeCallbacks const& bridge_callbacks ()
+		{
+			return callbacks;
+		}
+
+		// Called by `mono_gc_register_bridge_callbacks`
+		static void set_bridge_callbacks (MonoGCBridgeCallbacks const& cbs)
+		{
+			callbacks = cbs;
+		}
+
+		// Called by `mono_profiler_set_gc_event_callback`
+		static void set_gc_event_callback (MonoProfilerGCEventCallback cb)
+		{
+			gc_event_callback = cb;
+		}
+
+		// Tells the profiler callbacks that a collection of `generation` starts, which is what SGen does before the
+		// bridge pass
+		static void start_collection (uint32_t generation)
+		{
+			if (gc_event_callback != nullptr) {
+				gc_event_callback (nullptr, MONO_GC_EVENT_START, generation, true /* is_serial */);
+			}
+		}
+
+		// Invoked whenever a static field changes, the benchmark uses it to follow `AndroidRuntimeInternal.BridgeProcessing`
+		static inline void (*static_field_changed) (MonoClassField *field) = nullptr;
+
+	private:
+		static inline std::vector<std::unique_ptr<MonoClass>>  classes;
+		static inline MonoGCBridgeCallbacks                    callbacks {};
+		static inline MonoProfilerGCEventCallback              gc_event_callback = nullptr;
+	};
+}
+#endif // ndef __GC_BRIDGE_BENCH_FAKE_MONO_HH
@@ -0,0 +1,131 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <android/log.h>
+
+#include "fake-mono.hh"
+#include "fake-runtime.hh"
+#include "globals.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::bench;
+using namespace xamarin::android::internal;
+
+FILE  *gref_log = nullptr;
+FILE  *lref_log = nullptr;
+bool   gref_to_logcat = false;
+bool   lref_to_logcat = false;
+
+OSBridge osBridge;
+
+namespace {
+	std::map<std::string, std::string, std::less<>> system_properties;
+
+	const char*
+	get_system_property (const char *name, size_t &len) noexcept
+	{
+		auto iter = system_properties.find (name);
+		if (iter == system_properties.end ()) {
+			return nullptr;
+		}
+
+		len = iter->second.length ();
+		return iter->second.c_str ();
+	}
+}
+
+MonoClass*
+Util::monodroid_get_class_from_name ([[maybe_unused]] MonoDomain *domain, [[maybe_unused]] const char* assembly, const char *_namespace, const char *type)
+{
+	return FakeMono::find_class (_namespace, type);
+}
+
+char*
+Util::monodroid_strdup_printf (const char *format, ...)
+{
+	va_list args;
+	char *ret = nullptr;
+
+	va_start (args, format);
+	if (vasprintf (&ret, format, args) < 0) {
+		ret = nullptr;
+	}
+	va_end (args);
+
+	return ret;
+}
+
+// The callers release the value with `free`
+int
+AndroidSystem::monodroid_get_system_property (const char *name, char **value) noexcept
+{
+	if (value != nullptr) {
+		*value = nullptr;
+	}
+
+	size_t len = 0;
+	const char *v = get_system_property (name, len);
+	if (v == nullptr) {
+		return 0;
+	}
+
+	if (value != nullptr) {
+		*value = strdup (v);
+	}
+	return static_cast<int>(len);
+}
+
+int
+AndroidSystem::monodroid_get_system_property (const char *name, dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> &value) noexcept
+{
+	size_t len = 0;
+	const char *v = get_system_property (name, len);
+	if (v == nullptr) {
+		return 0;
+	}
+
+	value.assign (v, len);
+	return static_cast<int>(len);
+}
+
+void
+AndroidSystem::set_system_property (const char *name, const char *value) noexcept
+{
+	system_properties [name] = value;
+}
+
+extern "C" int
+__android_log_vprint (int prio, const char *tag, const char *fmt, va_list ap)
+{
+	if (!FakeRuntime::is_verbose () && prio < ANDROID_LOG_WARN) {
+		return 0;
+	}
+
+	fprintf (stderr, "%s: ", tag);
+	int ret = vfprintf (stderr, fmt, ap);
+	fputc ('\n', stderr);
+
+	return ret;
+}
+
+extern "C" int
+__android_log_print (int prio, const char *tag, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start (args, fmt);
+	int ret = __android_log_vprint (prio, tag, fmt, args);
+	va_end (args);
+
+	return ret;
+}
+
+extern "C" int
+__android_log_write (int prio, const char *tag, const char *text)
+{
+	return __android_log_print (prio, tag, "%s", text);
+}
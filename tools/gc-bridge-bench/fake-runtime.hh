@@ -0,0 +1,26 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_FAKE_RUNTIME_HH
+#define __GC_BRIDGE_BENCH_FAKE_RUNTIME_HH
+
+namespace xamarin::android::bench
+{
+	// Settings of the pieces of the Xamarin.Android runtime replaced by the benchmark (logging, system properties)
+	class FakeRuntime
+	{
+	public:
+		// Informational and debug log messages are printed only in the verbose mode
+		static void set_verbose (bool yesno) noexcept
+		{
+			verbose = yesno;
+		}
+
+		static bool is_verbose () noexcept
+		{
+			return verbose;
+		}
+
+	private:
+		static inline bool verbose = false;
+	};
+}
+#endif // ndef __GC_BRIDGE_BENCH_FAKE_RUNTIME_HH
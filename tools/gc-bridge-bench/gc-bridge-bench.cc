@@ -0,0 +1,661 @@
+//
+// Runs the GC bridge `cross_references` callback of src/native/monodroid/osbridge.cc on synthetic SCC graphs, with a
+// fake JNI environment which counts (and optionally times) every JNI call made in each phase of the bridge pass.  See
+// README.md for the usage.
+//
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <execinfo.h>
+#include <getopt.h>
+
+#include <mono/metadata/class.h>
+#include <mono/metadata/mono-gc.h>
+
+#include "bridge-graph.hh"
+#include "fake-jni.hh"
+#include "fake-mono.hh"
+#include "fake-runtime.hh"
+#include "globals.hh"
+#include "gref-attribution.hh"
+
+using namespace xamarin::android;
+using namespace xamarin::android::bench;
+using namespace xamarin::android::internal;
+
+namespace {
+	constexpr size_t PHASE_COUNT = static_cast<size_t>(JniPhase::Count);
+	constexpr size_t FUNCTION_COUNT = static_cast<size_t>(JniFunction::Count);
+	constexpr size_t MAX_GREF_SITES = 10;
+
+	// Stands in for `xa_capture_native_frames` of the native tracing library
+	size_t
+	capture_native_frames (uintptr_t *frames, size_t max_frames, [[maybe_unused]] void *signal_context) noexcept
+	{
+		int count = backtrace (reinterpret_cast<void**>(frames), static_cast<int>(max_frames));
+		return count < 0 ? 0 : static_cast<size_t>(count);
+	}
+
+	struct Options
+	{
+		GraphShape           shape = GraphShape::Chain;
+		std::vector<size_t>  object_counts { 1000, 10000, 100000, 1000000 };
+		unsigned             iterations = 5;
+		unsigned             alive_percent = 50;
+		unsigned             peer_classes = 16;
+		uint64_t             jni_cost_ns = 0;
+		bool                 time_jni = false;
+		bool                 verbose = false;
+		bool                 csv = false;
+		bool                 details = false;
+		bool                 gref_attribution = false;
+		uint32_t             generation = 0;
+		double               max_jni_calls_per_object = 0;
+		std::optional<uint64_t> expected_java_gc_passes;
+		std::vector<std::pair<std::string, std::string>> properties;
+	};
+
+	// Totals over all the iterations of one configuration
+	struct Result
+	{
+		size_t    objects = 0;
+		size_t    sccs = 0;
+		size_t    xrefs = 0;
+		size_t    alive_objects = 0;
+		uint64_t  passes = 0;
+		uint64_t  java_gc_passes = 0;
+		uint64_t  wall_ns = 0;
+		uint64_t  phase_ns[PHASE_COUNT] {};
+		uint64_t  calls[PHASE_COUNT][FUNCTION_COUNT] {};
+		uint64_t  call_ns[PHASE_COUNT][FUNCTION_COUNT] {};
+		size_t    mismatches = 0;
+		size_t    leaked_local_refs = 0;
+
+		// Of the last pass, while its objects are still alive
+		std::vector<GrefAttribution::Entry> top_gref_sites;
+
+		uint64_t phase_calls (JniPhase phase) const noexcept
+		{
+			uint64_t total = 0;
+			for (uint64_t c : calls[static_cast<size_t>(phase)]) {
+				total += c;
+			}
+			return total;
+		}
+
+		uint64_t total_calls () const noexcept
+		{
+			uint64_t total = 0;
+			for (size_t p = 0; p < PHASE_COUNT; p++) {
+				total += phase_calls (static_cast<JniPhase>(p));
+			}
+			return total;
+		}
+	};
+
+	constexpr const char* phase_names[] = {
+		"other",
+		"prepare",
+		"java-gc",
+		"cleanup",
+	};
+	static_assert (std::size (phase_names) == PHASE_COUNT);
+
+	MonoClassField *bridge_processing_field = nullptr;
+
+	// Follows `AndroidRuntimeInternal.BridgeProcessing`, set by the bridge right before adding the Java references and
+	// reset after the cleanup.  The switch to `JavaGC` and `Cleanup` in between is done by the fake `Runtime.gc()`.
+	void
+	static_field_changed (MonoClassField *field)
+	{
+		if (field != bridge_processing_field) {
+			return;
+		}
+
+		FakeJvm::instance ().set_phase (field->static_value != 0 ? JniPhase::Prepare : JniPhase::Other);
+	}
+
+	[[noreturn]] void
+	usage (int exit_code)
+	{
+		FILE *out = exit_code == 0 ? stdout : stderr;
+
+		fputs (
+			"Usage: gc-bridge-bench [OPTIONS]\n"
+			"\n"
+			"Runs the Xamarin.Android GC bridge on synthetic graphs, with a fake JNI environment.\n"
+			"\n"
+			"Options:\n"
+			"  -s, --shape=SHAPE          Graph shape: chain, star or scc (default: chain)\n"
+			"  -n, --objects=N[,N...]     Numbers of bridge objects to run with (default: 1000,10000,100000,1000000)\n"
+			"  -i, --iterations=N         Bridge passes for each number of objects (default: 5)\n"
+			"  -a, --alive=PERCENT        Percentage of SCCs kept alive on the Java side (default: 50)\n"
+			"  -c, --peer-classes=N       Number of distinct peer classes (default: 16)\n"
+			"  -p, --property=NAME=VALUE  Set a system property, e.g. debug.mono.gc_bridge=java-gc=adaptive\n"
+			"  -g, --generation=N         Generation of the collections the bridge passes belong to: 0 for the nursery,\n"
+			"                             1 for full collections like GC.Collect () does (default: 0)\n"
+			"      --log=CATEGORIES       Enable runtime logging categories, comma separated: gc, gref, lref\n"
+			"      --jni-cost=NS          Simulated cost of a JNI call, in nanoseconds (default: 0)\n"
+			"      --time-jni             Measure the time spent in each JNI function\n"
+			"      --max-jni-calls-per-object=N\n"
+			"                             Exit with an error if a bridge pass makes more JNI calls per object\n"
+			"      --expect-java-gc-passes=N\n"
+			"                             Exit with an error if a different number of bridge passes runs the Java GC,\n"
+			"                             for each number of objects\n"
+			"      --csv                  Print the results as CSV\n"
+			"      --details              Print the JNI calls of every phase, by function\n"
+			"      --gref-attribution     Track the global references by site (see gref-attribution in debug.mono.log)\n"
+			"                             and print the sites with the most live references after the last pass\n"
+			"  -v, --verbose              Print the runtime log messages\n"
+			"  -h, --help                 Show this message\n",
+			out
+		);
+		exit (exit_code);
+	}
+
+	bool
+	parse_unsigned (const char *arg, uint64_t &value) noexcept
+	{
+		char *end;
+
+		errno = 0;
+		unsigned long long v = strtoull (arg, &end, 10);
+		if (errno != 0 || end == arg || *end != '\0') {
+			return false;
+		}
+
+		value = static_cast<uint64_t>(v);
+		return true;
+	}
+
+	unsigned
+	parse_unsigned_option (const char *name, const char *arg, uint64_t max = UINT32_MAX)
+	{
+		uint64_t value;
+
+		if (!parse_unsigned (arg, value) || value > max) {
+			fprintf (stderr, "Invalid value of %s: '%s'\n", name, arg);
+			usage (1);
+		}
+
+		return static_cast<unsigned>(value);
+	}
+
+	void
+	parse_object_counts (const char *arg, std::vector<size_t> &counts)
+	{
+		std::string list { arg };
+		size_t start = 0;
+
+		counts.clear ();
+		while (start <= list.length ()) {
+			size_t end = list.find (',', start);
+			if (end == std::string::npos) {
+				end = list.length ();
+			}
+
+			uint64_t count;
+			std::string item = list.substr (start, end - start);
+			if (!parse_unsigned (item.c_str (), count) || count == 0 || count > INT32_MAX) {
+				fprintf (stderr, "Invalid number of objects: '%s'\n", item.c_str ());
+				usage (1);
+			}
+
+			counts.push_back (static_cast<size_t>(count));
+			start = end + 1;
+		}
+	}
+
+	void
+	enable_logging (const char *arg)
+	{
+		std::string list { arg };
+		size_t start = 0;
+
+		while (start <= list.length ()) {
+			size_t end = list.find (',', start);
+			if (end == std::string::npos) {
+				end = list.length ();
+			}
+
+			std::string category = list.substr (start, end - start);
+			if (category == "gc") {
+				log_categories |= LOG_GC;
+			} else if (category == "gref") {
+				log_categories |= LOG_GREF;
+				gref_to_logcat = true;
+			} else if (category == "lref") {
+				log_categories |= LOG_LREF;
+				lref_to_logcat = true;
+			} else {
+				fprintf (stderr, "Unknown logging category: '%s'\n", category.c_str ());
+				usage (1);
+			}
+
+			start = end + 1;
+		}
+	}
+
+	Options
+	parse_options (int argc, char **argv)
+	{
+		enum {
+			OPT_LOG = 256,
+			OPT_JNI_COST,
+			OPT_TIME_JNI,
+			OPT_MAX_JNI_CALLS,
+			OPT_EXPECT_JAVA_GC_PASSES,
+			OPT_CSV,
+			OPT_DETAILS,
+			OPT_GREF_ATTRIBUTION,
+		};
+
+		static const option long_options[] = {
+			{ "shape",                     required_argument, nullptr, 's' },
+			{ "objects",                   required_argument, nullptr, 'n' },
+			{ "iterations",                required_argument, nullptr, 'i' },
+			{ "alive",                     required_argument, nullptr, 'a' },
+			{ "peer-classes",              required_argument, nullptr, 'c' },
+			{ "property",                  required_argument, nullptr, 'p' },
+			{ "generation",                required_argument, nullptr, 'g' },
+			{ "log",                       required_argument, nullptr, OPT_LOG },
+			{ "jni-cost",                  required_argument, nullptr, OPT_JNI_COST },
+			{ "time-jni",                  no_argument,       nullptr, OPT_TIME_JNI },
+			{ "max-jni-calls-per-object",  required_argument, nullptr, OPT_MAX_JNI_CALLS },
+			{ "expect-java-gc-passes",     required_argument, nullptr, OPT_EXPECT_JAVA_GC_PASSES },
+			{ "csv",                       no_argument,       nullptr, OPT_CSV },
+			{ "details",                   no_argument,       nullptr, OPT_DETAILS },
+			{ "gref-attribution",          no_argument,       nullptr, OPT_GREF_ATTRIBUTION },
+			{ "verbose",                   no_argument,       nullptr, 'v' },
+			{ "help",                      no_argument,       nullptr, 'h' },
+			{ nullptr,                     0,                 nullptr, 0 },
+		};
+
+		Options options;
+		int c;
+
+		while ((c = getopt_long (argc, argv, "s:n:i:a:c:p:g:vh", long_options, nullptr)) != -1) {
+			switch (c) {
+				case 's': {
+					std::optional<GraphShape> shape = parse_graph_shape (optarg);
+					if (!shape) {
+						fprintf (stderr, "Unknown graph shape: '%s'\n", optarg);
+						usage (1);
+					}
+					options.shape = shape.value ();
+					break;
+				}
+
+				case 'n':
+					parse_object_counts (optarg, options.object_counts);
+					break;
+
+				case 'i':
+					options.iterations = parse_unsigned_option ("--iterations", optarg);
+					break;
+
+				case 'a':
+					options.alive_percent = parse_unsigned_option ("--alive", optarg, 100);
+					break;
+
+				case 'c':
+					options.peer_classes = parse_unsigned_option ("--peer-classes", optarg, 1024);
+					break;
+
+				case 'p': {
+					const char *eq = strchr (optarg, '=');
+					if (eq == nullptr || eq == optarg) {
+						fprintf (stderr, "Invalid property: '%s', expected NAME=VALUE\n", optarg);
+						usage (1);
+					}
+					options.properties.emplace_back (std::string (optarg, static_cast<size_t>(eq - optarg)), std::string (eq + 1));
+					break;
+				}
+
+				case 'g':
+					options.generation = static_cast<uint32_t>(parse_unsigned_option ("--generation", optarg, static_cast<uint64_t>(mono_gc_max_generation ())));
+					break;
+
+				case OPT_EXPECT_JAVA_GC_PASSES:
+					options.expected_java_gc_passes = parse_unsigned_option ("--expect-java-gc-passes", optarg);
+					break;
+
+				case OPT_LOG:
+					enable_logging (optarg);
+					break;
+
+				case OPT_JNI_COST:
+					options.jni_cost_ns = parse_unsigned_option ("--jni-cost", optarg);
+					break;
+
+				case OPT_TIME_JNI:
+					options.time_jni = true;
+					break;
+
+				case OPT_MAX_JNI_CALLS:
+					options.max_jni_calls_per_object = strtod (optarg, nullptr);
+					if (options.max_jni_calls_per_object <= 0) {
+						fprintf (stderr, "Invalid value of --max-jni-calls-per-object: '%s'\n", optarg);
+						usage (1);
+					}
+					break;
+
+				case OPT_CSV:
+					options.csv = true;
+					break;
+
+				case OPT_DETAILS:
+					options.details = true;
+					break;
+
+				case OPT_GREF_ATTRIBUTION:
+					options.gref_attribution = true;
+					break;
+
+				case 'v':
+					options.verbose = true;
+					break;
+
+				case 'h':
+					usage (0);
+
+				default:
+					usage (1);
+			}
+		}
+
+		if (optind < argc) {
+			fprintf (stderr, "Unexpected argument: '%s'\n", argv[optind]);
+			usage (1);
+		}
+
+		if (options.iterations == 0 || options.peer_classes == 0) {
+			fprintf (stderr, "The numbers of iterations and peer classes must be greater than 0\n");
+			usage (1);
+		}
+
+		return options;
+	}
+
+	// Same as what `MonodroidRuntime::init_android_runtime` and `MonodroidRuntime::create_and_initialize_domain` do
+	// for the GC bridge
+	std::vector<PeerType>
+	initialize_bridge (FakeJvm &jvm, Options const& options)
+	{
+		FakeMono::static_field_changed = static_field_changed;
+		FakeMono::initialize ();
+
+		MonoClass *runtime_internal = FakeMono::add_class ("Android.Runtime", "AndroidRuntimeInternal", nullptr);
+		bridge_processing_field = FakeMono::add_static_field (runtime_internal, "BridgeProcessing", sizeof (mono_bool));
+
+		for (auto const& [name, value] : options.properties) {
+			AndroidSystem::set_system_property (name.c_str (), value.c_str ());
+		}
+
+		JNIEnv *env = jvm.env ();
+		osBridge.initialize_on_onload (jvm.vm (), env);
+
+		jclass runtime_class = env->FindClass ("mono/android/Runtime");
+		osBridge.initialize_on_runtime_init (env, runtime_class);
+		env->DeleteLocalRef (runtime_class);
+
+		osBridge.register_gc_hooks (nullptr /* profiler */);
+		osBridge.add_monodroid_domain (mono_domain_get ());
+		if (options.gref_attribution) {
+			GrefAttribution::enable (env, capture_native_frames);
+		}
+
+		for (uint32_t i = 0; i < OSBridge::NUM_GC_BRIDGE_TYPES; i++) {
+			OSBridge::MonoJavaGCBridgeType const& type = osBridge.get_java_gc_bridge_type (i);
+			OSBridge::MonoJavaGCBridgeInfo &info = osBridge.get_java_gc_bridge_info (i);
+
+			info.klass = FakeMono::find_class (type._namespace, type._typename);
+			info.handle = mono_class_get_field_from_name (info.klass, "handle");
+			info.handle_type = mono_class_get_field_from_name (info.klass, "handle_type");
+			info.refs_added = mono_class_get_field_from_name (info.klass, "refs_added");
+			info.weak_handle = mono_class_get_field_from_name (info.klass, "weak_handle");
+		}
+		osBridge.invalidate_gc_bridge_class_cache ();
+
+		MonoClass *java_lang_object = FakeMono::find_class ("Java.Lang", "Object");
+		std::vector<PeerType> peer_types;
+		for (unsigned i = 0; i < options.peer_classes; i++) {
+			std::string name = "Peer" + std::to_string (i);
+			std::string java_name = "bench/" + name;
+
+			peer_types.push_back ({
+				.mono_class = FakeMono::add_class ("Bench", strdup (name.c_str ()), java_lang_object, strdup (java_name.c_str ())),
+				.java_class = jvm.define_peer_class (java_name),
+			});
+		}
+
+		if (jvm.live_local_refs () != 0) {
+			fprintf (stderr, "Bridge initialization leaked %zu local references\n", jvm.live_local_refs ());
+			exit (1);
+		}
+
+		return peer_types;
+	}
+
+	uint64_t
+	elapsed_ns (std::chrono::steady_clock::time_point start)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - start).count ());
+	}
+
+	Result
+	run (FakeJvm &jvm, std::vector<PeerType> const& peer_types, Options const& options, size_t object_count)
+	{
+		MonoGCBridgeCallbacks const& callbacks = FakeMono::bridge_callbacks ();
+		Result result;
+
+		for (unsigned iteration = 0; iteration < options.iterations; iteration++) {
+			BridgeGraph graph (jvm, peer_types, options.shape, object_count, options.alive_percent, iteration + 1);
+
+			OSBridge::GCBridgeStats before, after;
+			osBridge.get_gc_bridge_stats (before);
+			jvm.reset_call_stats ();
+
+			FakeMono::start_collection (options.generation);
+
+			auto start = std::chrono::steady_clock::now ();
+			callbacks.cross_references (graph.num_sccs (), graph.get_sccs (), graph.num_xrefs (), graph.get_xrefs ());
+			result.wall_ns += elapsed_ns (start);
+
+			osBridge.get_gc_bridge_stats (after);
+
+			bool java_gc_ran = after.java_gc_forced != before.java_gc_forced;
+			for (size_t p = static_cast<size_t>(JniPhase::Prepare); p < PHASE_COUNT; p++) {
+				result.phase_ns[p] += after.phases[p].total_ns - before.phases[p].total_ns;
+			}
+
+			JniCallStats const& stats = jvm.call_stats ();
+			for (size_t p = 0; p < PHASE_COUNT; p++) {
+				for (size_t f = 0; f < FUNCTION_COUNT; f++) {
+					result.calls[p][f] += stats.calls[p][f];
+					result.call_ns[p][f] += stats.ns[p][f];
+				}
+			}
+
+			result.objects = graph.object_count ();
+			result.sccs = static_cast<size_t>(graph.num_sccs ());
+			result.xrefs = static_cast<size_t>(graph.num_xrefs ());
+			result.alive_objects = graph.expected_alive_objects ();
+			result.passes++;
+			if (java_gc_ran) {
+				result.java_gc_passes++;
+			}
+			result.mismatches += graph.verify (java_gc_ran);
+			if (options.gref_attribution && iteration + 1 == options.iterations) {
+				result.top_gref_sites.resize (MAX_GREF_SITES);
+				result.top_gref_sites.resize (GrefAttribution::get_top_sites (jvm.env (), result.top_gref_sites.data (), MAX_GREF_SITES));
+			}
+			result.leaked_local_refs += jvm.live_local_refs ();
+			jvm.delete_local_refs ();
+		}
+
+		return result;
+	}
+
+	double
+	per_pass_ms (Result const& result, uint64_t ns)
+	{
+		return static_cast<double>(ns) / static_cast<double>(result.passes) / 1e6;
+	}
+
+	double
+	per_object (Result const& result, uint64_t calls)
+	{
+		return static_cast<double>(calls) / static_cast<double>(result.passes) / static_cast<double>(result.objects);
+	}
+
+	void
+	print_header (Options const& options)
+	{
+		if (options.csv) {
+			puts ("shape,objects,sccs,xrefs,alive_objects,passes,java_gc_passes,wall_ms,prepare_ms,java_gc_ms,cleanup_ms,prepare_jni_calls,java_gc_jni_calls,cleanup_jni_calls,jni_calls_per_object");
+			return;
+		}
+
+		printf (
+			"%-6s %9s %9s %9s %9s %10s %10s %10s %10s %10s %10s %10s %8s\n",
+			"shape", "objects", "sccs", "xrefs", "alive",
+			"wall ms", "prepare", "java gc", "cleanup",
+			"prep jni", "gc jni", "clean jni", "jni/obj"
+		);
+	}
+
+	void
+	print_result (Options const& options, Result const& result)
+	{
+		auto calls_per_pass = [&result](JniPhase phase) {
+			return result.phase_calls (phase) / result.passes;
+		};
+
+		if (options.csv) {
+			printf (
+				"%s,%zu,%zu,%zu,%zu,%" PRIu64 ",%" PRIu64 ",%.3f,%.3f,%.3f,%.3f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.2f\n",
+				graph_shape_name (options.shape), result.objects, result.sccs, result.xrefs, result.alive_objects,
+				result.passes, result.java_gc_passes,
+				per_pass_ms (result, result.wall_ns),
+				per_pass_ms (result, result.phase_ns[static_cast<size_t>(JniPhase::Prepare)]),
+				per_pass_ms (result, result.phase_ns[static_cast<size_t>(JniPhase::JavaGC)]),
+				per_pass_ms (result, result.phase_ns[static_cast<size_t>(JniPhase::Cleanup)]),
+				calls_per_pass (JniPhase::Prepare), calls_per_pass (JniPhase::JavaGC), calls_per_pass (JniPhase::Cleanup),
+				per_object (result, result.total_calls ())
+			);
+			return;
+		}
+
+		printf (
+			"%-6s %9zu %9zu %9zu %9zu %10.3f %10.3f %10.3f %10.3f %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %8.2f\n",
+			graph_shape_name (options.shape), result.objects, result.sccs, result.xrefs, result.alive_objects,
+			per_pass_ms (result, result.wall_ns),
+			per_pass_ms (result, result.phase_ns[static_cast<size_t>(JniPhase::Prepare)]),
+			per_pass_ms (result, result.phase_ns[static_cast<size_t>(JniPhase::JavaGC)]),
+			per_pass_ms (result, result.phase_ns[static_cast<size_t>(JniPhase::Cleanup)]),
+			calls_per_pass (JniPhase::Prepare), calls_per_pass (JniPhase::JavaGC), calls_per_pass (JniPhase::Cleanup),
+			per_object (result, result.total_calls ())
+		);
+	}
+
+	void
+	print_details (Options const& options, Result const& result)
+	{
+		if (options.csv) {
+			return;
+		}
+
+		printf ("  JNI calls per pass with %zu objects:\n", result.objects);
+		for (size_t p = 0; p < PHASE_COUNT; p++) {
+			if (result.phase_calls (static_cast<JniPhase>(p)) == 0) {
+				continue;
+			}
+
+			printf ("    %s\n", phase_names[p]);
+			for (size_t f = 0; f < FUNCTION_COUNT; f++) {
+				if (result.calls[p][f] == 0) {
+					continue;
+				}
+
+				printf ("      %-24s %12" PRIu64, jni_function_name (static_cast<JniFunction>(f)), result.calls[p][f] / result.passes);
+				if (options.time_jni) {
+					printf (" %12.3f ms", per_pass_ms (result, result.call_ns[p][f]));
+				}
+				putchar ('\n');
+			}
+		}
+	}
+
+	void
+	print_gref_attribution (Result const& result)
+	{
+		printf ("  global reference sites with the most live references (live grefs, live weak grefs, total created):\n");
+		for (GrefAttribution::Entry const& e : result.top_gref_sites) {
+			printf ("  %8d %8d %10" PRIu64 "  %s [stack %016" PRIx64 "]\n", e.live_grefs, e.live_weak_grefs, e.total_created, e.class_name, e.stack_hash);
+			if (e.stack != nullptr) {
+				printf ("%s\n", e.stack);
+			}
+		}
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	Options options = parse_options (argc, argv);
+	FakeRuntime::set_verbose (options.verbose);
+
+	FakeJvm jvm;
+	std::vector<PeerType> peer_types = initialize_bridge (jvm, options);
+
+	jvm.reset_call_stats ();
+	jvm.set_call_cost_ns (options.jni_cost_ns);
+	jvm.set_time_calls (options.time_jni);
+
+	int ret = 0;
+	print_header (options);
+	for (size_t object_count : options.object_counts) {
+		Result result = run (jvm, peer_types, options, object_count);
+
+		print_result (options, result);
+		if (options.details) {
+			print_details (options, result);
+		}
+		if (options.gref_attribution && !options.csv) {
+			print_gref_attribution (result);
+		}
+		fflush (stdout);
+
+		if (result.mismatches != 0) {
+			fprintf (stderr, "%zu SCCs with %zu objects didn't end up as the Java side expected\n", result.mismatches, object_count);
+			ret = 1;
+		}
+
+		if (result.leaked_local_refs != 0) {
+			fprintf (stderr, "Bridge passes with %zu objects leaked %zu local references\n", object_count, result.leaked_local_refs);
+			ret = 1;
+		}
+
+		if (options.expected_java_gc_passes && result.java_gc_passes != options.expected_java_gc_passes.value ()) {
+			fprintf (stderr, "%" PRIu64 " bridge passes with %zu objects ran the Java GC, expected %" PRIu64 "\n", result.java_gc_passes, object_count, options.expected_java_gc_passes.value ());
+			ret = 1;
+		}
+
+		double calls_per_object = per_object (result, result.total_calls ());
+		if (options.max_jni_calls_per_object > 0 && calls_per_object > options.max_jni_calls_per_object) {
+			fprintf (stderr, "Bridge passes with %zu objects made %.2f JNI calls per object, more than the allowed %.2f\n", object_count, calls_per_object, options.max_jni_calls_per_object);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,62 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// Replaces src/native/runtime-base/android-system.hh.  System properties come from the benchmark command line, see
+// `AndroidSystem::set_system_property`.  Implemented by fake-runtime.cc
+//
+#ifndef ANDROID_SYSTEM_HH
+#define ANDROID_SYSTEM_HH
+
+#include <climits>
+#include <cstdio>
+#include <string_view>
+
+#include "strings.hh"
+
+static inline constexpr size_t PROPERTY_VALUE_BUFFER_LEN = 92 + 1;
+
+extern  FILE  *gref_log;
+extern  FILE  *lref_log;
+extern  bool   gref_to_logcat;
+extern  bool   lref_to_logcat;
+
+namespace xamarin::android::internal
+{
+	class AndroidSystem
+	{
+	public:
+		static int monodroid_get_system_property (const char *name, char **value) noexcept;
+		static int monodroid_get_system_property (const char *name, dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN> &value) noexcept;
+
+		static int monodroid_get_system_property (std::string_view const& name, char **value) noexcept
+		{
+			return monodroid_get_system_property (name.data (), value);
+		}
+
+		static int monodroid_get_system_property (std::string_view const& name, dynamic_local_string<PROPERTY_VALUE_BUFFER_LEN>& value) noexcept
+		{
+			return monodroid_get_system_property (name.data (), value);
+		}
+
+		static void set_system_property (const char *name, const char *value) noexcept;
+
+		// No limit by default, so that the "running out of global references" heuristics stay out of the way
+		static long get_max_gref_count () noexcept
+		{
+			return max_gref_count;
+		}
+
+		static void set_max_gref_count (long count) noexcept
+		{
+			max_gref_count = count;
+		}
+
+		static long get_gref_gc_threshold () noexcept
+		{
+			return max_gref_count == INT_MAX ? max_gref_count : max_gref_count * 90 / 100;
+		}
+
+	private:
+		static inline long max_gref_count = INT_MAX;
+	};
+}
+#endif // !ANDROID_SYSTEM_HH
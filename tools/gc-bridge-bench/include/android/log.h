@@ -0,0 +1,28 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// Stand-in for the NDK logging API, the messages go to stderr (see fake-runtime.cc)
+//
+#ifndef __GC_BRIDGE_BENCH_ANDROID_LOG_H
+#define __GC_BRIDGE_BENCH_ANDROID_LOG_H
+
+#include <cstdarg>
+
+typedef enum android_LogPriority {
+	ANDROID_LOG_UNKNOWN = 0,
+	ANDROID_LOG_DEFAULT,
+	ANDROID_LOG_VERBOSE,
+	ANDROID_LOG_DEBUG,
+	ANDROID_LOG_INFO,
+	ANDROID_LOG_WARN,
+	ANDROID_LOG_ERROR,
+	ANDROID_LOG_FATAL,
+	ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+extern "C" {
+	int __android_log_write (int prio, const char *tag, const char *text);
+	int __android_log_print (int prio, const char *tag, const char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+	int __android_log_vprint (int prio, const char *tag, const char *fmt, va_list ap);
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_ANDROID_LOG_H
@@ -0,0 +1,16 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// Replaces src/native/monodroid/globals.hh, which pulls in the whole runtime.  Only the OSBridge instance is global
+// in the benchmark.
+//
+#ifndef __GLOBALS_H
+#define __GLOBALS_H
+
+#include "android-system.hh"
+#include "logger.hh"
+#include "osbridge.hh"
+#include "util.hh"
+
+extern xamarin::android::internal::OSBridge osBridge;
+
+#endif // !__GLOBALS_H
@@ -0,0 +1,11 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_MONO_APPDOMAIN_H
+#define __GC_BRIDGE_BENCH_MONO_APPDOMAIN_H
+
+#include <mono/metadata/object.h>
+
+extern "C" {
+	MonoDomain* mono_domain_get ();
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_APPDOMAIN_H
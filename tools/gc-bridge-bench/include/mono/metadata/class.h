@@ -0,0 +1,14 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_MONO_CLASS_H
+#define __GC_BRIDGE_BENCH_MONO_CLASS_H
+
+#include <mono/metadata/object.h>
+
+extern "C" {
+	mono_bool mono_class_is_subclass_of (MonoClass *klass, MonoClass *klassc, mono_bool check_interfaces);
+	const char* mono_class_get_namespace (MonoClass *klass);
+	const char* mono_class_get_name (MonoClass *klass);
+	MonoClassField* mono_class_get_field_from_name (MonoClass *klass, const char *name);
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_CLASS_H
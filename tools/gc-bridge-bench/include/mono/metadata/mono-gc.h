@@ -0,0 +1,10 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_MONO_GC_H
+#define __GC_BRIDGE_BENCH_MONO_GC_H
+
+extern "C" {
+	void mono_gc_collect (int generation);
+	int mono_gc_max_generation ();
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_GC_H
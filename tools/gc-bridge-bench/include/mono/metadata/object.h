@@ -0,0 +1,38 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// Stand-in for the Mono embedding API headers, declares just what the GC bridge code uses.  Implemented by
+// fake-mono.cc
+//
+#ifndef __GC_BRIDGE_BENCH_MONO_OBJECT_H
+#define __GC_BRIDGE_BENCH_MONO_OBJECT_H
+
+#include <cstdint>
+
+#if !defined (TRUE)
+#define TRUE 1
+#endif
+
+#if !defined (FALSE)
+#define FALSE 0
+#endif
+
+#define MONO_ZERO_LEN_ARRAY 0
+
+typedef int32_t mono_bool;
+
+typedef struct _MonoObject      MonoObject;
+typedef struct _MonoClass       MonoClass;
+typedef struct _MonoClassField  MonoClassField;
+typedef struct _MonoVTable      MonoVTable;
+typedef struct _MonoDomain      MonoDomain;
+typedef struct _MonoThread      MonoThread;
+
+extern "C" {
+	MonoClass* mono_object_get_class (MonoObject *obj);
+	void mono_field_get_value (MonoObject *obj, MonoClassField *field, void *value);
+	void mono_field_set_value (MonoObject *obj, MonoClassField *field, void *value);
+	void mono_field_static_set_value (MonoVTable *vt, MonoClassField *field, void *value);
+	MonoVTable* mono_class_vtable (MonoDomain *domain, MonoClass *klass);
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_OBJECT_H
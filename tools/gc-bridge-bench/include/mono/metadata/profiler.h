@@ -0,0 +1,32 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// The part of the profiler API which the GC bridge uses, with the same values as the real profiler.h
+//
+#ifndef __GC_BRIDGE_BENCH_MONO_PROFILER_H
+#define __GC_BRIDGE_BENCH_MONO_PROFILER_H
+
+#include <cstdint>
+
+#include <mono/metadata/object.h>
+
+typedef struct _MonoProfiler MonoProfiler;
+typedef struct _MonoProfilerDesc *MonoProfilerHandle;
+
+typedef enum {
+	MONO_GC_EVENT_PRE_STOP_WORLD = 6,
+	MONO_GC_EVENT_PRE_STOP_WORLD_LOCKED = 10,
+	MONO_GC_EVENT_POST_STOP_WORLD = 7,
+	MONO_GC_EVENT_START = 0,
+	MONO_GC_EVENT_END = 5,
+	MONO_GC_EVENT_PRE_START_WORLD = 8,
+	MONO_GC_EVENT_POST_START_WORLD = 9,
+	MONO_GC_EVENT_POST_START_WORLD_UNLOCKED = 11,
+} MonoProfilerGCEvent;
+
+typedef void (*MonoProfilerGCEventCallback) (MonoProfiler *prof, MonoProfilerGCEvent event, uint32_t generation, mono_bool is_serial);
+
+extern "C" {
+	void mono_profiler_set_gc_event_callback (MonoProfilerHandle handle, MonoProfilerGCEventCallback cb);
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_PROFILER_H
@@ -0,0 +1,41 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// Same layout as the real sgen-bridge.h, so that the bridge callbacks see exactly what SGen passes to them
+//
+#ifndef __GC_BRIDGE_BENCH_MONO_SGEN_BRIDGE_H
+#define __GC_BRIDGE_BENCH_MONO_SGEN_BRIDGE_H
+
+#include <mono/metadata/object.h>
+
+#define SGEN_BRIDGE_VERSION 5
+
+typedef enum {
+	GC_BRIDGE_TRANSPARENT_CLASS,
+	GC_BRIDGE_OPAQUE_CLASS,
+	GC_BRIDGE_TRANSPARENT_BRIDGE_CLASS,
+	GC_BRIDGE_OPAQUE_BRIDGE_CLASS,
+} MonoGCBridgeObjectKind;
+
+typedef struct {
+	mono_bool is_alive;
+	int num_objs;
+	MonoObject *objs [MONO_ZERO_LEN_ARRAY];
+} MonoGCBridgeSCC;
+
+typedef struct {
+	int src_scc_index;
+	int dst_scc_index;
+} MonoGCBridgeXRef;
+
+typedef struct {
+	int bridge_version;
+	MonoGCBridgeObjectKind (*bridge_class_kind) (MonoClass *klass);
+	mono_bool (*is_bridge_object) (MonoObject *object);
+	void (*cross_references) (int num_sccs, MonoGCBridgeSCC **sccs, int num_xrefs, MonoGCBridgeXRef *xrefs);
+} MonoGCBridgeCallbacks;
+
+extern "C" {
+	void mono_gc_register_bridge_callbacks (MonoGCBridgeCallbacks *callbacks);
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_SGEN_BRIDGE_H
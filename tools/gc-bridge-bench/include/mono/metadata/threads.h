@@ -0,0 +1,11 @@
+// Dear Emacs, this is a -*- C++ -*- header
+#ifndef __GC_BRIDGE_BENCH_MONO_THREADS_H
+#define __GC_BRIDGE_BENCH_MONO_THREADS_H
+
+#include <mono/metadata/object.h>
+
+extern "C" {
+	MonoThread* mono_thread_attach (MonoDomain *domain);
+}
+
+#endif // ndef __GC_BRIDGE_BENCH_MONO_THREADS_H
@@ -0,0 +1,58 @@
+// Dear Emacs, this is a -*- C++ -*- header
+//
+// Replaces src/native/runtime-base/util.hh, declares just the members used by the GC bridge code.  Implemented by
+// fake-runtime.cc
+//
+#ifndef __MONODROID_UTIL_H__
+#define __MONODROID_UTIL_H__
+
+#include <cstring>
+
+#include <mono/metadata/appdomain.h>
+
+#include "helpers.hh"
+#include "log_types.hh"
+
+namespace xamarin::android
+{
+	class Util
+	{
+	public:
+		static MonoClass *monodroid_get_class_from_name (MonoDomain *domain, const char* assembly, const char *_namespace, const char *type);
+		static char *monodroid_strdup_printf (const char *format, ...);
+
+		static char *strdup_new (const char* s, size_t len) noexcept
+		{
+			if (len == 0 || s == nullptr) [[unlikely]] {
+				return nullptr;
+			}
+
+			size_t alloc_size = Helpers::add_with_overflow_check<size_t> (len, 1);
+			auto ret = new char[alloc_size];
+			memcpy (ret, s, len);
+			ret[len] = '\0';
+
+			return ret;
+		}
+
+		static char *strdup_new (const char* s) noexcept
+		{
+			if (s == nullptr) [[unlikely]] {
+				return nullptr;
+			}
+
+			return strdup_new (s, strlen (s));
+		}
+
+		static bool should_log (LogCategories category) noexcept
+		{
+			return (log_categories & category) != 0;
+		}
+
+		static MonoDomain *get_current_domain ([[maybe_unused]] bool attach_thread_if_needed = true) noexcept
+		{
+			return mono_domain_get ();
+		}
+	};
+}
+#endif // __MONODROID_UTIL_H__
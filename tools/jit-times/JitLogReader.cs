@@ -0,0 +1,170 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace jittimes {
+	// Must be kept in sync with JitEventKind in src/native/monodroid/jit-event-log.hh
+	public enum JitEventKind : byte {
+		Begin  = 0,
+		Done   = 1,
+		Failed = 2,
+	}
+
+	public class JitImage {
+		public uint id;
+		public string name;
+		public string mvid;
+	}
+
+	public class JitEvent {
+		public int threadId;
+		public ulong timestampNs;
+		public uint methodToken;
+		public string methodName;   // full name of a method without a token, null otherwise
+		public JitImage image;
+		public JitEventKind kind;
+	}
+
+	// Reads the binary JIT event log written by JitEventLog (see src/native/monodroid/jit-event-log.hh for the
+	// description of the format)
+	public class JitLogReader : IDisposable {
+		const string Magic = "XAJITLOG";
+		const uint SupportedVersion = 1;
+
+		const byte TagImage   = 1;
+		const byte TagString  = 2;
+		const byte TagEvents  = 3;
+		const byte TagDropped = 4;
+
+		readonly BinaryReader reader;
+		readonly Dictionary<uint, JitImage> images = new Dictionary<uint, JitImage> ();
+		readonly Dictionary<uint, string> strings = new Dictionary<uint, string> ();
+
+		public ulong StartNs { get; }
+		public ulong DroppedEvents { get; private set; }
+		public bool Truncated { get; private set; }
+
+		public static bool IsBinaryLog (string path)
+		{
+			using (var stream = File.OpenRead (path)) {
+				var buffer = new byte [Magic.Length];
+				return stream.Read (buffer, 0, buffer.Length) == buffer.Length && Encoding.ASCII.GetString (buffer) == Magic;
+			}
+		}
+
+		public JitLogReader (string path)
+		{
+			reader = new BinaryReader (File.OpenRead (path));
+
+			var magic = Encoding.ASCII.GetString (reader.ReadBytes (Magic.Length));
+			if (magic != Magic)
+				throw new InvalidDataException ($"`{path}` is not a binary JIT event log file");
+
+			uint version = reader.ReadUInt32 ();
+			if (version != SupportedVersion)
+				throw new InvalidDataException ($"Unsupported binary JIT event log version {version}, expected {SupportedVersion}");
+			reader.ReadUInt32 (); // reserved
+			StartNs = reader.ReadUInt64 ();
+		}
+
+		public void Dispose ()
+		{
+			reader.Dispose ();
+		}
+
+		public IEnumerable<JitEvent> ReadEvents ()
+		{
+			for (;;) {
+				List<JitEvent> events;
+				try {
+					events = ReadNextEvents ();
+				} catch (EndOfStreamException) {
+					// The application was most likely killed while the log was being flushed
+					Truncated = true;
+					yield break;
+				}
+
+				if (events == null)
+					yield break;
+
+				foreach (var e in events)
+					yield return e;
+			}
+		}
+
+		List<JitEvent> ReadNextEvents ()
+		{
+			for (;;) {
+				int tag = reader.BaseStream.ReadByte ();
+				switch (tag) {
+					case -1:
+						return null;
+
+					case TagImage:
+						var image = new JitImage {
+							id   = reader.ReadUInt32 (),
+							name = ReadString (),
+							mvid = ReadString (),
+						};
+						images [image.id] = image;
+						break;
+
+					case TagString:
+						uint id = reader.ReadUInt32 ();
+						strings [id] = ReadString ();
+						break;
+
+					case TagDropped:
+						DroppedEvents = reader.ReadUInt64 ();
+						break;
+
+					case TagEvents:
+						int threadId = reader.ReadInt32 ();
+						uint count = reader.ReadUInt32 ();
+						var events = new List<JitEvent> ((int)count);
+
+						for (uint i = 0; i < count; i++) {
+							var e = new JitEvent {
+								threadId    = threadId,
+								timestampNs = reader.ReadUInt64 (),
+								methodToken = reader.ReadUInt32 (),
+							};
+							uint nameId = reader.ReadUInt32 ();
+							uint imageId = reader.ReadUInt32 ();
+							e.kind = (JitEventKind)reader.ReadByte ();
+							reader.ReadBytes (3); // reserved
+
+							e.methodName = nameId == 0 ? null : GetString (nameId);
+							if (!images.TryGetValue (imageId, out e.image))
+								throw new InvalidDataException ($"Reference to undefined image {imageId}");
+
+							events.Add (e);
+						}
+						return events;
+
+					default:
+						throw new InvalidDataException ($"Unknown entry tag {tag} at offset {reader.BaseStream.Position - 1}");
+				}
+			}
+		}
+
+		string ReadString ()
+		{
+			uint length = reader.ReadUInt32 ();
+			byte[] bytes = reader.ReadBytes ((int)length);
+			if (bytes.Length != length)
+				throw new EndOfStreamException ();
+
+			return Encoding.UTF8.GetString (bytes);
+		}
+
+		string GetString (uint id)
+		{
+			if (!strings.TryGetValue (id, out var value))
+				throw new InvalidDataException ($"Reference to undefined string {id}");
+
+			return value;
+		}
+	}
+}
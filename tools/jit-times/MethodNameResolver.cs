@@ -0,0 +1,191 @@
+using System;
+using System.Collections.Generic;
+using System.Collections.Immutable;
+using System.IO;
+using System.Linq;
+using System.Reflection.Metadata;
+using System.Reflection.Metadata.Ecma335;
+using System.Reflection.PortableExecutable;
+
+namespace jittimes {
+	// Turns the method tokens of the binary JIT event log into names, in the format of `mono_method_full_name` which
+	// `methods.txt` uses, by looking them up in the application's assemblies.  Assemblies are matched by their MVID,
+	// falling back to the name (with a warning, the token may then point to a different method).
+	public class MethodNameResolver {
+		readonly Dictionary<Guid, MetadataReader> assembliesByMvid = new Dictionary<Guid, MetadataReader> ();
+		readonly Dictionary<string, MetadataReader> assembliesByName = new Dictionary<string, MetadataReader> (StringComparer.OrdinalIgnoreCase);
+		readonly Dictionary<(uint, uint), string> cache = new Dictionary<(uint, uint), string> ();
+		readonly HashSet<uint> reportedImages = new HashSet<uint> ();
+
+		public void AddAssemblies (string directory)
+		{
+			foreach (var path in Directory.EnumerateFiles (directory, "*.dll")) {
+				try {
+					var peReader = new PEReader (File.OpenRead (path));
+					if (!peReader.HasMetadata)
+						continue;
+
+					var reader = peReader.GetMetadataReader ();
+					var mvid = reader.GetGuid (reader.GetModuleDefinition ().Mvid);
+
+					assembliesByMvid [mvid] = reader;
+					assembliesByName [Path.GetFileNameWithoutExtension (path)] = reader;
+				} catch (BadImageFormatException) {
+					// Not a managed assembly (or compressed), ignore it
+				}
+			}
+		}
+
+		public string GetMethodName (JitEvent e)
+		{
+			if (e.methodName != null)
+				return e.methodName;
+
+			var key = (e.image.id, e.methodToken);
+			if (cache.TryGetValue (key, out var name))
+				return name;
+
+			var reader = FindAssembly (e.image);
+			name = reader != null ? FormatMethod (reader, e.methodToken) : null;
+			name ??= $"[{e.image.name}] 0x{e.methodToken:x8}";
+
+			cache [key] = name;
+			return name;
+		}
+
+		MetadataReader FindAssembly (JitImage image)
+		{
+			if (Guid.TryParse (image.mvid, out var mvid) && assembliesByMvid.TryGetValue (mvid, out var reader))
+				return reader;
+
+			if (!assembliesByName.TryGetValue (image.name, out reader))
+				reader = null;
+
+			if (reportedImages.Add (image.id)) {
+				if (reader != null)
+					MainClass.Warning ($"MVID of assembly `{image.name}` doesn't match ({image.mvid}), method names might be wrong");
+				else if (assembliesByMvid.Count > 0)
+					MainClass.Warning ($"assembly `{image.name}` ({image.mvid}) not found");
+			}
+
+			return reader;
+		}
+
+		static string FormatMethod (MetadataReader reader, uint token)
+		{
+			if ((token >> 24) != (uint)TableIndex.MethodDef)
+				return null;
+
+			int row = (int)(token & 0x00ffffff);
+			if (row == 0 || row > reader.MethodDefinitions.Count)
+				return null;
+
+			var method = reader.GetMethodDefinition (MetadataTokens.MethodDefinitionHandle (row));
+			var type = reader.GetTypeDefinition (method.GetDeclaringType ());
+			var context = new GenericContext (
+				type.GetGenericParameters ().Select (p => reader.GetString (reader.GetGenericParameter (p).Name)).ToImmutableArray (),
+				method.GetGenericParameters ().Select (p => reader.GetString (reader.GetGenericParameter (p).Name)).ToImmutableArray ()
+			);
+			var signature = method.DecodeSignature (new MonoTypeNameProvider (), context);
+
+			return $"{GetTypeName (reader, type)}:{reader.GetString (method.Name)} ({String.Join (",", signature.ParameterTypes)})";
+		}
+
+		static string GetTypeName (MetadataReader reader, TypeDefinition type)
+		{
+			string name = reader.GetString (type.Name);
+			if (type.IsNested)
+				return $"{GetTypeName (reader, reader.GetTypeDefinition (type.GetDeclaringType ()))}/{name}";
+
+			string ns = reader.GetString (type.Namespace);
+			return ns.Length > 0 ? $"{ns}.{name}" : name;
+		}
+
+		class GenericContext {
+			public readonly ImmutableArray<string> TypeParameters;
+			public readonly ImmutableArray<string> MethodParameters;
+
+			public GenericContext (ImmutableArray<string> typeParameters, ImmutableArray<string> methodParameters)
+			{
+				TypeParameters = typeParameters;
+				MethodParameters = methodParameters;
+			}
+		}
+
+		// Type names as `mono_signature_get_desc` formats them
+		class MonoTypeNameProvider : ISignatureTypeProvider<string, GenericContext> {
+			public string GetPrimitiveType (PrimitiveTypeCode typeCode)
+			{
+				switch (typeCode) {
+					case PrimitiveTypeCode.Boolean:        return "bool";
+					case PrimitiveTypeCode.Byte:           return "byte";
+					case PrimitiveTypeCode.Char:           return "char";
+					case PrimitiveTypeCode.Double:         return "double";
+					case PrimitiveTypeCode.Int16:          return "int16";
+					case PrimitiveTypeCode.Int32:          return "int";
+					case PrimitiveTypeCode.Int64:          return "long";
+					case PrimitiveTypeCode.IntPtr:         return "intptr";
+					case PrimitiveTypeCode.Object:         return "object";
+					case PrimitiveTypeCode.SByte:          return "sbyte";
+					case PrimitiveTypeCode.Single:         return "single";
+					case PrimitiveTypeCode.String:         return "string";
+					case PrimitiveTypeCode.TypedReference: return "typedbyref";
+					case PrimitiveTypeCode.UInt16:         return "uint16";
+					case PrimitiveTypeCode.UInt32:         return "uint";
+					case PrimitiveTypeCode.UInt64:         return "ulong";
+					case PrimitiveTypeCode.UIntPtr:        return "uintptr";
+					case PrimitiveTypeCode.Void:           return "void";
+					default:                               return typeCode.ToString ();
+				}
+			}
+
+			public string GetTypeFromDefinition (MetadataReader reader, TypeDefinitionHandle handle, byte rawTypeKind)
+			{
+				return GetTypeName (reader, reader.GetTypeDefinition (handle));
+			}
+
+			public string GetTypeFromReference (MetadataReader reader, TypeReferenceHandle handle, byte rawTypeKind)
+			{
+				var type = reader.GetTypeReference (handle);
+				string name = reader.GetString (type.Name);
+
+				if (type.ResolutionScope.Kind == HandleKind.TypeReference)
+					return $"{GetTypeFromReference (reader, (TypeReferenceHandle)type.ResolutionScope, rawTypeKind)}/{name}";
+
+				string ns = reader.GetString (type.Namespace);
+				return ns.Length > 0 ? $"{ns}.{name}" : name;
+			}
+
+			public string GetTypeFromSpecification (MetadataReader reader, GenericContext genericContext, TypeSpecificationHandle handle, byte rawTypeKind)
+			{
+				return reader.GetTypeSpecification (handle).DecodeSignature (this, genericContext);
+			}
+
+			public string GetSZArrayType (string elementType) => $"{elementType}[]";
+
+			public string GetArrayType (string elementType, ArrayShape shape) => $"{elementType}[{new string (',', shape.Rank - 1)}]";
+
+			public string GetByReferenceType (string elementType) => $"{elementType}&";
+
+			public string GetPointerType (string elementType) => $"{elementType}*";
+
+			public string GetPinnedType (string elementType) => elementType;
+
+			public string GetGenericInstantiation (string genericType, ImmutableArray<string> typeArguments) => $"{genericType}<{String.Join (", ", typeArguments)}>";
+
+			public string GetGenericTypeParameter (GenericContext genericContext, int index)
+			{
+				return index < genericContext.TypeParameters.Length ? genericContext.TypeParameters [index] : $"!{index}";
+			}
+
+			public string GetGenericMethodParameter (GenericContext genericContext, int index)
+			{
+				return index < genericContext.MethodParameters.Length ? genericContext.MethodParameters [index] : $"!!{index}";
+			}
+
+			public string GetFunctionPointerType (MethodSignature<string> signature) => "*()";
+
+			public string GetModifiedType (string modifier, string unmodifiedType, bool isRequired) => unmodifiedType;
+		}
+	}
+}
@@ -12,6 +12,7 @@ namespace jittimes {
 		static bool Verbose;
 		static readonly string Name = "jit-times";
 		static readonly List<Regex> methodNameRegexes = new List<Regex> ();
+		static readonly List<string> assemblyDirectories = new List<string> ();
 
 		enum SortKind {
 			Unsorted,
@@ -29,6 +30,7 @@ namespace jittimes {
 				$"Usage: {Name}.exe OPTIONS* <methods-file>",
 				"",
 				"Processes JIT methods file from XA app with debug.mono.log=timing enabled",
+				"(methods.txt, or methods.bin with debug.mono.log=timing,jit-binary)",
 				"",
 				"Copyright 2019 Microsoft Corporation",
 				"",
@@ -36,6 +38,9 @@ namespace jittimes {
 				{ "h|help|?",
 					"Show this message and exit",
 				  v => help = v != null },
+				{ "a|assemblies=",
+					"Resolve the method names of a binary methods file using the assemblies in {DIRECTORY}. May be repeated.",
+				  v => assemblyDirectories.Add (v) },
 				{ "m|method=",
 					"Process only methods whose names match {TYPE-REGEX}.",
 				  v => methodNameRegexes.Add (new Regex (v)) },
@@ -135,13 +140,82 @@ namespace jittimes {
 			return info;
 		}
 
-		public static int Main (string [] args)
+		static void MethodBegin (Stack<MethodInfo> jitMethods, string method, Timestamp time)
+		{
+			var info = GetMethodInfo (method);
+
+			if (info.state != MethodInfo.State.None && Verbose)
+				Warning ($"duplicit begin of `{info.method}`");
+
+			info.state = MethodInfo.State.Begin;
+			info.begin = time;
+
+			jitMethods.Push (info);
+		}
+
+		static void MethodDone (Stack<MethodInfo> jitMethods, string method, Timestamp time, ref Timestamp sum)
+		{
+			var info = GetMethodInfo (method);
+
+			if (info.state != MethodInfo.State.Begin) {
+				if (Verbose)
+					Warning ($"missing JIT begin for method {method}");
+				return;
+			}
+
+			info.state = MethodInfo.State.Done;
+			info.done = time;
+			info.total = info.done - info.begin;
+
+			info.CalcSelfTime ();
+
+			jitMethods.Pop ();
+
+			if (jitMethods.Count > 0) {
+				var outerMethod = jitMethods.Peek ();
+
+				outerMethod.AddInner (info);
+			} else if (sortKind == SortKind.Unsorted)
+				PrintIndented (info, ref sum);
+		}
+
+		// The failed compilation isn't timed, but it has to be taken off the stack like a finished one, or the methods
+		// compiled later would be taken for its inner methods.  The methods compiled while it was being compiled are
+		// passed to the outer method.
+		static void MethodFailed (Stack<MethodInfo> jitMethods, string method, ref Timestamp sum)
+		{
+			var info = GetMethodInfo (method);
+
+			if (info.state != MethodInfo.State.Begin) {
+				if (Verbose)
+					Warning ($"missing JIT begin for failed method {method}");
+				return;
+			}
+
+			jitMethods.Pop ();
+
+			var inner = info.inner;
+			info.inner = null;
+			info.state = MethodInfo.State.None;
+
+			if (inner == null)
+				return;
+
+			foreach (var im in inner) {
+				if (jitMethods.Count > 0)
+					jitMethods.Peek ().AddInner (im);
+				else if (sortKind == SortKind.Unsorted)
+					PrintIndented (im, ref sum);
+			}
+		}
+
+		static void ProcessTextFile (string path, ref Timestamp sum)
 		{
-			var path = ProcessArguments (args);
 			var file = File.OpenText (path);
 
 			var beginRegex = new Regex (@"^JIT method +begin: (.*) elapsed: (.*)$");
 			var doneRegex = new Regex (@"^JIT method +done: (.*) elapsed: (.*)$");
+			var failedRegex = new Regex (@"^JIT method +failed: (.*) elapsed: (.*)$");
 
 			string line;
 			int lineNumber = 0;
@@ -149,51 +223,77 @@ namespace jittimes {
 			var jitMethods = new Stack<MethodInfo> ();
 			string method;
 			Timestamp time;
-			Timestamp sum = new Timestamp ();
-			ColorWriteLine ("Total (ms) |  Self (ms) | Method", ConsoleColor.Yellow);
 
 			while ((line = file.ReadLine ()) != null) {
 				lineNumber++;
 
 				if (TryMatchTimeStamp (beginRegex, line, out method, out time)) {
-					var info = GetMethodInfo (method);
-
-					if (info.state != MethodInfo.State.None && Verbose)
-						Warning ($"duplicit begin of `{info.method}`");
-
-					info.state = MethodInfo.State.Begin;
-					info.begin = time;
-
-					jitMethods.Push (info);
-
+					MethodBegin (jitMethods, method, time);
 					continue;
 				}
 
 				if (TryMatchTimeStamp (doneRegex, line, out method, out time)) {
-					var info = GetMethodInfo (method);
+					MethodDone (jitMethods, method, time, ref sum);
+					continue;
+				}
 
-					if (info.state != MethodInfo.State.Begin) {
-						if (Verbose)
-							Warning ($"missing JIT begin for method {method}");
-						continue;
-					}
+				if (TryMatchTimeStamp (failedRegex, line, out method, out time))
+					MethodFailed (jitMethods, method, ref sum);
+			}
+		}
+
+		// Methods may be JIT-ed on several threads at the same time, so the binary log (which records the thread
+		// of each event) keeps track of the nesting per thread
+		static void ProcessBinaryFile (string path, ref Timestamp sum)
+		{
+			var resolver = new MethodNameResolver ();
+			foreach (var dir in assemblyDirectories)
+				resolver.AddAssemblies (dir);
 
-					info.state = MethodInfo.State.Done;
-					info.done = time;
-					info.total = info.done - info.begin;
+			using (var reader = new JitLogReader (path)) {
+				var threads = new Dictionary<int, Stack<MethodInfo>> ();
 
-					info.CalcSelfTime ();
+				foreach (var e in reader.ReadEvents ()) {
+					if (!threads.TryGetValue (e.threadId, out var jitMethods)) {
+						jitMethods = new Stack<MethodInfo> ();
+						threads [e.threadId] = jitMethods;
+					}
 
-					jitMethods.Pop ();
+					var time = Timestamp.FromNanoseconds (e.timestampNs - reader.StartNs);
+					switch (e.kind) {
+						case JitEventKind.Begin:
+							MethodBegin (jitMethods, resolver.GetMethodName (e), time);
+							break;
 
-					if (jitMethods.Count > 0) {
-						var outerMethod = jitMethods.Peek ();
+						case JitEventKind.Done:
+							MethodDone (jitMethods, resolver.GetMethodName (e), time, ref sum);
+							break;
 
-						outerMethod.AddInner (info);
-					} else if (sortKind == SortKind.Unsorted)
-						PrintIndented (info, ref sum);
+						case JitEventKind.Failed:
+							MethodFailed (jitMethods, resolver.GetMethodName (e), ref sum);
+							break;
+					}
 				}
+
+				if (reader.DroppedEvents > 0)
+					Warning ($"{reader.DroppedEvents} events were dropped by the application, the results are incomplete");
+				if (reader.Truncated)
+					Warning ("the file is truncated");
 			}
+		}
+
+		public static int Main (string [] args)
+		{
+			var path = ProcessArguments (args);
+			var binary = JitLogReader.IsBinaryLog (path);
+
+			Timestamp sum = new Timestamp ();
+			ColorWriteLine ("Total (ms) |  Self (ms) | Method", ConsoleColor.Yellow);
+
+			if (binary)
+				ProcessBinaryFile (path, ref sum);
+			else
+				ProcessTextFile (path, ref sum);
 
 			if (sortKind != SortKind.Unsorted)
 				sum = PrintSortedMethods ();
@@ -28,6 +28,15 @@ namespace jittimes {
 			return ts;
 		}
 
+		public static Timestamp FromNanoseconds (ulong ns)
+		{
+			return new Timestamp {
+				seconds = (Int64)(ns / 1000000000),
+				milliseconds = (int)(ns % 1000000000 / 1000000),
+				nanoseconds = (int)(ns % 1000000),
+			};
+		}
+
 		static public Timestamp operator - (Timestamp ts1, Timestamp ts2)
 		{
 			Timestamp result = new Timestamp ();
@@ -0,0 +1,233 @@
+using Mono.Options;
+
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using static System.Console;
+
+namespace reflogdecoder {
+	class MainClass {
+		static readonly string Name = "ref-log-decoder";
+
+		enum OutputKind {
+			Text,
+			Counts,
+			Stacks,
+			Live,
+		};
+
+		static OutputKind outputKind = OutputKind.Text;
+		static int topCount = 20;
+
+		static string ProcessArguments (string [] args)
+		{
+			var help = false;
+			var options = new OptionSet {
+				$"Usage: {Name}.exe OPTIONS* <log-file>",
+				"",
+				"Decodes the binary grefs.bin/lrefs.bin file from XA app with debug.mono.log=gref,ref-binary enabled",
+				"",
+				"Copyright 2026 Microsoft Corporation",
+				"",
+				"Options:",
+				{ "h|help|?",
+					"Show this message and exit",
+				  v => help = v != null },
+				{ "t|text",
+					"Write the log in the same format as debug.mono.log=gref does. (this is default)",
+				  v => outputKind = OutputKind.Text },
+				{ "c|counts",
+					"Write the timestamp (ms) and the global and weak global reference counts after each change, as CSV.",
+				  v => outputKind = OutputKind.Counts },
+				{ "s|stacks",
+					"Show the stack traces which created the most global references.",
+				  v => outputKind = OutputKind.Stacks },
+				{ "l|live",
+					"Show the stack traces which created the most global references still alive at the end of the log.",
+				  v => outputKind = OutputKind.Live },
+				{ "n|top=",
+					$"Show at most {{COUNT}} stack traces. (default {topCount})",
+				  (int v) => topCount = v },
+			};
+
+			var remaining = options.Parse (args);
+
+			if (help || args.Length < 1) {
+				options.WriteOptionDescriptions (Out);
+
+				Environment.Exit (0);
+			}
+
+			if (remaining.Count != 1) {
+				Error ("Please specify one <log-file> to process.");
+				Environment.Exit (2);
+			}
+
+			return remaining [0];
+		}
+
+		static string FormatHandle (ulong handle)
+		{
+			return $"0x{handle:x}";
+		}
+
+		static void WriteText (Record record)
+		{
+			string prefix;
+
+			switch (record.kind) {
+				case RecordKind.Message:
+					Out.Write (record.text);
+					return;
+
+				case RecordKind.GrefNew:
+				case RecordKind.WeakGrefNew:
+					prefix = record.kind == RecordKind.GrefNew ? "+g+" : "+w+";
+					Out.WriteLine ($"{prefix} grefc {record.count} gwrefc {record.weakCount} obj-handle {FormatHandle (record.handle)}/{record.handleType} -> new-handle {FormatHandle (record.newHandle)}/{record.newHandleType} from thread '{record.threadName}'({record.threadId})");
+					break;
+
+				case RecordKind.GrefDelete:
+				case RecordKind.WeakGrefDelete:
+					prefix = record.kind == RecordKind.GrefDelete ? "-g-" : "-w-";
+					Out.WriteLine ($"{prefix} grefc {record.count} gwrefc {record.weakCount} handle {FormatHandle (record.handle)}/{record.handleType} from thread '{record.threadName}'({record.threadId})");
+					break;
+
+				case RecordKind.LrefNew:
+				case RecordKind.LrefDelete:
+					prefix = record.kind == RecordKind.LrefNew ? "+l+" : "-l-";
+					Out.WriteLine ($"{prefix} lrefc {record.count} handle {FormatHandle (record.handle)}/{record.handleType} from thread '{record.threadName}'({record.threadId})");
+					break;
+			}
+
+			Out.WriteLine (record.text);
+		}
+
+		static bool IsGlobalReference (Record record)
+		{
+			return record.kind != RecordKind.Message && record.kind != RecordKind.LrefNew && record.kind != RecordKind.LrefDelete;
+		}
+
+		static void WriteCounts (IEnumerable<Record> records)
+		{
+			Out.WriteLine ("time_ms,grefc,gwrefc");
+
+			ulong? start = null;
+			foreach (var record in records) {
+				if (!IsGlobalReference (record))
+					continue;
+
+				start ??= record.timestampNs;
+				Out.WriteLine ($"{(record.timestampNs - start.Value) / 1000000.0:F3},{record.count},{record.weakCount}");
+			}
+		}
+
+		static void WriteStacks (Dictionary<string, int> stacks, string title)
+		{
+			int total = stacks.Values.Sum ();
+			ColorWriteLine ($"{title}: {total} references, {stacks.Count} distinct stack traces", ConsoleColor.Yellow);
+
+			foreach (var entry in stacks.OrderByDescending (e => e.Value).Take (topCount)) {
+				Out.WriteLine ();
+				ColorWriteLine ($"{entry.Value} ({100.0 * entry.Value / total:F1}%)", ConsoleColor.Green);
+				Out.WriteLine (entry.Key.Length > 0 ? entry.Key : "<no stack trace>");
+			}
+		}
+
+		static void CountStacks (IEnumerable<Record> records)
+		{
+			var stacks = new Dictionary<string, int> ();
+
+			foreach (var record in records) {
+				if (record.kind != RecordKind.GrefNew && record.kind != RecordKind.WeakGrefNew)
+					continue;
+
+				stacks.TryGetValue (record.text, out int count);
+				stacks [record.text] = count + 1;
+			}
+
+			WriteStacks (stacks, "Created global references");
+		}
+
+		static void CountLiveStacks (IEnumerable<Record> records)
+		{
+			// Handle values are reused after they are deleted, so only the most recent creation matters
+			var live = new Dictionary<ulong, string> ();
+
+			foreach (var record in records) {
+				switch (record.kind) {
+					case RecordKind.GrefNew:
+					case RecordKind.WeakGrefNew:
+						live [record.newHandle] = record.text;
+						break;
+
+					case RecordKind.GrefDelete:
+					case RecordKind.WeakGrefDelete:
+						live.Remove (record.handle);
+						break;
+				}
+			}
+
+			var stacks = new Dictionary<string, int> ();
+			foreach (var text in live.Values) {
+				stacks.TryGetValue (text, out int count);
+				stacks [text] = count + 1;
+			}
+
+			WriteStacks (stacks, "Live global references");
+		}
+
+		public static int Main (string [] args)
+		{
+			var path = ProcessArguments (args);
+
+			using var reader = new RefLogReader (path);
+			var records = reader.ReadRecords ();
+
+			switch (outputKind) {
+				case OutputKind.Text:
+					foreach (var record in records)
+						WriteText (record);
+					break;
+
+				case OutputKind.Counts:
+					WriteCounts (records);
+					break;
+
+				case OutputKind.Stacks:
+					CountStacks (records);
+					break;
+
+				case OutputKind.Live:
+					CountLiveStacks (records);
+					break;
+			}
+
+			if (reader.DroppedRecords > 0)
+				Warning ($"{reader.DroppedRecords} records were dropped by the application, the log is incomplete");
+
+			if (reader.Truncated)
+				Warning ("the log file is truncated");
+
+			return 0;
+		}
+
+		static void ColorMessage (string message, ConsoleColor color, TextWriter writer, bool writeLine = true)
+		{
+			ForegroundColor = color;
+
+			if (writeLine)
+				writer.WriteLine (message);
+			else
+				writer.Write (message);
+
+			ResetColor ();
+		}
+
+		public static void ColorWriteLine (string message, ConsoleColor color) => ColorMessage (message, color, Out);
+
+		public static void Error (string message) => ColorMessage ($"Error: {Name}: {message}", ConsoleColor.Red, Console.Error);
+
+		public static void Warning (string message) => ColorMessage ($"Warning: {Name}: {message}", ConsoleColor.Yellow, Console.Error);
+	}
+}
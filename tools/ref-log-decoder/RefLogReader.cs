@@ -0,0 +1,141 @@
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Text;
+
+namespace reflogdecoder {
+	// Must be kept in sync with RefLogRecordKind in src/native/monodroid/ref-log-writer.hh
+	enum RecordKind : byte {
+		Message        = 0,
+		GrefNew        = 1,
+		GrefDelete     = 2,
+		WeakGrefNew    = 3,
+		WeakGrefDelete = 4,
+		LrefNew        = 5,
+		LrefDelete     = 6,
+	}
+
+	class Record {
+		public RecordKind kind;
+		public char handleType;
+		public char newHandleType;
+		public int count;
+		public int weakCount;
+		public int threadId;
+		public string threadName;
+		public string text;
+		public ulong timestampNs;
+		public ulong handle;
+		public ulong newHandle;
+	}
+
+	// Reads the binary reference log written by RefLogWriter (see src/native/monodroid/ref-log-writer.hh for the
+	// description of the format)
+	class RefLogReader : IDisposable {
+		const string Magic = "XAREFLOG";
+		const uint SupportedVersion = 1;
+
+		const byte TagString  = 1;
+		const byte TagRecord  = 2;
+		const byte TagDropped = 3;
+
+		readonly BinaryReader reader;
+		readonly Dictionary<uint, string> strings = new Dictionary<uint, string> ();
+
+		public ulong DroppedRecords { get; private set; }
+		public bool Truncated { get; private set; }
+
+		public RefLogReader (string path)
+		{
+			reader = new BinaryReader (File.OpenRead (path));
+
+			var magic = Encoding.ASCII.GetString (reader.ReadBytes (Magic.Length));
+			if (magic != Magic)
+				throw new InvalidDataException ($"`{path}` is not a binary reference log file");
+
+			uint version = reader.ReadUInt32 ();
+			if (version != SupportedVersion)
+				throw new InvalidDataException ($"Unsupported binary reference log version {version}, expected {SupportedVersion}");
+			reader.ReadUInt32 (); // reserved
+		}
+
+		public void Dispose ()
+		{
+			reader.Dispose ();
+		}
+
+		public IEnumerable<Record> ReadRecords ()
+		{
+			for (;;) {
+				Record record;
+				try {
+					if (!TryReadRecord (out record))
+						yield break;
+				} catch (EndOfStreamException) {
+					// The application was most likely killed while the log was being written
+					Truncated = true;
+					yield break;
+				}
+
+				yield return record;
+			}
+		}
+
+		bool TryReadRecord (out Record record)
+		{
+			record = null;
+
+			for (;;) {
+				int tag = reader.BaseStream.ReadByte ();
+				switch (tag) {
+					case -1:
+						return false;
+
+					case TagString:
+						uint id = reader.ReadUInt32 ();
+						uint length = reader.ReadUInt32 ();
+						byte[] bytes = reader.ReadBytes ((int)length);
+						if (bytes.Length != length)
+							throw new EndOfStreamException ();
+						strings [id] = Encoding.UTF8.GetString (bytes);
+						break;
+
+					case TagDropped:
+						DroppedRecords = reader.ReadUInt64 ();
+						break;
+
+					case TagRecord:
+						record = new Record {
+							kind          = (RecordKind)reader.ReadByte (),
+							handleType    = (char)reader.ReadByte (),
+							newHandleType = (char)reader.ReadByte (),
+						};
+						reader.ReadByte (); // flags
+						record.count       = reader.ReadInt32 ();
+						record.weakCount   = reader.ReadInt32 ();
+						record.threadId    = reader.ReadInt32 ();
+						record.threadName  = GetString (reader.ReadUInt32 ());
+						record.text        = GetString (reader.ReadUInt32 ());
+						record.timestampNs = reader.ReadUInt64 ();
+						record.handle      = reader.ReadUInt64 ();
+						record.newHandle   = reader.ReadUInt64 ();
+						return true;
+
+					default:
+						throw new InvalidDataException ($"Unknown entry tag {tag} at offset {reader.BaseStream.Position - 1}");
+				}
+			}
+		}
+
+		string GetString (uint id)
+		{
+			if (id == 0)
+				return String.Empty;
+
+			if (!strings.TryGetValue (id, out var value))
+				throw new InvalidDataException ($"Reference to undefined string {id}");
+
+			return value;
+		}
+	}
+}